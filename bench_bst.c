@@ -0,0 +1,1324 @@
+/**
+ * @file        bench_bst.c
+ * @brief       Benchmark program for the Temperature/Humidity BST ADT
+ *
+ * Measures:
+ *  - lookup throughput of the pointer-based BST against the frozen
+ *    Eytzinger index, the compact-node tree and batched search_many()
+ *    lookups, for increasing numbers of readings
+ *  - range summaries over the tree against the columnar store
+ *  - reader scaling with one thread inserting while 1 to 8 threads search,
+ *    first with every call behind one mutex, then on a shared tree with
+ *    lock-free readers
+ *  - ingest scaling with 1 to 8 collector threads into one locked tree and
+ *    into a sharded set
+ *  - restart time from a rebuild against a mapped snapshot
+ *  - insert() with a write-ahead log for several group commit sizes
+ *  - loading logged readings from CSV and binary files
+ *  - writing the in_order() table with printf() and with the export engine
+ *  - memory and range scan time of the tree against the compressed archive
+ *  - random reading generation with 1 to 8 threads, sharing rand() and each
+ *    with its own xoshiro256** generator
+ *  - generating sensor register values one reading at a time against
+ *    iom361_generate_batch(), which uses AVX2 if built with e.g.
+ *    make bench CFLAGS="-Wall -std=c99 -mavx2"
+ *  - the cost of search()'s trace logging
+ *
+ * Lookup sizes are given on the command line in millions of readings
+ * (default 1 and 10), e.g.
+ *
+ *      make clean && make bench BENCH_ARGS="1 10 100"
+ *
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "bst_log.h"
+#include "temp_humid_bst.h"
+#include "temp_humid_wal.h"
+#include "temp_humid_frozen.h"
+#include "temp_humid_cols.h"
+#include "temp_humid_shard.h"
+#include "temp_humid_ingest.h"
+#include "temp_humid_export.h"
+#include "temp_humid_archive.h"
+#include "temp_humid_compact.h"
+#include "rndm_engine.h"
+#include "float_rndm.h"
+#include "iom361_r2.h"
+
+
+
+/******************************** Definitions *********************************/
+
+#define LOOKUPS     2000000     // Lookups timed per structure and size
+#define LOG_LOOKUPS 20000       // Lookups timed with trace logging on
+#define BATCH       65536       // Keys per search_many() call
+#define SCANS       10          // Range summaries timed per structure
+#define START_TIME  1672531200  // 01-Jan-2023 00:00:00 UTC
+#define CADENCE     86400       // One reading per day
+#define LOOKUP_CADENCE 60       // One reading a minute, so 10M readings fit
+                                // the compact tree's 136 year window
+#define READER_LOOKUPS 1000000  // Lookups per reader thread
+#define MAX_THREADS 8           // Most reader or collector threads timed
+#define COLLECTOR_READINGS 250000   // Readings inserted per collector thread
+#define SENSORS_PER_COLLECTOR 16    // Sensors each collector thread polls
+#define BENCH_SHARDS 64             // Shards in the sharded set
+#define WAL_INSERTS 20000           // Logged inserts timed per commit size
+#define RNDM_DRAWS 4000000          // Random readings drawn per thread
+#define BATCH_READINGS 16000000     // Sensor register values per batch
+
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Defines one thread of the reader scaling benchmark
+typedef struct {
+    Tree_t* tree;           // Tree being searched or inserted into
+    pthread_mutex_t* lock;  // Guards every call, NULL for lock-free readers
+    size_t count;           // Readings loaded before the threads started
+    uint64_t seed;          // Generator state for picking keys
+    uint64_t sum;           // Sum of readings found, keeps the loop honest
+    bool* stop;             // Tells the writer when the readers are done
+    size_t inserted;        // Readings added by the writer
+} Worker_t;
+
+
+
+// Defines one collector thread of the ingest benchmark
+typedef struct {
+    Tree_t* tree;           // Single tree shared by every collector, or NULL
+    pthread_mutex_t* lock;  // Guards tree
+    ShardSet_t* set;        // Sharded set, used when tree is NULL
+    uint32_t first_sensor;  // First of the sensors this thread polls
+} Collector_t;
+
+
+
+// Defines one thread of the random reading benchmark
+typedef struct {
+    bool engine;            // Own xoshiro256** generator, else rand()
+    uint64_t seed;          // Seed for the generator
+    double sum;             // Sum of values drawn, keeps the loop honest
+} Drawer_t;
+
+
+
+/**************************** Function Prototypes *****************************/
+
+static double now_seconds(void);
+static uint64_t next_random(uint64_t* state);
+static int compare_keys(const void* a, const void* b);
+static void bench_search(size_t count);
+static void bench_logging(size_t count);
+static void bench_summary(size_t count);
+static bool add_reading(const Data_t* reading, void* context);
+static void* reader_thread(void* context);
+static void* writer_thread(void* context);
+static double run_readers(size_t count, int readers, bool lock_free,
+                          double* insert_rate);
+static void bench_readers(size_t count);
+static void* collector_thread(void* context);
+static double run_collectors(int collectors, bool sharded);
+static void bench_ingest(void);
+static void bench_snapshot(size_t count);
+static void bench_wal(void);
+static void bench_load(size_t count);
+static void bench_export(size_t count);
+static bool sum_reading(const Data_t* reading, void* context);
+static void bench_archive(size_t count);
+static void* draw_thread(void* context);
+static double run_drawers(int threads, bool engine);
+static void bench_rndm(void);
+static void bench_batch(void);
+
+
+
+/************************************ Main ************************************/
+
+int main(int argc, char* argv[]) {
+    printf("\n\nTemp & Humid BST ADT benchmark\n\n");
+
+    // Keeps errors only, the benchmark times lookups not console output
+    bst_set_log_level(BST_LOG_ERROR);
+
+    if (argc < 2) {
+        bench_search(1000000);
+        bench_search(10000000);
+    }
+
+    for (int i = 1; i < argc; i++) {
+        bench_search((size_t)(atof(argv[i]) * 1000000.0));
+    }
+
+    bench_summary(10000000);
+
+    bench_readers(1000000);
+
+    bench_ingest();
+
+    bench_snapshot(10000000);
+
+    bench_wal();
+
+    bench_load(10000000);
+
+    bench_export(10000000);
+
+    bench_archive(10000000);
+
+    bench_rndm();
+
+    bench_batch();
+
+    bench_logging(1000000);
+
+    return 0;
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * now_seconds() - returns a monotonic time stamp in seconds
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+
+
+/**
+ * next_random() - xorshift64 generator used to pick lookup keys
+ *
+ * @param state   Generator state, must be non-zero
+ */
+static uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+
+    return x;
+}
+
+
+
+/**
+ * compare_keys() - qsort() comparator for timestamps
+ */
+static int compare_keys(const void* a, const void* b) {
+    time_t key_a = *(const time_t*)a;
+    time_t key_b = *(const time_t*)b;
+
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+
+
+/**
+ * bench_search() - times random lookups in the BST and the frozen index
+ *
+ * @param count   Number of readings to load
+ */
+static void bench_search(size_t count) {
+    if (count == 0) {
+        return;
+    }
+
+    Data_t* readings = malloc(count * sizeof(Data_t));
+    time_t* keys = malloc(LOOKUPS * sizeof(time_t));
+    Node_t** results = malloc(BATCH * sizeof(Node_t*));
+
+    if (readings == NULL || keys == NULL || results == NULL) {
+        printf("ERROR(bench_search()): Out of memory for %zu readings\n", 
+               count);
+        free(readings);
+        free(keys);
+        free(results);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        readings[i].timestamp = START_TIME + (time_t)i * LOOKUP_CADENCE;
+        readings[i].temp = (uint32_t)(i & 0xFFFFF);
+        readings[i].humid = (uint32_t)((i * 3) & 0xFFFFF);
+    }
+
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        keys[i] = START_TIME + 
+                  (time_t)(next_random(&state) % count) * LOOKUP_CADENCE;
+    }
+
+    Tree_t* tree = build_tree_from_sorted(readings, count);
+    free(readings);
+
+    Frozen_t* frozen = freeze_tree(tree);
+
+    // NULL if the readings span too long for the compact format
+    CompactTree_t* compact = compact_tree(tree);
+
+    if (tree == NULL || frozen == NULL) {
+        delete_tree(tree);
+        delete_frozen(frozen);
+        delete_compact_tree(compact);
+        free(keys);
+        free(results);
+        return;
+    }
+
+    // Sums the readings found so neither loop can be optimized away
+    uint64_t tree_sum = 0;
+    uint64_t frozen_sum = 0;
+
+    double start = now_seconds();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        tree_sum += search(tree, keys[i])->data.temp;
+    }
+    double tree_time = now_seconds() - start;
+
+    start = now_seconds();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        frozen_sum += frozen_search(frozen, keys[i])->temp;
+    }
+    double frozen_time = now_seconds() - start;
+
+    uint64_t compact_sum = 0;
+
+    start = now_seconds();
+    for (size_t i = 0; compact != NULL && i < LOOKUPS; i++) {
+        Data_t reading;
+
+        compact_search(compact, keys[i], &reading);
+        compact_sum += reading.temp;
+    }
+    double compact_time = now_seconds() - start;
+
+    // Unsorted batches, so the time includes sorting each batch
+    uint64_t batch_sum = 0;
+
+    start = now_seconds();
+    for (size_t i = 0; i + BATCH <= LOOKUPS; i += BATCH) {
+        search_many(tree, keys + i, BATCH, results);
+
+        for (size_t j = 0; j < BATCH; j++) {
+            batch_sum += results[j]->data.temp;
+        }
+    }
+    double batch_time = now_seconds() - start;
+    size_t batch_lookups = (LOOKUPS / BATCH) * BATCH;
+
+    // Same batches sorted up front, as a report generator would pass them
+    for (size_t i = 0; i + BATCH <= LOOKUPS; i += BATCH) {
+        qsort(keys + i, BATCH, sizeof(time_t), compare_keys);
+    }
+
+    start = now_seconds();
+    for (size_t i = 0; i + BATCH <= LOOKUPS; i += BATCH) {
+        search_many(tree, keys + i, BATCH, results);
+
+        for (size_t j = 0; j < BATCH; j++) {
+            batch_sum -= results[j]->data.temp;
+        }
+    }
+    double sorted_time = now_seconds() - start;
+
+    printf("%6.1fM readings: tree %7.1f ns/lookup, frozen %7.1f ns/lookup, "
+           "speedup %.2fx%s\n",
+           count / 1e6,
+           tree_time * 1e9 / LOOKUPS,
+           frozen_time * 1e9 / LOOKUPS,
+           tree_time / frozen_time,
+           (tree_sum == frozen_sum) ? "" : "  (MISMATCH)");
+    if (compact != NULL) {
+        printf("%6.1fM readings: compact %7.1f ns/lookup (%.2fx), "
+               "%4.1f bytes/node against %4.1f%s\n",
+               count / 1e6,
+               compact_time * 1e9 / LOOKUPS,
+               tree_time / compact_time,
+               (double)sizeof(CompactNode_t),
+               (double)sizeof(Node_t),
+               (tree_sum == compact_sum) ? "" : "  (MISMATCH)");
+    }
+    printf("%6.1fM readings: search_many() x%d unsorted %7.1f ns/lookup "
+           "(%.2fx), sorted %7.1f ns/lookup (%.2fx)%s\n",
+           count / 1e6,
+           BATCH,
+           batch_time * 1e9 / batch_lookups,
+           (tree_time / LOOKUPS) / (batch_time / batch_lookups),
+           sorted_time * 1e9 / batch_lookups,
+           (tree_time / LOOKUPS) / (sorted_time / batch_lookups),
+           (batch_sum == 0) ? "" : "  (MISMATCH)");
+
+    delete_frozen(frozen);
+    delete_compact_tree(compact);
+    delete_tree(tree);
+    free(keys);
+    free(results);
+}
+
+
+
+/**
+ * bench_logging() - times search() with trace logging off and on
+ *
+ * With logging on every visited node costs a localtime(), strftime() and
+ * printf(). Console output is sent to /dev/null while timing so the terminal
+ * does not dominate the result.
+ *
+ * @param count   Number of readings to load
+ */
+static void bench_logging(size_t count) {
+    Data_t* readings = malloc(count * sizeof(Data_t));
+    time_t* keys = malloc(LOG_LOOKUPS * sizeof(time_t));
+
+    if (readings == NULL || keys == NULL) {
+        printf("ERROR(bench_logging()): Out of memory for %zu readings\n", 
+               count);
+        free(readings);
+        free(keys);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        readings[i].timestamp = START_TIME + (time_t)i * CADENCE;
+        readings[i].temp = (uint32_t)(i & 0xFFFFF);
+        readings[i].humid = 0;
+    }
+
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+
+    for (size_t i = 0; i < LOG_LOOKUPS; i++) {
+        keys[i] = START_TIME + (time_t)(next_random(&state) % count) * CADENCE;
+    }
+
+    Tree_t* tree = build_tree_from_sorted(readings, count);
+    free(readings);
+
+    if (tree == NULL) {
+        free(keys);
+        return;
+    }
+
+    uint64_t sum = 0;
+
+    double start = now_seconds();
+    for (size_t i = 0; i < LOG_LOOKUPS; i++) {
+        sum += search(tree, keys[i])->data.temp;
+    }
+    double quiet_time = now_seconds() - start;
+
+    // Sends the trace to /dev/null, then restores stdout
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+
+    if (saved_stdout < 0 || freopen("/dev/null", "w", stdout) == NULL) {
+        printf("ERROR(bench_logging()): Could not redirect stdout\n");
+        delete_tree(tree);
+        free(keys);
+        return;
+    }
+
+    int previous = bst_set_log_level(BST_LOG_TRACE);
+
+    start = now_seconds();
+    for (size_t i = 0; i < LOG_LOOKUPS; i++) {
+        sum += search(tree, keys[i])->data.temp;
+    }
+    double trace_time = now_seconds() - start;
+
+    bst_set_log_level(previous);
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    printf("\nsearch() at %.1fM readings: logging off %8.1f ns/lookup, "
+           "trace on %8.1f ns/lookup (%.0fx slower)%s\n",
+           count / 1e6,
+           quiet_time * 1e9 / LOG_LOOKUPS,
+           trace_time * 1e9 / LOG_LOOKUPS,
+           trace_time / quiet_time,
+           (sum != 0) ? "" : "  (MISMATCH)");
+
+    if (BST_LOG_LEVEL < BST_LOG_TRACE) {
+        printf("(trace is compiled out, BST_LOG_LEVEL=%d)\n", BST_LOG_LEVEL);
+    }
+
+    delete_tree(tree);
+    free(keys);
+}
+
+
+
+/**
+ * add_reading() - search_range() callback that accumulates a Summary_t
+ */
+static bool add_reading(const Data_t* reading, void* context) {
+    Summary_t* summary = (Summary_t*)context;
+
+    summary->count++;
+    summary->temp_sum += reading->temp;
+    summary->humid_sum += reading->humid;
+    summary->temp_min = (reading->temp < summary->temp_min) ? reading->temp 
+                                                            : summary->temp_min;
+    summary->temp_max = (reading->temp > summary->temp_max) ? reading->temp 
+                                                            : summary->temp_max;
+    summary->humid_min = (reading->humid < summary->humid_min) 
+                         ? reading->humid : summary->humid_min;
+    summary->humid_max = (reading->humid > summary->humid_max) 
+                         ? reading->humid : summary->humid_max;
+
+    return true;
+}
+
+
+
+/**
+ * bench_summary() - times summarizing half of the readings with a tree
+ *                   range walk and with the columnar store's SIMD scan
+ *
+ * @param count   Number of readings to load
+ */
+static void bench_summary(size_t count) {
+    Data_t* readings = malloc(count * sizeof(Data_t));
+    ColStore_t* store = create_colstore();
+
+    if (readings == NULL || store == NULL) {
+        printf("ERROR(bench_summary()): Out of memory for %zu readings\n", 
+               count);
+        free(readings);
+        delete_colstore(store);
+        return;
+    }
+
+    uint64_t state = 0x853C49E6748FEA9BULL;
+
+    for (size_t i = 0; i < count; i++) {
+        readings[i].timestamp = START_TIME + (time_t)i * CADENCE;
+        readings[i].temp = (uint32_t)(next_random(&state) & 0xFFFFF);
+        readings[i].humid = (uint32_t)(next_random(&state) & 0xFFFFF);
+        colstore_insert(store, readings[i]);
+    }
+
+    Tree_t* tree = build_tree_from_sorted(readings, count);
+    free(readings);
+
+    if (tree == NULL) {
+        delete_colstore(store);
+        return;
+    }
+
+    time_t t_begin = START_TIME + (time_t)(count / 4) * CADENCE;
+    time_t t_end = START_TIME + (time_t)(3 * count / 4) * CADENCE;
+    Summary_t tree_summary = {0};
+    Summary_t cols_summary = {0};
+
+    double start = now_seconds();
+    for (int i = 0; i < SCANS; i++) {
+        Summary_t summary = {0, 0, UINT32_MAX, 0, 0, UINT32_MAX, 0};
+
+        search_range(tree, t_begin, t_end, add_reading, &summary);
+        tree_summary = summary;
+    }
+    double tree_time = (now_seconds() - start) / SCANS;
+
+    start = now_seconds();
+    for (int i = 0; i < SCANS; i++) {
+        cols_summary = colstore_summarize(store, t_begin, t_end);
+    }
+    double cols_time = (now_seconds() - start) / SCANS;
+
+    // Subtree summaries need only a handful of nodes, so time many more
+    Summary_t agg_summary = {0};
+
+    start = now_seconds();
+    for (int i = 0; i < SCANS * 10000; i++) {
+        agg_summary = aggregate_range(tree, t_begin, t_end);
+    }
+    double agg_time = (now_seconds() - start) / (SCANS * 10000);
+
+    printf("\nSummary of %.1fM of %.1fM readings: tree range walk %8.2f ms, "
+           "column store %8.2f ms, aggregate_range() %8.5f ms%s\n",
+           tree_summary.count / 1e6,
+           count / 1e6,
+           tree_time * 1e3,
+           cols_time * 1e3,
+           agg_time * 1e3,
+           (tree_summary.temp_sum == cols_summary.temp_sum &&
+            tree_summary.humid_max == cols_summary.humid_max &&
+            tree_summary.temp_sum == agg_summary.temp_sum &&
+            tree_summary.humid_min == agg_summary.humid_min) 
+           ? "" : "  (MISMATCH)");
+
+    delete_tree(tree);
+    delete_colstore(store);
+}
+
+
+
+/**
+ * reader_thread() - searches random loaded readings, locking if asked to
+ *
+ * @param context   Worker_t for this thread
+ * @return          NULL
+ */
+static void* reader_thread(void* context) {
+    Worker_t* worker = (Worker_t*)context;
+    int slot = (worker->lock == NULL) ? tree_add_reader(worker->tree) : -1;
+
+    if (worker->lock == NULL && slot < 0) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < READER_LOOKUPS; i++) {
+        time_t key = START_TIME + 
+                     (time_t)(next_random(&worker->seed) % worker->count) * 
+                     CADENCE;
+
+        if (worker->lock != NULL) {
+            pthread_mutex_lock(worker->lock);
+            worker->sum += search(worker->tree, key)->data.temp;
+            pthread_mutex_unlock(worker->lock);
+        }
+        else {
+            tree_read_begin(worker->tree, slot);
+            worker->sum += search(worker->tree, key)->data.temp;
+            tree_read_end(worker->tree, slot);
+        }
+    }
+
+    return NULL;
+}
+
+
+
+/**
+ * writer_thread() - appends newer readings until told to stop
+ *
+ * @param context   Worker_t for this thread
+ * @return          NULL
+ */
+static void* writer_thread(void* context) {
+    Worker_t* worker = (Worker_t*)context;
+
+    while (!__atomic_load_n(worker->stop, __ATOMIC_ACQUIRE)) {
+        size_t i = worker->count + worker->inserted;
+        Data_t reading = {START_TIME + (time_t)i * CADENCE, 
+                          (uint32_t)(i & 0xFFFFF), 0};
+
+        if (worker->lock != NULL) {
+            pthread_mutex_lock(worker->lock);
+            insert(worker->tree, reading);
+            pthread_mutex_unlock(worker->lock);
+        }
+        else {
+            insert(worker->tree, reading);
+        }
+
+        worker->inserted++;
+    }
+
+    return NULL;
+}
+
+
+
+/**
+ * run_readers() - times a number of readers against one running writer
+ *
+ * @param count         Number of readings to load first
+ * @param readers       Number of reader threads
+ * @param lock_free     true for a shared tree, false for one global mutex
+ * @param insert_rate   Set to the writer's inserts per second
+ * @return              Lookups per second summed over every reader, 0 if
+ *                      the tree could not be built
+ */
+static double run_readers(size_t count, int readers, bool lock_free,
+                          double* insert_rate) {
+    Data_t* readings = malloc(count * sizeof(Data_t));
+
+    if (readings == NULL) {
+        return 0.0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        readings[i].timestamp = START_TIME + (time_t)i * CADENCE;
+        readings[i].temp = (uint32_t)(i & 0xFFFFF);
+        readings[i].humid = 0;
+    }
+
+    Tree_t* tree = build_tree_from_sorted(readings, count);
+    free(readings);
+
+    if (tree == NULL || (lock_free && !share_tree(tree))) {
+        delete_tree(tree);
+        return 0.0;
+    }
+
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    bool stop = false;
+    Worker_t writer = {tree, lock_free ? NULL : &lock, count, 0, 0, &stop, 0};
+    Worker_t workers[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    pthread_t writer_id;
+
+    for (int i = 0; i < readers; i++) {
+        workers[i] = writer;
+        workers[i].seed = 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1);
+    }
+
+    double start = now_seconds();
+
+    pthread_create(&writer_id, NULL, writer_thread, &writer);
+    for (int i = 0; i < readers; i++) {
+        pthread_create(&threads[i], NULL, reader_thread, &workers[i]);
+    }
+
+    for (int i = 0; i < readers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    __atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+    pthread_join(writer_id, NULL);
+
+    *insert_rate = writer.inserted / elapsed;
+
+    delete_tree(tree);
+
+    return (double)readers * READER_LOOKUPS / elapsed;
+}
+
+
+
+/**
+ * bench_readers() - times search() throughput as reader threads are added
+ *                   while one writer keeps inserting
+ *
+ * @param count   Number of readings to load before the threads start
+ */
+static void bench_readers(size_t count) {
+    printf("\nReaders with one writer at %.1fM readings (%ld CPUs online):\n",
+           count / 1e6, sysconf(_SC_NPROCESSORS_ONLN));
+
+    for (int readers = 1; readers <= MAX_THREADS; readers *= 2) {
+        double locked_inserts = 0.0;
+        double shared_inserts = 0.0;
+        double locked = run_readers(count, readers, false, &locked_inserts);
+        double shared = run_readers(count, readers, true, &shared_inserts);
+
+        printf("%3d reader%s: mutex %7.2f M lookups/s (%6.2f M inserts/s), "
+               "lock-free %7.2f M lookups/s (%6.2f M inserts/s)\n",
+               readers, (readers == 1) ? " " : "s",
+               locked / 1e6, locked_inserts / 1e6,
+               shared / 1e6, shared_inserts / 1e6);
+    }
+}
+
+
+
+/**
+ * collector_thread() - inserts readings from its sensors, polled in turn
+ *
+ * @param context   Collector_t for this thread
+ * @return          NULL
+ */
+static void* collector_thread(void* context) {
+    Collector_t* collector = (Collector_t*)context;
+
+    for (size_t i = 0; i < COLLECTOR_READINGS; i++) {
+        uint32_t sensor = collector->first_sensor + 
+                          (uint32_t)(i % SENSORS_PER_COLLECTOR);
+        Data_t reading = {START_TIME + (time_t)(i / SENSORS_PER_COLLECTOR) * 10,
+                          (uint32_t)(i & 0xFFFFF), sensor};
+
+        if (collector->tree != NULL) {
+            pthread_mutex_lock(collector->lock);
+            insert(collector->tree, reading);
+            pthread_mutex_unlock(collector->lock);
+        }
+        else {
+            shardset_insert(collector->set, sensor, reading);
+        }
+    }
+
+    return NULL;
+}
+
+
+
+/**
+ * run_collectors() - times collector threads inserting at once
+ *
+ * @param collectors    Number of collector threads
+ * @param sharded       true for a sharded set, false for one locked tree
+ * @return              Inserts per second over every collector, 0 if the
+ *                      tree or set could not be created
+ */
+static double run_collectors(int collectors, bool sharded) {
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    Tree_t* tree = sharded ? NULL : create_tree();
+    ShardSet_t* set = sharded ? create_shardset(BENCH_SHARDS, 3600) : NULL;
+
+    if (tree == NULL && set == NULL) {
+        return 0.0;
+    }
+
+    Collector_t workers[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+
+    for (int i = 0; i < collectors; i++) {
+        workers[i] = (Collector_t){tree, &lock, set,
+                                   (uint32_t)(i * SENSORS_PER_COLLECTOR)};
+    }
+
+    double start = now_seconds();
+
+    for (int i = 0; i < collectors; i++) {
+        pthread_create(&threads[i], NULL, collector_thread, &workers[i]);
+    }
+    for (int i = 0; i < collectors; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    double elapsed = now_seconds() - start;
+    size_t stored = sharded ? shardset_count(set) : (size_t)tree->node_count;
+
+    delete_tree(tree);
+    delete_shardset(set);
+
+    if (stored != (size_t)collectors * COLLECTOR_READINGS) {
+        printf("ERROR(run_collectors()): Stored %zu readings\n", stored);
+    }
+
+    return (double)collectors * COLLECTOR_READINGS / elapsed;
+}
+
+
+
+/**
+ * bench_ingest() - times inserts as collector threads are added, into one
+ *                  tree behind a mutex and into a sharded set
+ */
+static void bench_ingest(void) {
+    printf("\nIngest with %d sensors per collector (%ld CPUs online):\n",
+           SENSORS_PER_COLLECTOR, sysconf(_SC_NPROCESSORS_ONLN));
+
+    for (int collectors = 1; collectors <= MAX_THREADS; collectors *= 2) {
+        double locked = run_collectors(collectors, false);
+        double sharded = run_collectors(collectors, true);
+
+        printf("%3d collector%s: one tree %7.2f M inserts/s, "
+               "%d shards %7.2f M inserts/s (%.2fx)\n",
+               collectors, (collectors == 1) ? " " : "s",
+               locked / 1e6, BENCH_SHARDS, sharded / 1e6, sharded / locked);
+    }
+}
+
+
+
+/**
+ * bench_snapshot() - times getting a searchable index at startup by
+ *                    rebuilding the tree and by mapping a saved snapshot
+ *
+ * The rebuild starts from readings already in memory, so it is a lower bound
+ * on a real restart that also has to read or collect them.
+ *
+ * @param count   Number of readings to load
+ */
+static void bench_snapshot(size_t count) {
+    const char* path = "bench_bst_snapshot.bin";
+    Data_t* readings = malloc(count * sizeof(Data_t));
+    time_t* keys = malloc(LOOKUPS * sizeof(time_t));
+
+    if (readings == NULL || keys == NULL) {
+        printf("ERROR(bench_snapshot()): Out of memory for %zu readings\n", 
+               count);
+        free(readings);
+        free(keys);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        readings[i].timestamp = START_TIME + (time_t)i * CADENCE;
+        readings[i].temp = (uint32_t)(i & 0xFFFFF);
+        readings[i].humid = 0;
+    }
+
+    uint64_t state = 0xDA942042E4DD58B5ULL;
+
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        keys[i] = START_TIME + (time_t)(next_random(&state) % count) * CADENCE;
+    }
+
+    double start = now_seconds();
+    Tree_t* tree = build_tree_from_sorted(readings, count);
+    double build_time = now_seconds() - start;
+
+    free(readings);
+
+    start = now_seconds();
+    bool saved = tree_save(tree, path);
+    double save_time = now_seconds() - start;
+
+    delete_tree(tree);
+
+    start = now_seconds();
+    Frozen_t* mapped = saved ? tree_open_mmap(path) : NULL;
+    double open_time = now_seconds() - start;
+
+    if (mapped == NULL) {
+        printf("ERROR(bench_snapshot()): Could not save and map %s\n", path);
+        remove(path);
+        free(keys);
+        return;
+    }
+
+    uint64_t sum = 0;
+
+    start = now_seconds();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        sum += frozen_search(mapped, keys[i])->temp;
+    }
+    double search_time = now_seconds() - start;
+
+    printf("\nStartup at %.1fM readings: rebuild %8.2f ms, save %8.2f ms, "
+           "open snapshot %8.3f ms, then %6.1f ns/lookup%s\n",
+           count / 1e6,
+           build_time * 1e3,
+           save_time * 1e3,
+           open_time * 1e3,
+           search_time * 1e9 / LOOKUPS,
+           (sum != 0) ? "" : "  (MISMATCH)");
+
+    delete_frozen(mapped);
+    remove(path);
+    free(keys);
+}
+
+
+
+/**
+ * bench_wal() - times insert() with no log and with a write-ahead log at
+ *               several group commit sizes
+ *
+ * A commit size of 1 is one fsync() per reading, what the log would cost
+ * without group commit.
+ */
+static void bench_wal(void) {
+    const char* path = "bench_bst_wal.log";
+    size_t batches[] = {0, 1, 64, 4096};
+
+    printf("\nLogged inserts of %d readings:\n", WAL_INSERTS);
+
+    for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+        Tree_t* tree = create_tree();
+        Wal_t* wal = (batches[b] > 0) ? wal_open(path, batches[b], 0) : NULL;
+
+        if (tree == NULL || (batches[b] > 0 && wal == NULL)) {
+            printf("ERROR(bench_wal()): Could not create tree or log\n");
+            delete_tree(tree);
+            wal_close(wal);
+            remove(path);
+            return;
+        }
+
+        tree_attach_wal(tree, wal);
+
+        double start = now_seconds();
+        for (size_t i = 0; i < WAL_INSERTS; i++) {
+            Data_t reading = {START_TIME + (time_t)i * CADENCE, 
+                              (uint32_t)i, 0};
+            insert(tree, reading);
+        }
+        if (wal != NULL) {
+            wal_close(wal);
+        }
+        double elapsed = now_seconds() - start;
+
+        if (batches[b] == 0) {
+            printf("  no log           %9.1f ns/insert\n", 
+                   elapsed * 1e9 / WAL_INSERTS);
+        }
+        else {
+            printf("  commit every %4zu %9.1f ns/insert\n", batches[b],
+                   elapsed * 1e9 / WAL_INSERTS);
+        }
+
+        delete_tree(tree);
+        remove(path);
+    }
+}
+
+
+
+/**
+ * bench_load() - times ingest_file() on a CSV file and a binary file of the
+ *                same readings
+ *
+ * The files are written first, so they are likely in the page cache and the
+ * times are for parsing and building the tree rather than the disk.
+ *
+ * @param count   Number of readings to load
+ */
+static void bench_load(size_t count) {
+    const char* path = "bench_bst_ingest.dat";
+    IngestFormat_t formats[] = {INGEST_CSV, INGEST_BINARY};
+
+    printf("\nLoading %.1fM readings from a file:\n", count / 1e6);
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        FILE* file = fopen(path, "wb");
+
+        if (file == NULL) {
+            printf("ERROR(bench_load()): Could not create %s\n", path);
+            return;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            Data_t reading = {START_TIME + (time_t)i * CADENCE,
+                              (uint32_t)(i & 0xFFFFF), 
+                              (uint32_t)((i * 7) & 0xFFFFF)};
+
+            if (formats[f] == INGEST_CSV) {
+                fprintf(file, "%lld,0x%05X,0x%05X\n", 
+                        (long long)reading.timestamp, 
+                        (unsigned)reading.temp, (unsigned)reading.humid);
+            }
+            else {
+                fwrite(&reading, sizeof(reading), 1, file);
+            }
+        }
+        fclose(file);
+
+        double start = now_seconds();
+        Tree_t* tree = ingest_file(path, formats[f]);
+        double elapsed = now_seconds() - start;
+
+        if (tree == NULL || tree->node_count != (int)count) {
+            printf("ERROR(bench_load()): Could not load %s\n", path);
+        }
+        else {
+            printf("  %-6s %8.2f ms, %6.1fM readings/s\n",
+                   (formats[f] == INGEST_CSV) ? "csv" : "binary",
+                   elapsed * 1e3, count / elapsed / 1e6);
+        }
+
+        delete_tree(tree);
+        remove(path);
+    }
+}
+
+
+
+/**
+ * bench_export() - times writing the reading table to /dev/null with the
+ *                  strftime() and printf() loop in_order() used to run and
+ *                  with tree_export()
+ *
+ * Readings are 15 minutes apart, so 96 share each date.
+ *
+ * @param count   Number of readings to load
+ */
+static void bench_export(size_t count) {
+    Data_t* readings = malloc(count * sizeof(Data_t));
+
+    if (readings == NULL) {
+        printf("ERROR(bench_export()): Out of memory for %zu readings\n", 
+               count);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        readings[i].timestamp = START_TIME + (time_t)i * 900;
+        readings[i].temp = (uint32_t)(i & 0xFFFFF);
+        readings[i].humid = (uint32_t)((i * 7) & 0xFFFFF);
+    }
+
+    Tree_t* tree = build_tree_from_sorted(readings, count);
+    FILE* sink = fopen("/dev/null", "w");
+    int fd = open("/dev/null", O_WRONLY);
+
+    free(readings);
+
+    if (tree == NULL || sink == NULL || fd < 0) {
+        printf("ERROR(bench_export()): Could not set up the export\n");
+        delete_tree(tree);
+        if (sink != NULL) {
+            fclose(sink);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    TreeIter_t iter;
+    const Data_t* reading;
+
+    double start = now_seconds();
+    tree_iter_begin(&iter, tree);
+    while ((reading = tree_iter_next(&iter)) != NULL) {
+        char date_str[26];
+
+        strftime(date_str, sizeof(date_str), "%d-%b-%Y", 
+                 localtime(&reading->timestamp));
+        fprintf(sink, "%s     %08X %08X\n", 
+                date_str, reading->temp, reading->humid);
+    }
+    tree_iter_end(&iter);
+    fflush(sink);
+    double printf_time = now_seconds() - start;
+
+    start = now_seconds();
+    bool written = tree_export(tree, fd);
+    double export_time = now_seconds() - start;
+
+    printf("\nExporting %.1fM readings: printf %8.2f ms, tree_export %8.2f ms"
+           "%s\n",
+           count / 1e6,
+           printf_time * 1e3,
+           export_time * 1e3,
+           written ? "" : "  (WRITE FAILED)");
+
+    fclose(sink);
+    close(fd);
+    delete_tree(tree);
+}
+
+
+
+/**
+ * sum_reading() - range scan callback adding up temperatures
+ */
+static bool sum_reading(const Data_t* reading, void* context) {
+    *(uint64_t*)context += reading->temp;
+
+    return true;
+}
+
+
+
+/**
+ * bench_archive() - compares the memory and full range scan time of the tree
+ *                   with the compressed archive
+ *
+ * Readings are daily and both values wander by a few counts per reading, as
+ * real AHT20 readings do, so the value codes stay short.
+ *
+ * @param count   Number of readings to load
+ */
+static void bench_archive(size_t count) {
+    Data_t* readings = malloc(count * sizeof(Data_t));
+
+    if (readings == NULL) {
+        printf("ERROR(bench_archive()): Out of memory for %zu readings\n", 
+               count);
+        return;
+    }
+
+    uint64_t state = 0x853C49E6748FEA9BULL;
+    uint32_t temp = 0x7AF2E;
+    uint32_t humid = 0xD8E24;
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t step = next_random(&state);
+
+        temp = (temp + (uint32_t)(step & 0x3F) - 32) & 0xFFFFF;
+        humid = (humid + (uint32_t)((step >> 8) & 0x3F) - 32) & 0xFFFFF;
+
+        readings[i].timestamp = START_TIME + (time_t)i * CADENCE;
+        readings[i].temp = temp;
+        readings[i].humid = humid;
+    }
+
+    Tree_t* tree = build_tree_from_sorted(readings, count);
+
+    free(readings);
+
+    double start = now_seconds();
+    Archive_t* archive = (tree != NULL) ? archive_tree(tree) : NULL;
+    double build_time = now_seconds() - start;
+
+    if (archive == NULL) {
+        printf("ERROR(bench_archive()): Could not build the archive\n");
+        delete_tree(tree);
+        return;
+    }
+
+    time_t last = START_TIME + (time_t)(count - 1) * CADENCE;
+    uint64_t tree_sum = 0;
+    uint64_t archive_sum = 0;
+
+    start = now_seconds();
+    search_range(tree, START_TIME, last, sum_reading, &tree_sum);
+    double tree_time = now_seconds() - start;
+
+    start = now_seconds();
+    archive_search_range(archive, START_TIME, last, sum_reading, &archive_sum);
+    double archive_time = now_seconds() - start;
+
+    printf("\nArchive of %.1fM readings: tree %6.1f bytes/reading, archive "
+           "%5.2f bytes/reading (%.0fx), built in %8.2f ms\n"
+           "  full range scan: tree %8.2f ms, archive %8.2f ms%s\n",
+           count / 1e6,
+           (double)sizeof(Node_t),
+           (double)archive_bytes(archive) / count,
+           sizeof(Node_t) * (double)count / archive_bytes(archive),
+           build_time * 1e3,
+           tree_time * 1e3,
+           archive_time * 1e3,
+           (tree_sum == archive_sum) ? "" : "  (MISMATCH)");
+
+    delete_archive(archive);
+    delete_tree(tree);
+}
+
+
+
+/**
+ * draw_thread() - random reading benchmark thread, draws temperature and
+ *                 humidity pairs the way _iom361_set_sensor1_rndm() does
+ *
+ * @param context   Drawer_t for this thread
+ */
+static void* draw_thread(void* context) {
+    Drawer_t* drawer = (Drawer_t*)context;
+    Rndm_t rng;
+    double sum = 0.0;
+
+    rndm_seed(&rng, drawer->seed);
+
+    for (int i = 0; i < RNDM_DRAWS; i++) {
+        if (drawer->engine) {
+            sum += rndm_in_range(&rng, 50.0, 85.0);
+            sum += rndm_in_range(&rng, 40.0, 85.0);
+        }
+        else {
+            // float_rand_in_range() before it had its own generator
+            sum += 50.0 + 35.0 * ((double)rand() / RAND_MAX);
+            sum += 40.0 + 45.0 * ((double)rand() / RAND_MAX);
+        }
+    }
+
+    drawer->sum = sum;
+
+    return NULL;
+}
+
+
+
+/**
+ * run_drawers() - draws random readings on several threads at once
+ *
+ * @param threads   Number of drawing threads
+ * @param engine    True to give each thread its own generator
+ * @return          readings drawn per second by all threads
+ */
+static double run_drawers(int threads, bool engine) {
+    pthread_t ids[MAX_THREADS];
+    Drawer_t drawers[MAX_THREADS];
+    double start = now_seconds();
+
+    for (int i = 0; i < threads; i++) {
+        drawers[i].engine = engine;
+        drawers[i].seed = (uint64_t)i + 1;
+        pthread_create(&ids[i], NULL, draw_thread, &drawers[i]);
+    }
+
+    for (int i = 0; i < threads; i++) {
+        pthread_join(ids[i], NULL);
+    }
+
+    return (double)threads * RNDM_DRAWS / (now_seconds() - start);
+}
+
+
+
+/**
+ * bench_rndm() - times drawing random sensor readings as threads are added,
+ *                sharing rand() and each with its own generator
+ */
+static void bench_rndm(void) {
+    printf("\nRandom readings, %d per thread (%ld CPUs online):\n",
+           RNDM_DRAWS, sysconf(_SC_NPROCESSORS_ONLN));
+
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        double shared = run_drawers(threads, false);
+        double engine = run_drawers(threads, true);
+
+        printf("%3d thread%s: rand() %7.2f M readings/s, "
+               "xoshiro256** %7.2f M readings/s (%.2fx)\n",
+               threads, (threads == 1) ? " " : "s",
+               shared / 1e6, engine / 1e6, engine / shared);
+    }
+}
+
+
+
+/**
+ * bench_batch() - times generating sensor register values a reading at a
+ *                 time, as _iom361_set_sensor1_rndm() does, and in batches
+ */
+static void bench_batch(void) {
+    uint32_t* temps = malloc(BATCH_READINGS * sizeof(uint32_t));
+    uint32_t* humids = malloc(BATCH_READINGS * sizeof(uint32_t));
+
+    if (temps == NULL || humids == NULL) {
+        printf("ERROR(bench_batch()): Out of memory for %d readings\n",
+               BATCH_READINGS);
+        free(temps);
+        free(humids);
+        return;
+    }
+
+    printf("\nSensor register values, %d readings:\n", BATCH_READINGS);
+
+    float_rand_seed(1);
+
+    double start = now_seconds();
+
+    for (int i = 0; i < BATCH_READINGS; i++) {
+        float temp = (float)float_rand_in_range(-40.0, 85.0);
+        float humid = (float)float_rand_in_range(0.0, 100.0);
+        float temp_float = 5242.88f * (temp + 50.0);
+        float humid_float = 10485.76f * humid;
+
+        temps[i] = (uint32_t)temp_float;
+        humids[i] = (uint32_t)humid_float;
+    }
+
+    double single = now_seconds() - start;
+
+    start = now_seconds();
+    iom361_generate_batch(-40.0f, 85.0f, 0.0f, 100.0f, temps, humids,
+                          BATCH_READINGS);
+
+    double batch = now_seconds() - start;
+    double bytes = 2.0 * BATCH_READINGS * sizeof(uint32_t);
+
+    printf("one at a time %7.2f M readings/s, batch %7.2f M readings/s "
+           "(%.1f GB/s, %.2fx)\n", BATCH_READINGS / single / 1e6,
+           BATCH_READINGS / batch / 1e6, bytes / batch / 1e9, single / batch);
+
+    free(temps);
+    free(humids);
+}
@@ -0,0 +1,223 @@
+/**
+ * @file        bst_epoch.c
+ * @brief
+ * Implements the epoch-based reclamation defined in bst_epoch.h.
+ *
+ * Readers announce the epoch they entered in their own slot, followed by a
+ * full fence so the announcement is visible before they load any shared
+ * pointer. The writer fences after unlinking memory and before scanning the
+ * slots, so a reader it does not see has to load the new pointers.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "bst_epoch.h"
+#include "bst_log.h"
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static bool limbo_grow(Limbo_t* list, size_t needed);
+static size_t limbo_release(Epoch_t* epoch, Limbo_t* list);
+
+
+
+/************************ API Function Implementations ************************/
+
+Epoch_t* create_epoch(Reclaim_t reclaim, void* context) {
+    if (reclaim == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(create_epoch()): No reclaim function given.\n");
+        return NULL;
+    }
+
+    Epoch_t* epoch = (Epoch_t*)calloc(1, sizeof(Epoch_t));
+
+    if (epoch == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(create_epoch()): Failed to allocate domain.\n");
+        return NULL;
+    }
+
+    epoch->global = 1;
+    epoch->reclaim = reclaim;
+    epoch->context = context;
+
+    return epoch;
+}
+
+
+
+int epoch_register(Epoch_t* epoch) {
+    int reader = __atomic_fetch_add(&epoch->reader_count, 1, __ATOMIC_ACQ_REL);
+
+    if (reader >= EPOCH_MAX_READERS) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(epoch_register()): All %d reader slots are taken.\n",
+                EPOCH_MAX_READERS);
+        return -1;
+    }
+
+    return reader;
+}
+
+
+
+void epoch_enter(Epoch_t* epoch, int reader) {
+    uint64_t global = __atomic_load_n(&epoch->global, __ATOMIC_ACQUIRE);
+
+    __atomic_store_n(&epoch->readers[reader].state, (global << 1) | 1,
+                     __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+
+
+void epoch_exit(Epoch_t* epoch, int reader) {
+    __atomic_store_n(&epoch->readers[reader].state, 0, __ATOMIC_RELEASE);
+}
+
+
+
+int epoch_retire(Epoch_t* epoch, void* memory) {
+    Limbo_t* list = &epoch->limbo[epoch->global % 3];
+
+    // Grows the list for this epoch if needed
+    if (!limbo_grow(list, list->count + 1)) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(epoch_retire()): Failed to grow limbo list.\n");
+        return -1;
+    }
+
+    list->items[list->count++] = memory;
+
+    if (list->count % EPOCH_RETIRE_BATCH == 0) {
+        epoch_synchronize(epoch);
+    }
+
+    return 0;
+}
+
+
+
+int epoch_reserve(Epoch_t* epoch, size_t count) {
+    // The epoch may advance between retirements, and the list it moves to
+    // has just been emptied, so every list needs the room
+    for (int i = 0; i < 3; i++) {
+        Limbo_t* list = &epoch->limbo[i];
+
+        if (!limbo_grow(list, list->count + count)) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(epoch_reserve()): Failed to grow limbo list.\n");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+
+size_t epoch_synchronize(Epoch_t* epoch) {
+    uint64_t global = epoch->global;
+    int readers = __atomic_load_n(&epoch->reader_count, __ATOMIC_ACQUIRE);
+
+    if (readers > EPOCH_MAX_READERS) {
+        readers = EPOCH_MAX_READERS;
+    }
+
+    // Orders the writer's unlinking before the scan of reader slots
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    // The epoch cannot move while a reader is still in an older one
+    for (int i = 0; i < readers; i++) {
+        uint64_t state = __atomic_load_n(&epoch->readers[i].state,
+                                         __ATOMIC_ACQUIRE);
+
+        if ((state & 1) != 0 && (state >> 1) != global) {
+            return 0;
+        }
+    }
+
+    __atomic_store_n(&epoch->global, global + 1, __ATOMIC_RELEASE);
+
+    // Readers are now in global or global + 1, so what was retired in
+    // global - 1 can no longer be reached. Its list is reused next epoch
+    return limbo_release(epoch, &epoch->limbo[(global + 2) % 3]);
+}
+
+
+
+void delete_epoch(Epoch_t* epoch) {
+    if (epoch == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        limbo_release(epoch, &epoch->limbo[i]);
+        free(epoch->limbo[i].items);
+    }
+
+    free(epoch);
+}
+
+
+
+/*********************** Helper Function Implementations **********************/
+
+/**
+ * limbo_grow() - makes room on a limbo list for a number of items
+ *
+ * @param list     List to grow
+ * @param needed   Number of items the list must be able to hold
+ * @return         true if the list can hold them, false if realloc failed
+ */
+static bool limbo_grow(Limbo_t* list, size_t needed) {
+    size_t capacity = (list->capacity == 0) ? EPOCH_RETIRE_BATCH
+                                            : list->capacity;
+
+    if (needed <= list->capacity) {
+        return true;
+    }
+
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    void** items = (void**)realloc(list->items, capacity * sizeof(void*));
+
+    if (items == NULL) {
+        return false;
+    }
+
+    list->items = items;
+    list->capacity = capacity;
+
+    return true;
+}
+
+
+
+/**
+ * limbo_release() - hands every item on a limbo list to the reclaim function
+ *
+ * @param epoch  Domain the list belongs to
+ * @param list   List to empty, its storage is kept for reuse
+ * @return       Number of items released
+ */
+static size_t limbo_release(Epoch_t* epoch, Limbo_t* list) {
+    size_t released = list->count;
+
+    for (size_t i = 0; i < list->count; i++) {
+        epoch->reclaim(list->items[i], epoch->context);
+    }
+
+    list->count = 0;
+
+    return released;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file        bst_epoch.h
+ * @brief
+ * Defines epoch-based reclamation for memory shared between one writer thread
+ * and any number of lock-free reader threads. A reader brackets each access
+ * with epoch_enter()/epoch_exit(). The writer hands memory it has unlinked to
+ * epoch_retire(), and it is only given back to the caller's free function
+ * once every reader that could still hold a pointer to it has exited.
+ *
+ * The global epoch only advances when every active reader has seen the
+ * current one, so memory retired two epochs ago can no longer be reached.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef BST_EPOCH_H
+#define BST_EPOCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Maximum number of reader threads that can register with one domain
+#define EPOCH_MAX_READERS   64
+
+// Retirements in the current epoch before the writer tries to advance it
+#define EPOCH_RETIRE_BATCH  256
+
+
+// Defines the function called to release memory once it is safe to
+typedef void (*Reclaim_t)(void* memory, void* context);
+
+
+
+// Defines one reader's announcement, padded to a cache line so readers do not
+// contend with each other. 0 when idle, otherwise (epoch << 1) | 1
+typedef struct epoch_reader_slot {
+    uint64_t state;
+    char padding[64 - sizeof(uint64_t)];
+} EpochSlot_t;
+
+
+
+// Defines a list of retired memory waiting for its epoch to expire
+typedef struct epoch_limbo_list {
+    void** items;       // Retired memory, in retirement order
+    size_t count;       // Number of entries in use
+    size_t capacity;    // Number of entries allocated
+} Limbo_t;
+
+
+
+// Defines a reclamation domain. Only the writer touches the limbo lists
+typedef struct epoch_domain {
+    uint64_t global;                        // Current epoch
+    int reader_count;                       // Slots handed out so far
+    EpochSlot_t readers[EPOCH_MAX_READERS]; // One announcement per reader
+    Limbo_t limbo[3];                       // Retired in epoch e go in e % 3
+    Reclaim_t reclaim;                      // Releases retired memory
+    void* context;                          // Passed through to reclaim
+} Epoch_t;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * create_epoch() - creates a reclamation domain
+ *
+ * @param	reclaim		function called on retired memory once it is safe
+ * @param	context		caller data passed through to reclaim
+ * @return				a pointer to the new domain or NULL if it fails
+ */
+Epoch_t* create_epoch(Reclaim_t reclaim, void* context);
+
+
+
+/**
+ * epoch_register() - claims a reader slot for the calling thread
+ *
+ * @param	epoch	pointer to the domain
+ * @return			slot number to pass to epoch_enter()/epoch_exit(), or -1
+ *					if all EPOCH_MAX_READERS slots are taken
+ *
+ * @note Safe to call from any thread. Slots are never given back, an idle
+ * slot does not hold up reclamation.
+ */
+int epoch_register(Epoch_t* epoch);
+
+
+
+/**
+ * epoch_enter() - marks the start of a read-side critical section
+ *
+ * @param	epoch	pointer to the domain
+ * @param	reader	slot returned by epoch_register()
+ *
+ * @note Memory reached after this call stays valid until epoch_exit().
+ * Critical sections must not nest.
+ */
+void epoch_enter(Epoch_t* epoch, int reader);
+
+
+
+/**
+ * epoch_exit() - marks the end of a read-side critical section
+ *
+ * @param	epoch	pointer to the domain
+ * @param	reader	slot returned by epoch_register()
+ */
+void epoch_exit(Epoch_t* epoch, int reader);
+
+
+
+/**
+ * epoch_retire() - queues memory that readers can no longer newly reach
+ *
+ * @param	epoch	pointer to the domain
+ * @param	memory	memory to release once no reader can hold it
+ * @return			0 on success, -1 if the limbo list could not grow
+ *
+ * @note Writer only. Tries to advance the epoch every EPOCH_RETIRE_BATCH
+ * retirements, which releases the memory retired two epochs earlier.
+ */
+int epoch_retire(Epoch_t* epoch, void* memory);
+
+
+
+/**
+ * epoch_reserve() - makes room for retirements that must not fail
+ *
+ * @param	epoch	pointer to the domain
+ * @param	count	number of epoch_retire() calls to make room for
+ * @return			0 on success, -1 if a limbo list could not grow
+ *
+ * @note Writer only. Call before unlinking the memory, while failing is
+ * still harmless. The next count calls to epoch_retire() then cannot fail,
+ * even if the epoch advances between them.
+ */
+int epoch_reserve(Epoch_t* epoch, size_t count);
+
+
+
+/**
+ * epoch_synchronize() - advances the epoch and releases what it can
+ *
+ * @param	epoch	pointer to the domain
+ * @return			number of retired items released
+ *
+ * @note Writer only. Does not wait, an item is released only once the epoch
+ * has advanced twice since it was retired.
+ */
+size_t epoch_synchronize(Epoch_t* epoch);
+
+
+
+/**
+ * delete_epoch() - frees a domain, releasing everything still retired
+ *
+ * @param	epoch	pointer to the domain.  No reader may be active
+ */
+void delete_epoch(Epoch_t* epoch);
+
+
+
+#endif
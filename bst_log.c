@@ -0,0 +1,36 @@
+/**
+ * @file        bst_log.c
+ * @brief
+ * Implements the run-time side of the leveled logging defined in bst_log.h.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#include "bst_log.h"
+
+
+
+/****************************** Global Variables ******************************/
+
+int bst_log_level = BST_LOG_LEVEL;
+
+
+
+/************************ API Function Implementations ************************/
+
+int bst_set_log_level(int level) {
+    int previous = bst_log_level;
+
+    if (level < BST_LOG_NONE) {
+        level = BST_LOG_NONE;
+    }
+    else if (level > BST_LOG_TRACE) {
+        level = BST_LOG_TRACE;
+    }
+
+    bst_log_level = level;
+
+    return previous;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file        bst_log.h
+ * @brief
+ * Defines leveled diagnostic logging for the Temperature/Humidity BST ADT.
+ * Every message has a level. A message is printed only if its level is at or
+ * below both the compile-time ceiling BST_LOG_LEVEL and the run-time level
+ * set with bst_set_log_level(). Building with -DBST_LOG_LEVEL=0 compiles all
+ * diagnostics out of the hot paths entirely, including the strftime() calls
+ * that format them.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef BST_LOG_H
+#define BST_LOG_H
+
+#include <stdio.h>
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Defines the log levels, each level includes the ones before it
+#define BST_LOG_NONE    0       // Nothing is printed
+#define BST_LOG_ERROR   1       // Invalid arguments and allocation failures
+#define BST_LOG_INFO    2       // Tree creation and other one-off events
+#define BST_LOG_TRACE   3       // Per-node detail such as search() paths
+
+// Compile-time ceiling, messages above it are removed by the compiler
+#ifndef BST_LOG_LEVEL
+#define BST_LOG_LEVEL   BST_LOG_TRACE
+#endif
+
+// True if messages at the given level are currently printed
+#define BST_LOG_ENABLED(level) \
+    ((level) <= BST_LOG_LEVEL && (level) <= bst_log_level)
+
+// Prints a printf() style message if its level is enabled
+#define BST_LOG(level, ...)                 \
+    do {                                    \
+        if (BST_LOG_ENABLED(level)) {       \
+            printf(__VA_ARGS__);            \
+        }                                   \
+    } while (0)
+
+
+
+/****************************** Global Variables ******************************/
+
+// Run-time log level, defaults to BST_LOG_LEVEL
+extern int bst_log_level;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * bst_set_log_level() - sets the run-time log level
+ *
+ * @param	level	one of BST_LOG_NONE through BST_LOG_TRACE.  Levels above
+ *					the compile-time BST_LOG_LEVEL have no effect
+ * @return			the previous run-time log level
+ */
+int bst_set_log_level(int level);
+
+
+
+#endif
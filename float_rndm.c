@@ -3,51 +3,82 @@
  *
  * Generates random floating point numbers within a specified range
  * Acknowledgement: Code by Thang Nguyen ( https://www.mycompiler.io/view/2go3N4CaLQJ )
+ *
+ * Numbers come from a rndm_engine generator owned by the calling thread
+ * instead of rand(), so threads never contend for (or corrupt) a shared
+ * generator.  Code that can hold its own Rndm_t should call rndm_in_range()
+ * directly.
  */
  
-#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "float_rndm.h"
+#include "rndm_engine.h"
+
+// seed for threads that have not drawn yet, 1 like rand() before srand()
+static uint64_t baseSeed = 1;
+
+// threads seeded so far, gives each thread its own sequence
+static uint64_t threadCount = 0;
+
+// generator for the calling thread
+static __thread Rndm_t threadRng;
+static __thread bool threadSeeded = false;
+
 
 /**
- * Generate positive random floating point number
- * NOTE: we do not care if a > b & vice versa
+ * Return the calling thread's generator, seeding it on first use
  */
-double positive_float_rand_in_range(double pos_a, double pos_b) {
-	double pos_start, pos_end, float_rand;
+static Rndm_t* thread_rng(void) {
+	if (!threadSeeded) {
+		uint64_t seed = __atomic_load_n(&baseSeed, __ATOMIC_RELAXED);
+		uint64_t thread = __atomic_fetch_add(&threadCount, 1, __ATOMIC_RELAXED);
 
-	// Random number within [start, end] */
-	if (pos_a >= pos_b) {
-		pos_start = pos_b;
-		pos_end = pos_a;
-	}
-	else {
-		pos_start = pos_a;
-		pos_end = pos_b;
+		// offset 0 is the seed itself, kept for the thread that called
+		// float_rand_seed(), so no thread seeded here can repeat its sequence
+		rndm_seed(&threadRng, seed + (thread + 1) * 0x9E3779B97F4A7C15ULL);
+		threadSeeded = true;
 	}
 
-	// Random float in [a, b] = a + random float in [0, b - a], with c = b - a.
-	// Random float in [0, c] = c * random float in [0, 1].
-	// Random float in [0, 1] = random int / RAND_MAX
-	float_rand = pos_start + (pos_end - pos_start) * ((double)rand() / RAND_MAX);
-	return float_rand;
+	return &threadRng;
 }
 
 
 /**
- * Generate positive or negative random float number
+ * Return the calling thread's generator, for callers that draw in bulk
+ */
+Rndm_t* float_rand_engine(void) {
+	return thread_rng();
+}
+
+
+/**
+ * Seed the generators, the replacement for srand()
+ * NOTE: reseeds the calling thread, other threads that have already drawn
+ * keep their sequences
+ */
+void float_rand_seed(unsigned int seed) {
+	__atomic_store_n(&baseSeed, seed, __ATOMIC_RELAXED);
+	rndm_seed(&threadRng, seed);
+	threadSeeded = true;
+}
+
+
+/**
+ * Generate positive random floating point number
  * NOTE: we do not care if a > b & vice versa
  */
-double float_rand_in_range(double a, double b) {
-	// Process input to generate random float in positive range, then process output
-	if (a < 0 && b < 0) {
-		return -positive_float_rand_in_range(-a, -b);
-	}
-	else if (a < 0 && b > 0) {
-		// Random float in [-x, y] = random float in [0, y + x] - x, with x positive
-		return positive_float_rand_in_range(-a, b) - (-a);
-	}
-	else {
-		// a > 0 && b > 0
-		return positive_float_rand_in_range(a, b);
-	}
+double positive_float_rand_in_range(double pos_a, double pos_b) {
+	return rndm_in_range(thread_rng(), pos_a, pos_b);
 }
 
+
+/**
+ * Generate positive or negative random float number
+ * NOTE: we do not care if a > b & vice versa.  The mapping from [0, 1] onto
+ * [a, b] holds for any signs, so no case is needed for negative ranges
+ */
+double float_rand_in_range(double a, double b) {
+	return rndm_in_range(thread_rng(), a, b);
+}
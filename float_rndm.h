@@ -3,13 +3,19 @@
  *
  * Generates random floating point numbers within a specified range
  * Acknowledgement: Code by Thang Nguyen ( https://www.mycompiler.io/view/2go3N4CaLQJ )
+ *
+ * Safe to call from any number of threads, each draws from its own generator
  */
  
  #ifndef _FLOAT_RNDM_H
  #define _FLOAT_RNDM_H
  
+ #include "rndm_engine.h"
+ 
  // function prototypes
+ Rndm_t* float_rand_engine(void);
+ void float_rand_seed(unsigned int seed);
  double positive_float_rand_in_range(double pos_a, double pos_b);
  double float_rand_in_range(double a, double b);
  
- #endif
\ No newline at end of file
+ #endif
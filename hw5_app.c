@@ -6,11 +6,19 @@
  * to search for specific data entries, and displays an ordered table of all the
  * readings. Uses the iom361_r2 IO module and C time library.
  *
+ * Run with no arguments to be prompted for the start date and time span, or
+ * load logged readings instead:
+ *   hw5_app -csv <file>    lines of timestamp,temp,humid
+ *   hw5_app -bin <file>    raw Data_t records
+ * where <file> is "-" to read from a pipe on stdin.
+ *
  * @version     1.0.0
  * @author      Danny V. Restrepo (restrepo@pdx.edu)
  * @date        06-Dec-2024
  */
 
+#define _XOPEN_SOURCE 700
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +26,7 @@
 #include <errno.h>
 #include <time.h>
 #include "temp_humid_bst.h"
+#include "temp_humid_ingest.h"
 #include "iom361_r2.h"
 
 
@@ -25,47 +34,59 @@
 /**************************** Function Prototypes *****************************/
 
 static void greeting(void);
-static void shuffle(Data_t* array, size_t n);
-void populateBST(Tree_t* tree, int month, int day, int num_days);
+Tree_t* populateBST(int month, int day, int num_days);
+Tree_t* loadBST(const char* option, const char* path);
 
 
 
 /************************************ Main ************************************/
 
-int main() {
+int main(int argc, char* argv[]) {
     int start_month, start_day, num_days;
+    Tree_t* tree;
     
     // Displays program introduction and current working directory
     greeting();
 
-    // Creates and initializes the BST
-    Tree_t* tree = create_tree();
-    if (tree == NULL) {
-        printf("ERROR(main()): Failed to create tree\n");
-        return 1;
+    if (argc == 3) {
+        // Loads logged readings from a file or pipe
+        tree = loadBST(argv[1], argv[2]);
+        if (tree == NULL) {
+            printf("ERROR(main()): Failed to load %s\n", argv[2]);
+            return 1;
+        }
     }
+    else if (argc == 1) {
+        // Get input parameters from user
+        printf("Enter the starting month (1 to 12),day (1 to 31), "
+               "and number of days (1 to 100): ");
+        if (scanf("%d,%d,%d", &start_month, &start_day, &num_days) != 3) {
+            printf("ERROR(main()): Invalid input format\n");
+            return 1;
+        }
 
-    // Get input parameters from user
-    printf("Enter the starting month (1 to 12),day (1 to 31), "
-           "and number of days (1 to 100): ");
-    if (scanf("%d,%d,%d", &start_month, &start_day, &num_days) != 3) {
-        printf("ERROR(main()): Invalid input format\n");
-        delete_tree(tree);
-        return 1;
-    }
+        printf("User requested %d data items starting at %2d/%2d/2023\n",
+               num_days, start_month, start_day);
 
-    printf("User requested %d data items starting at %2d/%2d/2023\n",
-           num_days, start_month, start_day);
+        // Creates and populates the BST with random readings
+        tree = populateBST(start_month, start_day, num_days);
+        if (tree == NULL) {
+            printf("ERROR(main()): Failed to create tree\n");
+            return 1;
+        }
 
-    // Populates the BST with random readings
-    populateBST(tree, start_month, start_day, num_days);
+        // Gets rid of newline from scanf
+        getchar();
+    }
+    else {
+        printf("Usage: %s [-csv <file> | -bin <file>], "
+               "<file> - reads stdin\n", argv[0]);
+        return 1;
+    }
 
-    // Processes search requests
+    // Processes search requests, none if the readings were piped in on stdin
     char date_input[20];
 
-    // Gets rid of newline from scanf
-    getchar();
-
     while (1) {
         printf("\nEnter a search date (mm/dd/yyyy): ");
         if (fgets(date_input, sizeof(date_input), stdin) == NULL || 
@@ -80,12 +101,21 @@ int main() {
             continue;
         }
         
-        // Sets time to 1 PM to match data
-        search_time.tm_hour = 13;
+        // Spans the whole search date, from midnight to the next midnight
+        search_time.tm_isdst = -1;
         time_t search_timestamp = mktime(&search_time);
 
-        // Searches the BST
-        Node_t* result = search(tree, search_timestamp);
+        search_time.tm_mday++;
+        search_time.tm_isdst = -1;
+        time_t next_day_timestamp = mktime(&search_time);
+
+        // Searches the BST for the first reading taken on or after the date,
+        // whatever time of day it was sampled at
+        Node_t* result = search_ceil(tree, search_timestamp);
+
+        if (result != NULL && result->data.timestamp >= next_day_timestamp) {
+            result = NULL;
+        }
         
         char date_str[26];
         strftime(date_str, sizeof(date_str), "%d-%b-%Y", 
@@ -147,28 +177,27 @@ static void greeting(void) {
 
 
 /**
- * populateBST() - Populates the binary search tree with randomly generated 
- *                 temperature and humidity data.
+ * populateBST() - Builds a binary search tree populated with randomly
+ *                 generated temperature and humidity data.
  *
  * Uses the C time library mktime(), iom361_setSensor1_rndm() and 
- * iom361_readReg() functions from the iom361_r2 module library provided to us
+ * iom361_readSensor1() functions from the iom361_r2 module library provided to us
  * Prof. Kravitz to generate random temperature and humidity readings. Each 
  * reading is assigned a timestamp based on a user-provided starting date 
- * (month and day) and the number of designated days. The data is then inserted
- * into the binary search tree in a randomized order to maintain the optimal
- * performance of the BST as described in the lecture slides.
+ * (month and day) and the number of designated days. The readings are
+ * generated in timestamp order, so the whole batch is bulk loaded into a
+ * perfectly balanced tree in one linear pass.
  *
- * @param tree          Pointer to the binary search tree to be populated
  * @param month         Represents the starting month for the data (1 - 12)
  * @param day           Represents the starting day for the data (1 - 31)
  * @param num_days      Represents number of days of data to generate (1 - 100)
+ * @return              Pointer to the populated tree, NULL on failure
  */
-void populateBST(Tree_t* tree, int month, int day, int num_days) {
+Tree_t* populateBST(int month, int day, int num_days) {
     // Validates input parameters
-    if (tree == NULL || month < 1 || month > 12 || 
-        day < 1 || day > 31 || num_days < 1) {
+    if (month < 1 || month > 12 || day < 1 || day > 31 || num_days < 1) {
         printf("ERROR(populateBST()): Invalid parameters\n");
-        return;
+        return NULL;
     }
 
     // Initializes iom361
@@ -177,18 +206,14 @@ void populateBST(Tree_t* tree, int month, int day, int num_days) {
     
     if (base == NULL || rtn_code != 0) {
         printf("ERROR(populateBST()): Failed to initialize iom361.\n");
-        return;
+        return NULL;
     }
 
-    // Creates array to track original indices
-    int* indices = malloc(num_days * sizeof(int));
     Data_t* readings = malloc(num_days * sizeof(Data_t));
 
-    if (!indices || !readings) {
-        free(indices);
-        free(readings);
+    if (!readings) {
         printf("ERROR(populateBST()): Memory allocation failed.\n");
-        return;
+        return NULL;
     }
 
     // Initializes time structure for starting date
@@ -200,68 +225,71 @@ void populateBST(Tree_t* tree, int month, int day, int num_days) {
 
     time_t current_time = mktime(&start_time);
     
-    // Generates readings and indices
+    // Generates readings
     for (int i = 0; i < num_days; i++) {
         readings[i].timestamp = current_time;
-
-        // Tracks original position
-        indices[i] = i;
         
+        // Reads temperature and humidity as one pair in one call
         _iom361_setSensor1_rndm(50.0, 85.0, 40.0, 85.0);
-        readings[i].temp = iom361_readReg(base, TEMP_REG, &rtn_code);
-        readings[i].humid = iom361_readReg(base, HUMID_REG, &rtn_code);
+        iom361_readSensor1(base, &readings[i].temp, &readings[i].humid);
         
         current_time += 86400;
     }
 
-    // Shuffles both arrays together
-    srand(time(NULL));
-    for (int i = num_days - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-
-        // Swaps readings
-        Data_t temp_reading = readings[i];
-        readings[i] = readings[j];
-        readings[j] = temp_reading;
-
-        // Swaps corresponding indices
-        int temp_index = indices[i];
-        indices[i] = indices[j];
-        indices[j] = temp_index;
-    }
-
-    // Inserts shuffled readings while preserving original indices
+    // Bulk loads the readings, already sorted by timestamp
     for (int i = 0; i < num_days; i++) {
         printf("INFO(main()): added timestamp %ld from data[%d] to BST\n", 
-               readings[i].timestamp, indices[i]);
-
-        insert(tree, readings[i]);
+               readings[i].timestamp, i);
     }
 
-    free(indices);
+    Tree_t* tree = build_tree_from_sorted(readings, num_days);
+
     free(readings);
+
+    return tree;
 }
 
 
 
 /**
- * @brief Shuffles an array of Data_t elements randomly
+ * loadBST() - Builds a binary search tree from logged temperature and
+ *             humidity readings.
  *
- * Uses the Fisher-Yates shuffle algorithm to randomize array order in order to
- * optimize BST performance, as described in the lecture slides.
+ * Uses ingest_file() from the temp_humid_ingest module, which reads the
+ * input in large blocks and bulk loads every reading at once, then reports
+ * how long the load took.
  *
- * @param array     Pointer to array of Data_t elements to shuffle
- * @param n         Number of elements in the array
+ * @param option        Represents the input format, "-csv" or "-bin"
+ * @param path          Represents the file to read, "-" for stdin
+ * @return              Pointer to the populated tree, NULL on failure
  */
-static void shuffle(Data_t* array, size_t n) {
-    if (n > 1) {
-        for (size_t i = 0; i < n - 1; i++) {
-            size_t j = i + rand() / (RAND_MAX / (n - i) + 1);
+Tree_t* loadBST(const char* option, const char* path) {
+    IngestFormat_t format;
+
+    if (strcmp(option, "-csv") == 0) {
+        format = INGEST_CSV;
+    }
+    else if (strcmp(option, "-bin") == 0) {
+        format = INGEST_BINARY;
+    }
+    else {
+        printf("ERROR(loadBST()): Unknown option %s, use -csv or -bin\n",
+               option);
+        return NULL;
+    }
 
-            Data_t temp = array[j];
+    struct timespec start, stop;
 
-            array[j] = array[i];
-            array[i] = temp;
-        }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Tree_t* tree = ingest_file(path, format);
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+
+    if (tree != NULL) {
+        double ms = (stop.tv_sec - start.tv_sec) * 1e3 +
+                    (stop.tv_nsec - start.tv_nsec) / 1e6;
+
+        printf("Loaded %d readings in %.1f ms\n", tree->node_count, ms);
     }
-}
\ No newline at end of file
+
+    return tree;
+}
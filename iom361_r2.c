@@ -17,103 +17,286 @@
  #include <stdio.h>
  #include <math.h>
  #include <time.h>
+ #include <string.h>
  
  #include "float_rndm.h"
+ #include "rndm_engine.h"
  #include "iom361_r2.h"
  
+ #if defined(__AVX2__)
+ #include <immintrin.h>
+ #elif defined(__SSE2__)
+ #include <emmintrin.h>
+ #endif
+ 
  // constants
  //#define _DEBUG_ 1
+ #define BATCH_LANES	4		// generators interleaved by iom361_generate_batch()
+ 
+ // Defines one emulated board: its register file and how many switches
+ // and LEDs it has.  Nothing else is kept between calls, so boards are
+ // independent and each can be driven by its own thread
+ struct iom361 {
+	uint32_t	regs[sizeof(ioreg_t) / sizeof(uint32_t)];	// I/O registers
+	int			nsw;					// number of switches
+	int			nleds;					// number of LEDs
+	uint32_t	sensorSeq;				// odd while Sensor 1 is being updated
+	Rndm_t		rng;					// draws random sensor readings
+ };
  
  // global variables
- static uint32_t IOSpace[sizeof(ioreg_t)/ sizeof(uint32_t)];
- static uint32_t* IOSpacePtr;
- static int nsw;						// number of switches
- static int nleds;						// number of LEDs
- static bool isInitialized = false;		// true if IOM361 has been initialized
- static uint32_t errValue = 0xDEADBEEF;	// value returned on error
+ static iom361_t defaultBoard;			// board behind the original API
+ static const uint32_t errValue = 0xDEADBEEF;	// value returned on error
+ static uint64_t boardCount = 0;		// boards set up, spreads their seeds
+ static const float tempConst = 5242.88f;	// (2^20) / 200.0 = 1048576 / 200.0
+ static const float rhConst = 10485.76f;	// (2^20) / 100.0 = 1048576 / 100.0
+ static const double unitScale = 1.0 / 4503599627370496.0;	// 2^-52
+ 
+ // Defines the generators behind iom361_generate_batch(), xoshiro256** state
+ // word w of lane k is s[w][k] so that a vector holds one word of every lane
+ typedef struct {
+	uint64_t	s[4][BATCH_LANES];
+ } batch_rng_t;
+ 
+ // Defines the ranges of a batch, as doubles like float_rand_in_range() uses
+ typedef struct {
+	double		temp_low, temp_span;
+	double		humid_low, humid_span;
+ } batch_range_t;
  
  // Helper function prototypes
+ static void init_board(iom361_t* iom, int num_switches, int num_leds);
  static void display_leds(uint32_t value, int num_leds);
  static void display_rgb_leds(uint32_t value);
+ static void batch_group(batch_rng_t* rng, const batch_range_t* range,
+	uint32_t* temps, uint32_t* humids);
+ static size_t batch_vector(batch_rng_t* rng, const batch_range_t* range,
+	uint32_t* temps, uint32_t* humids, size_t n);
  
  // API functions
  
  /* iom361_initialize() */
  uint32_t* iom361_initialize(int num_switches, int num_leds, int* rtn_code) {
-	// initialize global variables
-	nsw = num_switches;
-	nleds = num_leds;
-	IOSpacePtr = (uint32_t*) &IOSpace;
+	init_board(&defaultBoard, num_switches, num_leds);
 	
 	#ifdef _DEBUG_
 		printf("INFO [iom361_initialize()]: IOSpacePtr=%p, IOSpace Length=%d\n",
-			IOSpacePtr, sizeof(IOSpace));
+			defaultBoard.regs, (int) sizeof(defaultBoard.regs));
 	#endif
 	
-	// initialize the I/O registers
-	iom361_writeReg(IOSpacePtr, LEDS_REG, 0x00000000, NULL);
-	iom361_writeReg(IOSpacePtr, RGB_LED_REG, 0x00000000, NULL);
-	iom361_writeReg(IOSpacePtr, RSVD1_REG, 0x11111111, NULL);
-	iom361_writeReg(IOSpacePtr, RSVD2_REG, 0x22222222, NULL);
-	iom361_writeReg(IOSpacePtr, RSVD3_REG, 0x33333333, NULL);
-		
-	_iom361_setSwitches(0x00000000);
-	_iom361_setSensor1(23.5, 75.0);
-	
-	// randomize rand()
-	srand(time(NULL));
+	// randomize float_rand_in_range()
+	float_rand_seed(time(NULL));
 	
 	if (rtn_code != NULL)
 		*rtn_code = 0;
-	isInitialized = true;
-	return IOSpacePtr;
+	return defaultBoard.regs;
  }
  
  /* iom361_readReg(g) */
  uint32_t iom361_readReg(uint32_t* base, uint32_t offset, int* rtn_code) {
+	if (base != defaultBoard.regs) {
+		// not pointing to base of IO space
+		if (rtn_code != NULL)
+			*rtn_code = 1;
+		return errValue;
+	}
+	
+	return iom361_read(&defaultBoard, offset, rtn_code);
+ }
+ 
+ /* iom361_writeReg() */
+ uint32_t iom361_writeReg(uint32_t* base, int offset, uint32_t value, int* rtn_code) {
+	if (base != defaultBoard.regs) {
+		// not pointing to base of IO space
+		if (rtn_code != NULL)
+			*rtn_code = 1;
+		return errValue;
+	}
+	
+	return iom361_write(&defaultBoard, offset, value, rtn_code);
+ }
+ 
+ /* iom361_readSensor1() */
+ int iom361_readSensor1(uint32_t* base, uint32_t* temp, uint32_t* humid) {
+	if (base != defaultBoard.regs) {
+		// not pointing to base of IO space
+		return 1;
+	}
+	
+	return iom361_read_sensor1(&defaultBoard, temp, humid);
+ }
+ 
+ /* iom361_readRegs() */
+ int iom361_readRegs(uint32_t* base, uint32_t offset, void* dest, int num_regs,
+	int* rtn_code) {
+	if (base != defaultBoard.regs) {
+		// not pointing to base of IO space
+		if (rtn_code != NULL)
+			*rtn_code = 1;
+		return 0;
+	}
+	
+	return iom361_read_regs(&defaultBoard, offset, dest, num_regs, rtn_code);
+ }
+ 
+ 
+// Functions used for testing - set register values for read-only registers
+  
+/* _iom361_setSwitches() */
+void _iom361_setSwitches(uint32_t value){
+	_iom361_set_switches(&defaultBoard, value);
+}
+  
+  
+/* _iom361_setSensor1() */
+void _iom361_setSensor1(float new_temp, float new_humid){
+	_iom361_set_sensor1(&defaultBoard, new_temp, new_humid);
+}
+
+
+/* _iom361_setSensor1_rndm() */
+void _iom361_setSensor1_rndm(float temp_low, float temp_hi,
+	float humid_low, float humid_hi) {
+	_iom361_set_sensor1_rndm(&defaultBoard, temp_low, temp_hi,
+		humid_low, humid_hi);
+}
+
+
+// Handle-based API functions
+
+/* iom361_create() */
+iom361_t* iom361_create(int num_switches, int num_leds, int* rtn_code) {
+	iom361_t* iom = (iom361_t*) malloc(sizeof(iom361_t));
+	
+	if (iom == NULL) {
+		if (rtn_code != NULL)
+			*rtn_code = 5;
+		return NULL;
+	}
+	
+	init_board(iom, num_switches, num_leds);
+	
+	if (rtn_code != NULL)
+		*rtn_code = 0;
+	return iom;
+}
+
+
+/* iom361_destroy() */
+void iom361_destroy(iom361_t* iom) {
+	// the default board is not on the heap
+	if (iom != &defaultBoard)
+		free(iom);
+}
+
+
+/* iom361_read() */
+uint32_t iom361_read(iom361_t* iom, uint32_t offset, int* rtn_code) {
 	uint32_t value;
 	uint32_t* ioreg_ptr;
 	
-	if (base != IOSpacePtr) {
-		// not pointing to base of IO space
+	if (iom == NULL) {
+		// no board to read
 		if (rtn_code != NULL)
 			*rtn_code = 1;
 		return errValue;
 	}
 	
-	if ((offset < 0) || (offset > (sizeof(IOSpace) - sizeof(uint32_t)))) {
+	if (offset > (sizeof(iom->regs) - sizeof(uint32_t))) {
 		// offset is out of range
 		if (rtn_code != NULL)
 			*rtn_code = 2;
 		return errValue;
 	}
 	
-	// calculate address and get the value
-	ioreg_ptr = base + (offset / sizeof(uint32_t));
-	value = *ioreg_ptr;
+	// calculate address and get the value, the sensor may be updated by
+	// another thread
+	ioreg_ptr = iom->regs + (offset / sizeof(uint32_t));
+	value = __atomic_load_n(ioreg_ptr, __ATOMIC_RELAXED);
 	
 	#ifdef _DEBUG_
-		printf("INFO[iom361_readReg()]: base = %p, offset = %d, ioreg_ptr=%p, value=%08X\n",
-			base, offset, ioreg_ptr, value);
+		printf("INFO[iom361_read()]: base = %p, offset = %d, ioreg_ptr=%p, value=%08X\n",
+			iom->regs, offset, ioreg_ptr, value);
 	#endif
 	
 	if (rtn_code != NULL)
 		*rtn_code = 0;
 	return value;
- }
- 
- /* iom361_writeReg() */
- uint32_t iom361_writeReg(uint32_t* base, int offset, uint32_t value, int* rtn_code) {
+}
+
+
+/* iom361_read_sensor1() */
+int iom361_read_sensor1(iom361_t* iom, uint32_t* temp, uint32_t* humid) {
+	uint32_t seq_before, seq_after;
+	uint32_t temp_value, humid_value;
+	
+	if (iom == NULL || temp == NULL || humid == NULL)
+		return 1;
+	
+	// retry while an update is in progress or one finished during the reads
+	do {
+		seq_before = __atomic_load_n(&iom->sensorSeq, __ATOMIC_ACQUIRE);
+		temp_value = __atomic_load_n(&iom->regs[TEMP_REG / sizeof(uint32_t)],
+			__ATOMIC_RELAXED);
+		humid_value = __atomic_load_n(&iom->regs[HUMID_REG / sizeof(uint32_t)],
+			__ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq_after = __atomic_load_n(&iom->sensorSeq, __ATOMIC_RELAXED);
+	} while ((seq_before & 1) || seq_before != seq_after);
+	
+	*temp = temp_value;
+	*humid = humid_value;
+	return 0;
+}
+
+
+/* iom361_read_regs() */
+int iom361_read_regs(iom361_t* iom, uint32_t offset, void* dest, int num_regs,
+	int* rtn_code) {
+	if (iom == NULL || dest == NULL) {
+		// no board to read or nowhere to put the registers
+		if (rtn_code != NULL)
+			*rtn_code = 1;
+		return 0;
+	}
+	
+	// one range check covers the whole span
+	if (num_regs < 0 || offset > sizeof(iom->regs) ||
+		(uint32_t) num_regs > (sizeof(iom->regs) - offset) / sizeof(uint32_t)) {
+		if (rtn_code != NULL)
+			*rtn_code = 2;
+		return 0;
+	}
+	
+	if ((offset % sizeof(uint32_t)) != 0) {
+		// offset does not point to start of an I/O register
+		if (rtn_code != NULL)
+			*rtn_code = 3;
+		return 0;
+	}
+	
+	// copy the registers in one transfer, like a DMA burst
+	memcpy(dest, iom->regs + (offset / sizeof(uint32_t)),
+		num_regs * sizeof(uint32_t));
+	
+	if (rtn_code != NULL)
+		*rtn_code = 0;
+	return num_regs;
+}
+
+
+/* iom361_write() */
+uint32_t iom361_write(iom361_t* iom, int offset, uint32_t value, int* rtn_code) {
 	uint32_t* ioreg_ptr;
 	
-	if (base != IOSpacePtr) {
-		// not pointing to base of IO space
+	if (iom == NULL) {
+		// no board to write
 		if (rtn_code != NULL)
 			*rtn_code = 1;
 		return errValue;
 	}
 	
-	if ((offset < 0) || (offset > (sizeof(IOSpace) - sizeof(uint32_t)))) {
+	if ((offset < 0) || (offset > (int) (sizeof(iom->regs) - sizeof(uint32_t)))) {
 		// offset is out of range
 		if (rtn_code != NULL)
 			*rtn_code = 2;
@@ -133,18 +316,18 @@
 	if (rtn_code != NULL)
 		*rtn_code = 0;
 	
-	ioreg_ptr = base + (offset/sizeof(uint32_t));
+	ioreg_ptr = iom->regs + (offset/sizeof(uint32_t));
 	
 	#ifdef _DEBUG_
-		printf("INFO[iom361_writeReg()]: base = %p, offset = %d, ioreg_ptr=%p, value=%08X\n",
-			base, offset, ioreg_ptr, value);
+		printf("INFO[iom361_write()]: base = %p, offset = %d, ioreg_ptr=%p, value=%08X\n",
+			iom->regs, offset, ioreg_ptr, value);
 	#endif
 	
 	switch (offset) {
 		case SWITCHES_REG:	break; // switches are a read-only input
 					
 		case LEDS_REG:		*ioreg_ptr = value;
-							display_leds(value, nleds);
+							display_leds(value, iom->nleds);
 							break;
 				
 		case RGB_LED_REG:	*ioreg_ptr = value;
@@ -170,64 +353,370 @@
 					break;
 	}
 	return value;
- }
- 
- 
-// Functions used for testing - set register values for read-only registers
-  
-/* _iom361_setSwitches() */
-void _iom361_setSwitches(uint32_t value){
-	uint32_t* ioreg_ptr = IOSpacePtr + (SWITCHES_REG / sizeof(uint32_t));
+}
+
+
+/* _iom361_set_switches() */
+void _iom361_set_switches(iom361_t* iom, uint32_t value) {
+	if (iom == NULL)
+		return;
 	
 	// this one is straightforward - just write value to switch register
-	*ioreg_ptr = value;
-	return;
+	iom->regs[SWITCHES_REG / sizeof(uint32_t)] = value;
 }
-  
-  
-/* _iom361_setSensor1() */
-void _iom361_setSensor1(float new_temp, float new_humid){
+
+
+/* _iom361_set_sensor1() */
+void _iom361_set_sensor1(iom361_t* iom, float new_temp, float new_humid) {
 	float temp_float, humid_float;
 	uint32_t temp_value, humid_value;
 	
-	uint32_t* ioreg_ptr;
-
-	static const float temp_const = 5242.88f;  // (2^20) / 200.0 = 1048576 / 200.0
-	static const float rh_const = 10485.76f;   // (2^20) / 100.0 = 1048576 / 100.0
+	if (iom == NULL)
+		return;
 	
 	// per AHT20 data sheet, Temp(C) = (ST/2**20)* 200 - 50
 	// so ST = (2**20/200) * (Temp(C) + 50)
-	temp_float = temp_const * (new_temp + 50.0);
+	temp_float = tempConst * (new_temp + 50.0);
 	temp_value = (uint32_t) temp_float;
 	
 	// per AHT20 data sheet, RH(%) = (SRH/2**20)* 100%
 	// so SRH = (2**20/100) * RH(%)
-	humid_float = rh_const * new_humid;
+	humid_float = rhConst * new_humid;
 	humid_value = (uint32_t) humid_float;
 	
-	// write the I/O registers
-	ioreg_ptr = IOSpacePtr + (TEMP_REG / sizeof(uint32_t));
-	*ioreg_ptr = temp_value;
+	// write the I/O registers inside a seqlock update, readers that overlap
+	// it see an odd or changed count and retry.  The writer never waits
+	uint32_t seq = __atomic_load_n(&iom->sensorSeq, __ATOMIC_RELAXED);
 	
-	ioreg_ptr = IOSpacePtr + (HUMID_REG / sizeof(uint32_t));
-	*ioreg_ptr = humid_value;
-	return;
+	__atomic_store_n(&iom->sensorSeq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&iom->regs[TEMP_REG / sizeof(uint32_t)], temp_value,
+		__ATOMIC_RELAXED);
+	__atomic_store_n(&iom->regs[HUMID_REG / sizeof(uint32_t)], humid_value,
+		__ATOMIC_RELAXED);
+	__atomic_store_n(&iom->sensorSeq, seq + 2, __ATOMIC_RELEASE);
 }
 
 
-/* _iom361_setSensor1_rndm() */
-void _iom361_setSensor1_rndm(float temp_low, float temp_hi,
+/* _iom361_set_sensor1_rndm() */
+void _iom361_set_sensor1_rndm(iom361_t* iom, float temp_low, float temp_hi,
 	float humid_low, float humid_hi) {
 	float new_temp = 0.0, new_humid = 0.0;
 	
-	new_temp = (float) float_rand_in_range(temp_low, temp_hi);
-	new_humid = (float) float_rand_in_range(humid_low, humid_hi);
-	_iom361_setSensor1(new_temp, new_humid);
+	if (iom == NULL)
+		return;
+	
+	new_temp = (float) rndm_in_range(&iom->rng, temp_low, temp_hi);
+	new_humid = (float) rndm_in_range(&iom->rng, humid_low, humid_hi);
+	_iom361_set_sensor1(iom, new_temp, new_humid);
+}
+
+
+// Batch generation
+
+/* iom361_generate_batch() */
+int iom361_generate_batch(float temp_low, float temp_hi, float humid_low,
+	float humid_hi, uint32_t* temps, uint32_t* humids, size_t n) {
+	batch_rng_t rng;
+	batch_range_t range;
+	Rndm_t* source;
+	size_t i;
+	
+	if (n == 0)
+		return 0;
+	if (temps == NULL || humids == NULL)
+		return 1;
+	
+	// each lane is its own generator, seeded from the thread's generator
+	source = float_rand_engine();
+	for (int lane = 0; lane < BATCH_LANES; lane++) {
+		Rndm_t lane_rng;
+		
+		rndm_seed(&lane_rng, rndm_next(source));
+		for (int w = 0; w < 4; w++)
+			rng.s[w][lane] = lane_rng.s[w];
+	}
+	
+	range.temp_low = temp_low;
+	range.temp_span = (double) temp_hi - temp_low;
+	range.humid_low = humid_low;
+	range.humid_span = (double) humid_hi - humid_low;
+	
+	// whole groups with the vector unit, if there is one, then the scalar
+	// code takes what is left.  Both give the same values
+	i = batch_vector(&rng, &range, temps, humids, n);
+	for (; i + BATCH_LANES <= n; i += BATCH_LANES)
+		batch_group(&rng, &range, temps + i, humids + i);
+	
+	if (i < n) {
+		uint32_t last_temps[BATCH_LANES], last_humids[BATCH_LANES];
+		
+		batch_group(&rng, &range, last_temps, last_humids);
+		memcpy(temps + i, last_temps, (n - i) * sizeof(uint32_t));
+		memcpy(humids + i, last_humids, (n - i) * sizeof(uint32_t));
+	}
+	
+	return 0;
 }
 	
 		
   
 // Helper Functions
+
+/**
+ * init_board() - puts a board's registers in their power-on state
+ *
+ * LEDs are dark, the switches are off and the sensor reads 23.5C, 75% RH.
+ * Clearing the LED registers displays them, as any write does.  The random
+ * reading generator is seeded from the time and the number of boards set up
+ * so far, so boards created together still differ.
+ *
+ * @param	iom is the board to set up
+ * @param	num_switches is the number of switches on the board
+ * @param	num_leds is the number of LEDs on the board
+ *
+ */
+static void init_board(iom361_t* iom, int num_switches, int num_leds) {
+	iom->nsw = num_switches;
+	iom->nleds = num_leds;
+	iom->sensorSeq = 0;
+	rndm_seed(&iom->rng, (uint64_t) time(NULL) +
+		__atomic_fetch_add(&boardCount, 1, __ATOMIC_RELAXED));
+	
+	// initialize the I/O registers
+	iom361_write(iom, LEDS_REG, 0x00000000, NULL);
+	iom361_write(iom, RGB_LED_REG, 0x00000000, NULL);
+	iom361_write(iom, RSVD1_REG, 0x11111111, NULL);
+	iom361_write(iom, RSVD2_REG, 0x22222222, NULL);
+	iom361_write(iom, RSVD3_REG, 0x33333333, NULL);
+		
+	_iom361_set_switches(iom, 0x00000000);
+	_iom361_set_sensor1(iom, 23.5, 75.0);
+}
+
+ 
+/**
+ * batch_group() - generates one reading per lane with scalar code
+ *
+ * Lane k draws a temperature and then a humidity with xoshiro256**, maps
+ * each draw onto [0, 1) from its top 52 bits and onto the range, rounds it to
+ * a float and encodes it as _iom361_set_sensor1() does
+ *
+ * @param	rng is the lane generators
+ * @param	range is the temperature and humidity ranges
+ * @param	temps receives BATCH_LANES temperature register values
+ * @param	humids receives BATCH_LANES humidity register values
+ *
+ */
+static void batch_group(batch_rng_t* rng, const batch_range_t* range,
+	uint32_t* temps, uint32_t* humids) {
+	for (int lane = 0; lane < BATCH_LANES; lane++) {
+		Rndm_t lane_rng;
+		float new_temp, new_humid, temp_float, humid_float;
+		
+		for (int w = 0; w < 4; w++)
+			lane_rng.s[w] = rng->s[w][lane];
+		
+		new_temp = (float) (range->temp_low + range->temp_span *
+			((double) (rndm_next(&lane_rng) >> 12) * unitScale));
+		new_humid = (float) (range->humid_low + range->humid_span *
+			((double) (rndm_next(&lane_rng) >> 12) * unitScale));
+		
+		temp_float = tempConst * (new_temp + 50.0);
+		humid_float = rhConst * new_humid;
+		temps[lane] = (uint32_t) temp_float;
+		humids[lane] = (uint32_t) humid_float;
+		
+		for (int w = 0; w < 4; w++)
+			rng->s[w][lane] = lane_rng.s[w];
+	}
+}
+
+
+#if defined(__AVX2__)
+
+/**
+ * batch_next() - steps four xoshiro256** generators, returns their outputs
+ */
+static __m256i batch_next(__m256i* s) {
+	__m256i x = _mm256_add_epi64(_mm256_slli_epi64(s[1], 2), s[1]);	// * 5
+	__m256i t = _mm256_slli_epi64(s[1], 17);
+	__m256i result;
+	
+	x = _mm256_or_si256(_mm256_slli_epi64(x, 7), _mm256_srli_epi64(x, 57));
+	result = _mm256_add_epi64(_mm256_slli_epi64(x, 3), x);				// * 9
+	
+	s[2] = _mm256_xor_si256(s[2], s[0]);
+	s[3] = _mm256_xor_si256(s[3], s[1]);
+	s[1] = _mm256_xor_si256(s[1], s[2]);
+	s[0] = _mm256_xor_si256(s[0], s[3]);
+	s[2] = _mm256_xor_si256(s[2], t);
+	s[3] = _mm256_or_si256(_mm256_slli_epi64(s[3], 45),
+		_mm256_srli_epi64(s[3], 19));
+	
+	return result;
+}
+
+
+/**
+ * batch_unit() - maps the top 52 bits of each output onto [0, 1), exactly as
+ * the scalar multiply by 2^-52 does, by making them the mantissa of [1, 2)
+ */
+static __m256d batch_unit(__m256i bits) {
+	const __m256i one = _mm256_set1_epi64x(0x3FF0000000000000LL);
+	
+	bits = _mm256_or_si256(_mm256_srli_epi64(bits, 12), one);
+	return _mm256_sub_pd(_mm256_castsi256_pd(bits), _mm256_set1_pd(1.0));
+}
+
+
+/**
+ * batch_vector() - generates whole groups of readings four lanes at a time
+ *
+ * @return	the number of readings generated
+ *
+ */
+static size_t batch_vector(batch_rng_t* rng, const batch_range_t* range,
+	uint32_t* temps, uint32_t* humids, size_t n) {
+	__m256i s[4];
+	const __m256d temp_low = _mm256_set1_pd(range->temp_low);
+	const __m256d temp_span = _mm256_set1_pd(range->temp_span);
+	const __m256d humid_low = _mm256_set1_pd(range->humid_low);
+	const __m256d humid_span = _mm256_set1_pd(range->humid_span);
+	const __m256d offset = _mm256_set1_pd(50.0);
+	const __m256d temp_scale = _mm256_set1_pd(tempConst);
+	const __m128 humid_scale = _mm_set1_ps(rhConst);
+	size_t i;
+	
+	for (int w = 0; w < 4; w++)
+		s[w] = _mm256_loadu_si256((const __m256i*) rng->s[w]);
+	
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m256d temp_draw = batch_unit(batch_next(s));
+		__m256d humid_draw = batch_unit(batch_next(s));
+		__m128 new_temp, new_humid, temp_float, humid_float;
+		
+		new_temp = _mm256_cvtpd_ps(_mm256_add_pd(temp_low,
+			_mm256_mul_pd(temp_span, temp_draw)));
+		new_humid = _mm256_cvtpd_ps(_mm256_add_pd(humid_low,
+			_mm256_mul_pd(humid_span, humid_draw)));
+		
+		temp_float = _mm256_cvtpd_ps(_mm256_mul_pd(temp_scale,
+			_mm256_add_pd(_mm256_cvtps_pd(new_temp), offset)));
+		humid_float = _mm_mul_ps(humid_scale, new_humid);
+		
+		_mm_storeu_si128((__m128i*) (temps + i), _mm_cvttps_epi32(temp_float));
+		_mm_storeu_si128((__m128i*) (humids + i), _mm_cvttps_epi32(humid_float));
+	}
+	
+	for (int w = 0; w < 4; w++)
+		_mm256_storeu_si256((__m256i*) rng->s[w], s[w]);
+	
+	return i;
+}
+
+#elif defined(__SSE2__)
+
+/**
+ * batch_next() - steps two xoshiro256** generators, returns their outputs
+ */
+static __m128i batch_next(__m128i* s) {
+	__m128i x = _mm_add_epi64(_mm_slli_epi64(s[1], 2), s[1]);		// * 5
+	__m128i t = _mm_slli_epi64(s[1], 17);
+	__m128i result;
+	
+	x = _mm_or_si128(_mm_slli_epi64(x, 7), _mm_srli_epi64(x, 57));
+	result = _mm_add_epi64(_mm_slli_epi64(x, 3), x);				// * 9
+	
+	s[2] = _mm_xor_si128(s[2], s[0]);
+	s[3] = _mm_xor_si128(s[3], s[1]);
+	s[1] = _mm_xor_si128(s[1], s[2]);
+	s[0] = _mm_xor_si128(s[0], s[3]);
+	s[2] = _mm_xor_si128(s[2], t);
+	s[3] = _mm_or_si128(_mm_slli_epi64(s[3], 45), _mm_srli_epi64(s[3], 19));
+	
+	return result;
+}
+
+
+/**
+ * batch_unit() - maps the top 52 bits of each output onto [0, 1), exactly as
+ * the scalar multiply by 2^-52 does, by making them the mantissa of [1, 2)
+ */
+static __m128d batch_unit(__m128i bits) {
+	const __m128i one = _mm_set1_epi64x(0x3FF0000000000000LL);
+	
+	bits = _mm_or_si128(_mm_srli_epi64(bits, 12), one);
+	return _mm_sub_pd(_mm_castsi128_pd(bits), _mm_set1_pd(1.0));
+}
+
+
+/**
+ * batch_vector() - generates whole groups of readings, lanes 0-1 and 2-3 in
+ * two vectors
+ *
+ * @return	the number of readings generated
+ *
+ */
+static size_t batch_vector(batch_rng_t* rng, const batch_range_t* range,
+	uint32_t* temps, uint32_t* humids, size_t n) {
+	__m128i s[2][4];
+	const __m128d temp_low = _mm_set1_pd(range->temp_low);
+	const __m128d temp_span = _mm_set1_pd(range->temp_span);
+	const __m128d humid_low = _mm_set1_pd(range->humid_low);
+	const __m128d humid_span = _mm_set1_pd(range->humid_span);
+	const __m128d offset = _mm_set1_pd(50.0);
+	const __m128d temp_scale = _mm_set1_pd(tempConst);
+	const __m128 humid_scale = _mm_set1_ps(rhConst);
+	size_t i;
+	
+	for (int half = 0; half < 2; half++)
+		for (int w = 0; w < 4; w++)
+			s[half][w] = _mm_loadu_si128((const __m128i*) &rng->s[w][2 * half]);
+	
+	for (i = 0; i + 4 <= n; i += 4) {
+		__m128 new_temp[2], new_humid[2], temp_float[2];
+		
+		for (int half = 0; half < 2; half++) {
+			__m128d temp_draw = batch_unit(batch_next(s[half]));
+			__m128d humid_draw = batch_unit(batch_next(s[half]));
+			
+			new_temp[half] = _mm_cvtpd_ps(_mm_add_pd(temp_low,
+				_mm_mul_pd(temp_span, temp_draw)));
+			new_humid[half] = _mm_cvtpd_ps(_mm_add_pd(humid_low,
+				_mm_mul_pd(humid_span, humid_draw)));
+			temp_float[half] = _mm_cvtpd_ps(_mm_mul_pd(temp_scale,
+				_mm_add_pd(_mm_cvtps_pd(new_temp[half]), offset)));
+		}
+		
+		// each half filled the low two floats, put lanes 0-3 together
+		__m128 temp_value = _mm_movelh_ps(temp_float[0], temp_float[1]);
+		__m128 humid_value = _mm_mul_ps(humid_scale,
+			_mm_movelh_ps(new_humid[0], new_humid[1]));
+		
+		_mm_storeu_si128((__m128i*) (temps + i), _mm_cvttps_epi32(temp_value));
+		_mm_storeu_si128((__m128i*) (humids + i), _mm_cvttps_epi32(humid_value));
+	}
+	
+	for (int half = 0; half < 2; half++)
+		for (int w = 0; w < 4; w++)
+			_mm_storeu_si128((__m128i*) &rng->s[w][2 * half], s[half][w]);
+	
+	return i;
+}
+
+#else
+
+/**
+ * batch_vector() - no vector unit, leaves every group to batch_group()
+ */
+static size_t batch_vector(batch_rng_t* rng, const batch_range_t* range,
+	uint32_t* temps, uint32_t* humids, size_t n) {
+	return 0;
+}
+
+#endif
+
  
 /**
  * display_leds() - displays the LED register
@@ -56,6 +56,7 @@
  #ifndef _IOM361_H
  #define _IOM361_H
  
+ #include <stddef.h>
  #include <stdint.h>
  #include <stdbool.h>
  
@@ -86,6 +87,9 @@
  // define constants
   #define NUM_IO_REGS	8		// There are 8 IO registers in the I/O map
  
+ // an emulated board.  Opaque, create one with iom361_create()
+ typedef struct iom361 iom361_t;
+ 
  /*
   * API functions.  These are low level functions that read/write the
   * I/O registers directly.  You can use them to build higher level
@@ -125,6 +129,47 @@ uint32_t* iom361_initialize(int num_switches, int num_leds, int* rtn_code);
 uint32_t iom361_readReg(uint32_t* base, uint32_t offset, int* rtn_code);
  
  
+ /** iom361_readSensor1() - reads a consistent temperature/humidity pair
+  *
+  * _iom361_setSensor1() updates the two registers under a sequence count.
+  * This read retries until both registers come from the same update, so a
+  * reader running alongside the thread updating the sensor never sees a new
+  * temperature paired with an old humidity.  Reading TEMP_REG and HUMID_REG
+  * separately gives no such guarantee.  The updating thread never waits on
+  * readers.  Only one thread at a time may update a board's sensor
+  *
+  * @param	base: address of the base of the I/O memory block
+  * @param	*temp: filled with the temperature register
+  * @param	*humid: filled with the humidity register
+  *
+  * @return 0 for success, a different number if the call fails
+  */
+int iom361_readSensor1(uint32_t* base, uint32_t* temp, uint32_t* humid);
+ 
+ 
+ /** iom361_readRegs() - copies a span of I/O registers in one call
+  *
+  * copies num_regs registers starting at base + offset into dest, checking
+  * base and the whole span once, in the style of a DMA burst.  Reading
+  * NUM_IO_REGS registers from offset 0 into an ioreg_t copies the whole
+  * register file.  Updates rtn_code if the function succeeds (0) or
+  * fails (> 0), and nothing is copied if it fails.  A burst is not
+  * protected from a sensor update in another thread, iom361_readSensor1()
+  * is
+  *
+  * @param	base: address of the base of the I/O memory block
+  * @param	offset: offset of the first register to copy, a multiple of 4
+  * @param	dest: where to put the registers, room for num_regs uint32_t
+  * @param	num_regs: number of consecutive registers to copy
+  * @param	*rtn_code: a pointer to the return code.  Will be 0 for success, a different
+  *			number if the call fails.
+  *
+  * @return the number of registers copied
+  */
+int iom361_readRegs(uint32_t* base, uint32_t offset, void* dest, int num_regs,
+	int* rtn_code);
+ 
+ 
  /**
   * iom361_writeReg() - writes a 32-bit value to an I/O register
   *
@@ -194,12 +239,160 @@ void _iom361_setSensor1(float new_temp, float new_humid);
   * @param	humid_hi: high relative humidity in range   Specified as float. 
   *			conversion to a register value is done in the function
   *
-  * @note	Uses srand(time(NULL) to initialize rand().  This is done when
-  *			iom361 is initialized.
+  * @note	Each board draws from its own generator, seeded from the time
+  *			when the board is initialized.
   */
 void _iom361_setSensor1_rndm(float temp_low, float temp_hi,
 	float humid_low, float humid_hi);
 
+
+/*
+ * Handle-based API.  Each iom361_t is a separate board with its own register
+ * file, so a program can emulate several boards and drive each from its own
+ * thread.  Calls on different boards never touch shared state, each board
+ * even has its own random number generator.  A single board is not locked,
+ * give each thread its own.
+ *
+ * The functions above operate on a default board set up by iom361_initialize()
+ * and behave exactly as they always have.
+ */
+
+ /**
+  * iom361_create() - creates and initializes an emulated board
+  *
+  * Registers are set as iom361_initialize() sets them, which displays the
+  * cleared LEDs.
+  *
+  * @param  num_switches: the number of switches (up to 32) on the board
+  * @param	num_leds: the number of leds (up to 32) on the board
+  * @param	*rtn_code: a pointer to the return code.  Will be 0 for success, a different
+  *			number if the call fails.
+  *
+  * @return	a pointer to the new board.  NULL if function fails
+  */
+iom361_t* iom361_create(int num_switches, int num_leds, int* rtn_code);
+
+
+ /**
+  * iom361_destroy() - frees a board created by iom361_create()
+  *
+  * @param	iom: the board to free.  NULL is ignored
+  */
+void iom361_destroy(iom361_t* iom);
+
+
+ /**
+  * iom361_read() - returns the value of one of a board's I/O registers
+  *
+  * Same as iom361_readReg() with the board in place of the base address
+  *
+  * @param	iom: the board to read
+  * @param	offset: offset into I/O memory block.  All registers are 32-bits wide
+  * @param	*rtn_code: a pointer to the return code.  Will be 0 for success, a different
+  *			number if the call fails.
+  *
+  * @return the contents of the specified I/O register
+  */
+uint32_t iom361_read(iom361_t* iom, uint32_t offset, int* rtn_code);
+
+
+ /**
+  * iom361_read_sensor1() - reads a consistent temperature/humidity pair from
+  *                         a board
+  *
+  * Same as iom361_readSensor1() with the board in place of the base address
+  *
+  * @return 0 for success, a different number if the call fails
+  */
+int iom361_read_sensor1(iom361_t* iom, uint32_t* temp, uint32_t* humid);
+
+
+ /**
+  * iom361_read_regs() - copies a span of one of a board's I/O registers
+  *
+  * Same as iom361_readRegs() with the board in place of the base address
+  *
+  * @return the number of registers copied
+  */
+int iom361_read_regs(iom361_t* iom, uint32_t offset, void* dest, int num_regs,
+	int* rtn_code);
+
+
+ /**
+  * iom361_write() - writes a 32-bit value to one of a board's I/O registers
+  *
+  * Same as iom361_writeReg() with the board in place of the base address
+  *
+  * @param	iom: the board to write
+  * @param	offset: offset into I/O memory block.  All registers are 32-bits wide
+  * @param	*rtn_code: a pointer to the return code.  Will be 0 for success, a different
+  *			number if the call fails.
+  *
+  * @return the contents of the specified I/O register (does a read)
+  */
+uint32_t iom361_write(iom361_t* iom, int offset, uint32_t value, int* rtn_code);
+
+
+ /**
+  * _iom361_set_switches() - sets the value of a board's switch register
+  *
+  * @param	iom: the board to set
+  * @param	value: value for the switch register
+  */
+void _iom361_set_switches(iom361_t* iom, uint32_t value);
+
+
+ /**
+  * _iom361_set_sensor1() - sets the temperature and humidity for a board's
+  *                         Sensor 1
+  *
+  * @param	iom: the board to set
+  * @param	new_temp: new temperature value in degrees C
+  * @param	new_humid: new relative humidity value in %
+  */
+void _iom361_set_sensor1(iom361_t* iom, float new_temp, float new_humid);
+
+
+ /**
+  * _iom361_set_sensor1_rndm() - sets a board's Sensor 1 to a random temperature
+  *                              and humidity within the specified ranges
+  *
+  * @param	iom: the board to set
+  * @param	temp_low, temp_hi: temperature range in degrees C
+  * @param	humid_low, humid_hi: relative humidity range in %
+  */
+void _iom361_set_sensor1_rndm(iom361_t* iom, float temp_low, float temp_hi,
+	float humid_low, float humid_hi);
+
+
+/*
+ * Batch generation.  Fills arrays with Sensor 1 register values without a
+ * board, for building large sets of test readings.
+ */
+
+ /**
+  * iom361_generate_batch() - generates random temperature and humidity register
+  * values
+  *
+  * Each value is the register value _iom361_set_sensor1() would set for a
+  * temperature or humidity drawn at random from its range.  Built with SSE2 or
+  * AVX2 the readings are generated four at a time, the values are the same
+  * with or without them
+  *
+  * @param	temp_low, temp_hi: temperature range in degrees C, within -50 to 150
+  * @param	humid_low, humid_hi: relative humidity range in %, within 0 to 100
+  * @param	temps: receives n temperature register values
+  * @param	humids: receives n humidity register values
+  * @param	n: the number of readings to generate
+  *
+  * @return 0 for success, a different number if the call fails
+  *
+  * @note	Draws from the calling thread's float_rand_in_range() generator,
+  *			so float_rand_seed() makes a batch repeat
+  */
+int iom361_generate_batch(float temp_low, float temp_hi, float humid_low,
+	float humid_hi, uint32_t* temps, uint32_t* humids, size_t n);
+
 #endif
   
   
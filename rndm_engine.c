@@ -0,0 +1,93 @@
+/**
+ * @file        rndm_engine.c
+ * @brief
+ * Implements the xoshiro256** generator defined in rndm_engine.h, after
+ * Blackman and Vigna. The seed is spread over the 256 bits of state with
+ * splitmix64, which never gives an all-zero state.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#include "rndm_engine.h"
+
+
+
+/******************************** Definitions *********************************/
+
+// 1 / (2^53 - 1), maps a 53-bit integer onto [0.0, 1.0]
+#define RNDM_UNIT_SCALE     (1.0 / 9007199254740991.0)
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static uint64_t rotate_left(uint64_t x, int k);
+static uint64_t splitmix64(uint64_t* state);
+
+
+
+/************************ API Function Implementations ************************/
+
+void rndm_seed(Rndm_t* rng, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&seed);
+    }
+}
+
+
+
+uint64_t rndm_next(Rndm_t* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rotate_left(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotate_left(s[3], 45);
+
+    return result;
+}
+
+
+
+double rndm_unit(Rndm_t* rng) {
+    return (double)(rndm_next(rng) >> 11) * RNDM_UNIT_SCALE;
+}
+
+
+
+double rndm_in_range(Rndm_t* rng, double a, double b) {
+    return a + (b - a) * rndm_unit(rng);
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * rotate_left() - rotates a 64-bit value left by k bits, 0 < k < 64
+ */
+static uint64_t rotate_left(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+
+
+/**
+ * splitmix64() - steps a splitmix64 generator, used to expand seeds
+ *
+ * @param state   Generator state, any value
+ */
+static uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
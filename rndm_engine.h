@@ -0,0 +1,77 @@
+/**
+ * @file        rndm_engine.h
+ * @brief
+ * Defines a xoshiro256** pseudo-random number generator whose state is an
+ * explicit object instead of the hidden global behind rand(). Each thread
+ * (or emulated board) owns its own Rndm_t, so generators never share memory
+ * and random load scales with the number of threads. Every bit of the output
+ * is usable, unlike the low bits of many rand() implementations.
+ *
+ * Not suitable for anything that needs unpredictable numbers.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef RNDM_ENGINE_H
+#define RNDM_ENGINE_H
+
+#include <stdint.h>
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Defines the state of one generator, set up with rndm_seed()
+typedef struct rndm_engine {
+    uint64_t s[4];          // xoshiro256** state, never all zero
+} Rndm_t;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * rndm_seed() - seeds a generator
+ *
+ * @param	rng		generator to seed
+ * @param	seed	any value.  Nearby seeds give unrelated sequences, and
+ *					the same seed always gives the same sequence
+ */
+void rndm_seed(Rndm_t* rng, uint64_t seed);
+
+
+
+/**
+ * rndm_next() - returns the next 64 random bits from a generator
+ */
+uint64_t rndm_next(Rndm_t* rng);
+
+
+
+/**
+ * rndm_unit() - returns a random double in [0.0, 1.0]
+ *
+ * @note Built from the top 53 bits of rndm_next(), both ends included like
+ * rand() / RAND_MAX.
+ */
+double rndm_unit(Rndm_t* rng);
+
+
+
+/**
+ * rndm_in_range() - returns a random double between a and b
+ *
+ * @param	rng		generator to draw from
+ * @param	a		one end of the range (inclusive)
+ * @param	b		other end of the range (inclusive), may be less than a
+ * @return			random double in [min(a, b), max(a, b)]
+ *
+ * @note Computes a + (b - a) * rndm_unit(), which covers any signs and order
+ * of a and b without branching.
+ */
+double rndm_in_range(Rndm_t* rng, double a, double b);
+
+
+
+#endif
@@ -0,0 +1,559 @@
+/**
+ * @file        temp_humid_archive.c
+ * @brief
+ * Implements the compressed archive defined in temp_humid_archive.h.
+ *
+ * Each block's stream is read most significant bit first. The first reading
+ * is the raw temperature and humidity, value_bits each, its timestamp is the
+ * block's first. Every later reading is three codes:
+ *
+ *   timestamp, zigzag of (gap - previous gap), previous gap starting at 0
+ *     0                   same gap as before
+ *     10   + 7 bits       change below 2^7
+ *     110  + 12 bits      change below 2^12
+ *     1110 + 32 bits      change below 2^32
+ *     1111 + 64 bits      any change
+ *
+ *   temperature, then humidity, zigzag of (value - previous value)
+ *     0                   unchanged
+ *     10   + 6 bits       change below 2^6
+ *     110  + 12 bits      change below 2^12
+ *     111  + value_bits   the raw value
+ *
+ * So a reading taken on cadence whose values moved a little costs 1 + 8 + 8
+ * bits, and one whose values jumped costs 1 + 23 + 23 bits.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "temp_humid_archive.h"
+#include "bst_log.h"
+
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Most bytes one reading can take, 4 + 64 bits of timestamp and 3 + 32 bits
+// of each value, rounded up
+#define ARCHIVE_MAX_READING_BYTES   18
+
+
+// Defines a stream being written
+typedef struct temperature_humidity_bit_writer {
+    uint8_t* out;           // Bytes written so far
+    size_t size;            // Number of whole bytes in out
+    uint64_t bits;          // Bits not yet written, lowest fill bits
+    int fill;               // Number of bits in bits, below 8 between calls
+} BitWriter_t;
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static Archive_t* new_archive(size_t count);
+static bool encode_block(Block_t* block, const Data_t* readings, size_t count,
+                         uint8_t* scratch);
+static void encode_gap(BitWriter_t* writer, uint64_t change);
+static void encode_value(BitWriter_t* writer, uint32_t previous,
+                         uint32_t value, uint32_t value_bits);
+static void put_bits(BitWriter_t* writer, uint64_t value, int count);
+static uint64_t get_bits(BlockReader_t* reader, int count);
+static int get_prefix(BlockReader_t* reader, int most);
+
+
+
+/************************ API Function Implementations ************************/
+
+Archive_t* archive_readings(const Data_t* readings, size_t count) {
+    if (readings == NULL && count > 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(archive_readings()): Cannot archive NULL readings.\n");
+        return NULL;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        if (readings[i].timestamp < readings[i - 1].timestamp) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(archive_readings()): Readings are not sorted.\n");
+            return NULL;
+        }
+    }
+
+    Archive_t* archive = new_archive(count);
+    uint8_t* scratch = (uint8_t*)malloc(ARCHIVE_BLOCK_READINGS *
+                                        ARCHIVE_MAX_READING_BYTES);
+
+    if (archive == NULL || scratch == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(archive_readings()): Failed to allocate memory.\n");
+        delete_archive(archive);
+        free(scratch);
+        return NULL;
+    }
+
+    for (size_t b = 0; b < archive->block_count; b++) {
+        size_t first = b * ARCHIVE_BLOCK_READINGS;
+        size_t length = count - first;
+
+        if (length > ARCHIVE_BLOCK_READINGS) {
+            length = ARCHIVE_BLOCK_READINGS;
+        }
+
+        if (!encode_block(&archive->blocks[b], readings + first, length,
+                          scratch)) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(archive_readings()): Failed to allocate memory.\n");
+            delete_archive(archive);
+            free(scratch);
+            return NULL;
+        }
+    }
+
+    free(scratch);
+
+    return archive;
+}
+
+
+
+Archive_t* archive_tree(const Tree_t* tree) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(archive_tree()): Cannot archive NULL tree.\n");
+        return NULL;
+    }
+
+    Archive_t* archive = new_archive((size_t)tree->node_count);
+    Data_t* chunk = (Data_t*)malloc(ARCHIVE_BLOCK_READINGS * sizeof(Data_t));
+    uint8_t* scratch = (uint8_t*)malloc(ARCHIVE_BLOCK_READINGS *
+                                        ARCHIVE_MAX_READING_BYTES);
+
+    if (archive == NULL || chunk == NULL || scratch == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(archive_tree()): Failed to allocate memory.\n");
+        delete_archive(archive);
+        free(chunk);
+        free(scratch);
+        return NULL;
+    }
+
+    // Gathers a block's worth of readings at a time in timestamp order
+    TreeIter_t iter;
+    const Data_t* reading;
+    size_t block = 0;
+    size_t length = 0;
+    bool ok = true;
+
+    tree_iter_begin(&iter, tree);
+
+    while (ok && block < archive->block_count &&
+           (reading = tree_iter_next(&iter)) != NULL) {
+        chunk[length++] = *reading;
+
+        if (length == ARCHIVE_BLOCK_READINGS ||
+            block * ARCHIVE_BLOCK_READINGS + length == archive->count) {
+            ok = encode_block(&archive->blocks[block++], chunk, length,
+                              scratch);
+            length = 0;
+        }
+    }
+
+    tree_iter_end(&iter);
+
+    free(chunk);
+    free(scratch);
+
+    if (!ok) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(archive_tree()): Failed to allocate memory.\n");
+        delete_archive(archive);
+        return NULL;
+    }
+
+    return archive;
+}
+
+
+
+size_t archive_search_range(const Archive_t* archive, time_t t_begin,
+                            time_t t_end, Visit_t visit, void* context) {
+    if (archive == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(archive_search_range()): Cannot search NULL "
+                "archive.\n");
+        return 0;
+    }
+
+    if (visit == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(archive_search_range()): No visit callback given.\n");
+        return 0;
+    }
+
+    // Finds the first block that ends at or after t_begin
+    size_t low = 0;
+    size_t high = archive->block_count;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+
+        if (archive->blocks[middle].last < t_begin) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    size_t visited = 0;
+
+    for (size_t b = low; b < archive->block_count && t_begin <= t_end &&
+         archive->blocks[b].first <= t_end; b++) {
+        BlockReader_t reader;
+        Data_t reading;
+
+        block_reader_begin(&reader, &archive->blocks[b]);
+
+        while (block_reader_next(&reader, &reading) &&
+               reading.timestamp <= t_end) {
+            if (reading.timestamp < t_begin) {
+                continue;
+            }
+
+            visited++;
+
+            if (!visit(&reading, context)) {
+                return visited;
+            }
+        }
+    }
+
+    return visited;
+}
+
+
+
+size_t archive_bytes(const Archive_t* archive) {
+    if (archive == NULL) {
+        return 0;
+    }
+
+    size_t bytes = sizeof(Archive_t) + archive->block_count * sizeof(Block_t);
+
+    for (size_t b = 0; b < archive->block_count; b++) {
+        bytes += archive->blocks[b].size;
+    }
+
+    return bytes;
+}
+
+
+
+void block_reader_begin(BlockReader_t* reader, const Block_t* block) {
+    if (reader == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(block_reader_begin()): Cannot initialize NULL "
+                "cursor.\n");
+        return;
+    }
+
+    reader->block = block;
+    reader->position = 0;
+    reader->bits = 0;
+    reader->fill = 0;
+    reader->left = (block != NULL) ? block->count : 0;
+    reader->delta = 0;
+}
+
+
+
+bool block_reader_next(BlockReader_t* reader, Data_t* out) {
+    if (reader == NULL || reader->left == 0) {
+        return false;
+    }
+
+    const Block_t* block = reader->block;
+    Data_t* last = &reader->last;
+
+    if (reader->left == block->count) {
+        last->timestamp = block->first;
+        last->temp = (uint32_t)get_bits(reader, (int)block->value_bits);
+        last->humid = (uint32_t)get_bits(reader, (int)block->value_bits);
+    }
+    else {
+        static const int gap_bits[] = {0, 7, 12, 32, 64};
+        int code = get_prefix(reader, 4);
+        uint64_t change;
+
+        if (code < 4) {
+            change = get_bits(reader, gap_bits[code]);
+        }
+        else {
+            change = get_bits(reader, 32) << 32;
+            change |= get_bits(reader, 32);
+        }
+
+        reader->delta += (change >> 1) ^ (0 - (change & 1));
+        last->timestamp = (time_t)((uint64_t)last->timestamp + reader->delta);
+
+        // Temperature, then humidity
+        uint32_t* values[] = {&last->temp, &last->humid};
+
+        for (int v = 0; v < 2; v++) {
+            static const int change_bits[] = {0, 6, 12};
+
+            code = get_prefix(reader, 3);
+
+            if (code < 3) {
+                uint32_t zigzag = (uint32_t)get_bits(reader, 
+                                                     change_bits[code]);
+
+                *values[v] += (zigzag >> 1) ^ (0 - (zigzag & 1));
+            }
+            else {
+                *values[v] = (uint32_t)get_bits(reader,
+                                                 (int)block->value_bits);
+            }
+        }
+    }
+
+    reader->left--;
+    *out = *last;
+
+    return true;
+}
+
+
+
+void delete_archive(Archive_t* archive) {
+    if (archive != NULL) {
+        for (size_t b = 0; b < archive->block_count; b++) {
+            free(archive->blocks[b].stream);
+        }
+
+        free(archive->blocks);
+        free(archive);
+    }
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * new_archive() - allocates an archive with room for count readings
+ *
+ * @return   the archive with every block empty, or NULL if allocation fails
+ */
+static Archive_t* new_archive(size_t count) {
+    Archive_t* archive = (Archive_t*)malloc(sizeof(Archive_t));
+
+    if (archive == NULL) {
+        return NULL;
+    }
+
+    archive->count = count;
+    archive->block_count = (count + ARCHIVE_BLOCK_READINGS - 1) /
+                           ARCHIVE_BLOCK_READINGS;
+    archive->blocks = NULL;
+
+    if (archive->block_count > 0) {
+        archive->blocks = (Block_t*)calloc(archive->block_count,
+                                           sizeof(Block_t));
+        if (archive->blocks == NULL) {
+            free(archive);
+            return NULL;
+        }
+    }
+
+    return archive;
+}
+
+
+
+/**
+ * encode_block() - compresses up to ARCHIVE_BLOCK_READINGS sorted readings
+ *
+ * @param block      Filled with the encoded readings
+ * @param readings   Readings in timestamp order, at least one
+ * @param count      Number of readings
+ * @param scratch    Room for the worst case stream
+ * @return           true if the stream was allocated
+ */
+static bool encode_block(Block_t* block, const Data_t* readings, size_t count,
+                         uint8_t* scratch) {
+    BitWriter_t writer = {scratch, 0, 0, 0};
+    uint32_t value_bits = ARCHIVE_VALUE_BITS;
+
+    for (size_t i = 0; i < count; i++) {
+        if ((readings[i].temp | readings[i].humid) >> ARCHIVE_VALUE_BITS) {
+            value_bits = 32;
+            break;
+        }
+    }
+
+    put_bits(&writer, readings[0].temp, (int)value_bits);
+    put_bits(&writer, readings[0].humid, (int)value_bits);
+
+    uint64_t delta = 0;
+
+    for (size_t i = 1; i < count; i++) {
+        uint64_t gap = (uint64_t)readings[i].timestamp -
+                       (uint64_t)readings[i - 1].timestamp;
+
+        encode_gap(&writer, gap - delta);
+        encode_value(&writer, readings[i - 1].temp, readings[i].temp,
+                     value_bits);
+        encode_value(&writer, readings[i - 1].humid, readings[i].humid,
+                     value_bits);
+        delta = gap;
+    }
+
+    // Pads the last byte with zeros
+    if (writer.fill > 0) {
+        put_bits(&writer, 0, 8 - writer.fill);
+    }
+
+    block->stream = (uint8_t*)malloc(writer.size);
+    if (block->stream == NULL) {
+        return false;
+    }
+
+    memcpy(block->stream, scratch, writer.size);
+    block->size = writer.size;
+    block->first = readings[0].timestamp;
+    block->last = readings[count - 1].timestamp;
+    block->count = (uint32_t)count;
+    block->value_bits = value_bits;
+
+    return true;
+}
+
+
+
+/**
+ * encode_gap() - writes the change in the gap between timestamps
+ *
+ * @param writer   Stream being written
+ * @param change   gap - previous gap, as a two's complement 64-bit value
+ */
+static void encode_gap(BitWriter_t* writer, uint64_t change) {
+    uint64_t zigzag = (change << 1) ^ (0 - (change >> 63));
+
+    if (zigzag == 0) {
+        put_bits(writer, 0x0, 1);
+    }
+    else if (zigzag < (1u << 7)) {
+        put_bits(writer, 0x2, 2);
+        put_bits(writer, zigzag, 7);
+    }
+    else if (zigzag < (1u << 12)) {
+        put_bits(writer, 0x6, 3);
+        put_bits(writer, zigzag, 12);
+    }
+    else if (zigzag >> 32 == 0) {
+        put_bits(writer, 0xE, 4);
+        put_bits(writer, zigzag, 32);
+    }
+    else {
+        put_bits(writer, 0xF, 4);
+        put_bits(writer, zigzag >> 32, 32);
+        put_bits(writer, zigzag & 0xFFFFFFFFu, 32);
+    }
+}
+
+
+
+/**
+ * encode_value() - writes a temperature or humidity value
+ *
+ * @param writer       Stream being written
+ * @param previous     Same value in the previous reading
+ * @param value        Value to write
+ * @param value_bits   Width of a raw value in this block
+ */
+static void encode_value(BitWriter_t* writer, uint32_t previous,
+                         uint32_t value, uint32_t value_bits) {
+    uint32_t change = value - previous;
+    uint32_t zigzag = (change << 1) ^ (0 - (change >> 31));
+
+    if (zigzag == 0) {
+        put_bits(writer, 0x0, 1);
+    }
+    else if (zigzag < (1u << 6)) {
+        put_bits(writer, 0x2, 2);
+        put_bits(writer, zigzag, 6);
+    }
+    else if (zigzag < (1u << 12)) {
+        put_bits(writer, 0x6, 3);
+        put_bits(writer, zigzag, 12);
+    }
+    else {
+        put_bits(writer, 0x7, 3);
+        put_bits(writer, value, (int)value_bits);
+    }
+}
+
+
+
+/**
+ * put_bits() - appends the low bits of a value to a stream
+ *
+ * @param writer   Stream being written
+ * @param value    Bits to write, nothing above the low count bits
+ * @param count    Number of bits, 1 to 32
+ */
+static void put_bits(BitWriter_t* writer, uint64_t value, int count) {
+    writer->bits = (writer->bits << count) | value;
+    writer->fill += count;
+
+    while (writer->fill >= 8) {
+        writer->fill -= 8;
+        writer->out[writer->size++] = (uint8_t)(writer->bits >> writer->fill);
+    }
+}
+
+
+
+/**
+ * get_bits() - reads the next bits of a block's stream
+ *
+ * @param reader   Cursor decoding the block
+ * @param count    Number of bits, 0 to 32
+ * @return         the bits read
+ */
+static uint64_t get_bits(BlockReader_t* reader, int count) {
+    while (reader->fill < count) {
+        reader->bits = (reader->bits << 8) |
+                       reader->block->stream[reader->position++];
+        reader->fill += 8;
+    }
+
+    reader->fill -= count;
+
+    return (reader->bits >> reader->fill) & ((1ull << count) - 1);
+}
+
+
+
+/**
+ * get_prefix() - reads a code of up to most ones ended by a zero
+ *
+ * @param reader   Cursor decoding the block
+ * @param most     Longest code, which has no zero after it
+ * @return         number of ones read
+ */
+static int get_prefix(BlockReader_t* reader, int most) {
+    int ones = 0;
+
+    while (ones < most && get_bits(reader, 1) == 1) {
+        ones++;
+    }
+
+    return ones;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file        temp_humid_archive.h
+ * @brief
+ * Defines a compressed, read-only archive for cold Temp/Humidity readings.
+ * Readings are cut into blocks of up to ARCHIVE_BLOCK_READINGS in timestamp
+ * order and each block is encoded as one bit stream:
+ *   - timestamps as delta-of-delta, so a fixed cadence costs one bit each
+ *   - temperature and humidity as the change from the previous reading,
+ *     falling back to the raw value packed into 20 bits, the width of the
+ *     AHT20 registers (32 bits in a block holding any wider value)
+ *
+ * A Data_t in a tree node costs sizeof(Node_t), 40 to 80 bytes. A block of
+ * slowly changing daily readings costs a few bytes per reading. Blocks are
+ * decoded one reading at a time by a BlockReader_t, so a range scan never
+ * expands more than the reading it is looking at.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef TEMP_HUMID_ARCHIVE_H
+#define TEMP_HUMID_ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "temp_humid_bst.h"
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Most readings encoded in one block
+#define ARCHIVE_BLOCK_READINGS  1024
+
+// Width of a raw AHT20 register value
+#define ARCHIVE_VALUE_BITS      20
+
+
+// Defines one compressed block of readings in timestamp order
+typedef struct temperature_humidity_block {
+    time_t first;           // Timestamp of the first reading
+    time_t last;            // Timestamp of the last reading
+    uint32_t count;         // Number of readings in the block
+    uint32_t value_bits;    // Width of a raw value, 20 or 32
+    size_t size;            // Length of stream in bytes
+    uint8_t* stream;        // Encoded readings, see temp_humid_archive.c
+} Block_t;
+
+
+
+// Defines a compressed archive, blocks in timestamp order
+typedef struct temperature_humidity_archive {
+    Block_t* blocks;        // Blocks, none overlapping
+    size_t block_count;     // Number of blocks
+    size_t count;           // Number of readings in all blocks
+} Archive_t;
+
+
+
+// Defines a cursor decoding one block a reading at a time
+typedef struct temperature_humidity_block_reader {
+    const Block_t* block;   // Block being decoded
+    size_t position;        // Next byte of the stream to load
+    uint64_t bits;          // Bits loaded but not yet used, lowest fill bits
+    int fill;               // Number of bits in bits
+    uint32_t left;          // Readings not yet decoded
+    uint64_t delta;         // Gap between the last two timestamps
+    Data_t last;            // Reading decoded last
+} BlockReader_t;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * archive_readings() - compresses readings sorted by timestamp
+ *
+ * @param	readings	array of readings in non-decreasing timestamp order
+ * @param	count		number of readings in the array
+ * @return				pointer to the new archive, or NULL if allocation
+ *						fails or the readings are not sorted
+ */
+Archive_t* archive_readings(const Data_t* readings, size_t count);
+
+
+
+/**
+ * archive_tree() - compresses every reading in a tree
+ *
+ * @param	tree	pointer to the TempHumidtree to archive.  The tree is not
+ *					modified and may be deleted once the archive is built
+ * @return			pointer to the new archive or NULL if it fails
+ */
+Archive_t* archive_tree(const Tree_t* tree);
+
+
+
+/**
+ * archive_search_range() - visits every reading with a timestamp in
+ *                          [t_begin, t_end] in timestamp order
+ *
+ * @param	archive		pointer to the archive to scan
+ * @param	t_begin		first timestamp of the range (inclusive)
+ * @param	t_end		last timestamp of the range (inclusive)
+ * @param	visit		callback called once per reading in the range
+ * @param	context		caller data passed through to visit
+ * @return				number of readings visited
+ *
+ * @note The first block is found by binary search on the block timestamps
+ * and blocks are decoded as they are reached, so the cost is O(log b) plus
+ * the readings decoded in the blocks the range touches.
+ */
+size_t archive_search_range(const Archive_t* archive, time_t t_begin,
+                            time_t t_end, Visit_t visit, void* context);
+
+
+
+/**
+ * archive_bytes() - returns the memory held by an archive in bytes
+ */
+size_t archive_bytes(const Archive_t* archive);
+
+
+
+/**
+ * block_reader_begin() - positions a cursor before the first reading in a
+ *                        block
+ *
+ * @param	reader	cursor to set up
+ * @param	block	block to decode, must outlive the cursor
+ */
+void block_reader_begin(BlockReader_t* reader, const Block_t* block);
+
+
+
+/**
+ * block_reader_next() - decodes the next reading in a block
+ *
+ * @param	reader	cursor set up by block_reader_begin()
+ * @param	out		filled with the reading
+ * @return			true if a reading was decoded, false at the end of the
+ *					block
+ */
+bool block_reader_next(BlockReader_t* reader, Data_t* out);
+
+
+
+/**
+ * delete_archive() - frees all memory used by an archive
+ *
+ * @param archive   Represents pointer to the archive to delete/free
+ */
+void delete_archive(Archive_t* archive);
+
+
+
+#endif
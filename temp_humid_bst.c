@@ -3,7 +3,8 @@
  * @brief
  * Implements the Binary Search Tree ADT functions defined in temp_humid_bst.h.
  * Provides creation, insertion, search, and traversal operations for handling
- * temperature and humidity readings with timestamps.
+ * temperature and humidity readings with timestamps. Insertion keeps the tree
+ * height balanced using AVL rotations.
  *
  * @version     1.0.0
  * @author      Danny V. Restrepo (restrepo@pdx.edu)
@@ -12,7 +13,65 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
 #include "temp_humid_bst.h"
+#include "temp_humid_wal.h"
+#include "temp_humid_export.h"
+#include "bst_log.h"
+
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+#ifdef __GNUC__
+#define BST_PREFETCH(addr)  __builtin_prefetch(addr)
+#else
+#define BST_PREFETCH(addr)  ((void)0)
+#endif
+
+// Defines a lookup key paired with its position in the caller's batch
+typedef struct {
+    time_t key;
+    size_t index;
+} KeyIndex_t;
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static Node_t* build_balanced(Node_t* nodes, size_t low, size_t high);
+static Node_t* load_root(const Tree_t* tree);
+static Node_t* insert_shared(Tree_t* tree, Node_t* new_node);
+static bool log_insert(Tree_t* tree, const Data_t* info);
+static void node_reclaim(void* memory, void* context);
+static int compare_timestamps(const void* a, const void* b);
+static size_t many_recursive(Node_t* node, const time_t* keys,
+                             const size_t* order, size_t low, size_t high,
+                             Node_t** out);
+static size_t key_bound(const time_t* keys, size_t low, size_t high, 
+                        time_t timestamp, bool inclusive);
+static int compare_key_index(const void* a, const void* b);
+static bool range_recursive(const Node_t* node, time_t t_begin, time_t t_end,
+                            Visit_t visit, void* context, size_t* visited);
+static Node_t* drop_before(Tree_t* tree, Node_t* node, time_t cutoff,
+                           size_t* removed);
+static size_t free_subtree(Tree_t* tree, Node_t* node);
+static Node_t* join(Node_t* left, Node_t* node, Node_t* right);
+static Node_t* node_alloc(Tree_t* tree);
+static void node_free(Tree_t* tree, Node_t* node);
+static int node_height(const Node_t* node);
+static void node_update(Node_t* node);
+static void summary_clear(Summary_t* summary);
+static void summary_add_reading(Summary_t* summary, const Data_t* reading);
+#if BST_AGGREGATES
+static void summary_add(Summary_t* summary, const Node_t* node);
+#else
+static bool summary_visit(const Data_t* reading, void* context);
+#endif
+static Node_t* rotate_left(Node_t* node);
+static Node_t* rotate_right(Node_t* node);
+static Node_t* rebalance(Node_t* node);
 
 
 
@@ -26,11 +85,18 @@ Tree_t* create_tree(void) {
     if (new_tree != NULL) {
         new_tree->root = NULL;
         new_tree->node_count = 0;
-        printf("INFO(create_tree()): Successfully created a "
-               "Temp/Humidity tree.\n");
+        new_tree->slabs = NULL;
+        new_tree->slab_used = 0;
+        new_tree->free_list = NULL;
+        new_tree->epoch = NULL;
+        new_tree->wal = NULL;
+        BST_LOG(BST_LOG_INFO,
+                "INFO(create_tree()): Successfully created a "
+                "Temp/Humidity tree.\n");
     }
     else {
-        printf("ERROR(create_tree()): Failed to create tree.\n");
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(create_tree()): Failed to create tree.\n");
     }
 
     return new_tree;
@@ -38,17 +104,107 @@ Tree_t* create_tree(void) {
 
 
 
+Tree_t* build_tree_from_sorted(const Data_t* readings, size_t count) {
+    // Validates input parameters
+    if (readings == NULL && count > 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(build_tree_from_sorted()): Cannot build from NULL "
+                "readings.\n");
+        return NULL;
+    }
+
+    // node_count is an int, and the snapshot and archive code size their
+    // buffers from it
+    if (count > INT_MAX) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(build_tree_from_sorted()): %zu readings is more than "
+                "a tree can hold.\n", count);
+        return NULL;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        if (readings[i].timestamp < readings[i - 1].timestamp) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(build_tree_from_sorted()): Readings are not sorted "
+                    "at index %zu.\n", i);
+            return NULL;
+        }
+    }
+
+    Tree_t* tree = create_tree();
+    if (tree == NULL || count == 0) {
+        return tree;
+    }
+
+    // Allocates a single slab sized to hold every reading
+    Slab_t* slab = (Slab_t*)malloc(sizeof(Slab_t) + count * sizeof(Node_t));
+    if (slab == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(build_tree_from_sorted()): Failed to allocate memory "
+                "for %zu nodes.\n", count);
+        delete_tree(tree);
+        return NULL;
+    }
+
+    slab->next = NULL;
+    slab->capacity = count;
+    tree->slabs = slab;
+    tree->slab_used = count;
+
+    // Node i holds reading i, the middle of each range becomes its root
+    for (size_t i = 0; i < count; i++) {
+        slab->nodes[i].data = readings[i];
+    }
+
+    tree->root = build_balanced(slab->nodes, 0, count);
+    tree->node_count = (int)count;
+
+    BST_LOG(BST_LOG_INFO,
+            "INFO(build_tree_from_sorted()): Built balanced tree from %zu "
+            "readings.\n", count);
+
+    return tree;
+}
+
+
+
+Tree_t* build_tree(Data_t* readings, size_t count) {
+    if (readings == NULL && count > 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(build_tree()): Cannot build from NULL readings.\n");
+        return NULL;
+    }
+
+    // Logged readings usually arrive in order already, which skips the sort
+    size_t sorted = 1;
+
+    while (sorted < count &&
+           readings[sorted - 1].timestamp <= readings[sorted].timestamp) {
+        sorted++;
+    }
+
+    if (sorted < count) {
+        qsort(readings, count, sizeof(Data_t), compare_timestamps);
+    }
+
+    return build_tree_from_sorted(readings, count);
+}
+
+
+
 Node_t* insert(Tree_t* tree, Data_t info) {
     // Validates input parameters
     if (tree == NULL) {
-        printf("ERROR(insert()): Cannot insert into NULL tree.\n");
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(insert()): Cannot insert into NULL tree.\n");
         return NULL;
     }
 
     // Creates and initializes new node
-    Node_t* new_node = (Node_t*)malloc(sizeof(Node_t));
+    Node_t* new_node = node_alloc(tree);
     if (new_node == NULL) {
-        printf("ERROR(insert()): Failed to allocate memory for new node.\n");
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(insert()): Failed to allocate memory for new node.\n");
         return NULL;
     }
     
@@ -56,72 +212,140 @@ Node_t* insert(Tree_t* tree, Data_t info) {
     new_node->data = info;
     new_node->left = NULL;
     new_node->right = NULL;
+    node_update(new_node);
+
+    // Readers may be walking a shared tree, so leave its nodes untouched
+    if (tree->epoch != NULL) {
+        return insert_shared(tree, new_node);
+    }
+
+    // Nothing below can fail, so the log only ever holds inserted readings
+    if (!log_insert(tree, &info)) {
+        node_free(tree, new_node);
+        return NULL;
+    }
 
     // Handles empty tree case
     if (tree->root == NULL) {
         tree->root = new_node;
         tree->node_count++;
-        printf("INFO(insert()): Tree is empty... inserting root node.\n");
+        BST_LOG(BST_LOG_INFO,
+                "INFO(insert()): Tree is empty... inserting root node.\n");
         return new_node;
     }
 
-    // Finds insertion point in non-empty tree
-    Node_t* current = tree->root;
-    Node_t* parent = NULL;
-    
-    while (current != NULL) {
-        parent = current;
-        
+    // Finds insertion point in non-empty tree, remembering the links we
+    // follow so the path can be rebalanced on the way back up
+    Node_t** path[BST_MAX_HEIGHT];
+    int depth = 0;
+    Node_t** link = &tree->root;
+
+    while (*link != NULL) {
+        path[depth++] = link;
+
         // Navigates based on timestamp comparison
-        if (info.timestamp < current->data.timestamp) {
-            current = current->left;
+        if (info.timestamp < (*link)->data.timestamp) {
+            link = &(*link)->left;
         }
         else {
-            current = current->right;
+            link = &(*link)->right;
         }
     }
-    
+
     // Inserts node at found position
-    if (info.timestamp < parent->data.timestamp) {
-        parent->left = new_node;
-    }
-    else {
-        parent->right = new_node;
-    }
-    
+    *link = new_node;
     tree->node_count++;
 
+    // Retraces the path, rotating any subtree that became unbalanced. Once a
+    // subtree's height is unchanged its ancestors' balance cannot be affected
+    while (depth > 0) {
+        Node_t** parent_link = path[--depth];
+        int old_height = (*parent_link)->height;
+
+        *parent_link = rebalance(*parent_link);
+
+        // Every ancestor's summary gains the new reading, so with summaries
+        // the retrace always runs to the root
+        if (!BST_AGGREGATES && (*parent_link)->height == old_height) {
+            break;
+        }
+    }
+
     return new_node;
 }
 
 
 
+bool share_tree(Tree_t* tree) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(share_tree()): Cannot share NULL tree.\n");
+        return false;
+    }
+
+    if (tree->epoch == NULL) {
+        tree->epoch = create_epoch(node_reclaim, tree);
+    }
+
+    return tree->epoch != NULL;
+}
+
+
+
+int tree_add_reader(Tree_t* tree) {
+    if (tree == NULL || tree->epoch == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_add_reader()): Tree is not shared.\n");
+        return -1;
+    }
+
+    return epoch_register(tree->epoch);
+}
+
+
+
+void tree_read_begin(Tree_t* tree, int reader) {
+    epoch_enter(tree->epoch, reader);
+}
+
+
+
+void tree_read_end(Tree_t* tree, int reader) {
+    epoch_exit(tree->epoch, reader);
+}
+
+
+
 Node_t* search(Tree_t* tree, time_t timestamp) {
     if (tree == NULL) {
-        printf("ERROR(search()): Cannot search NULL tree.\n");
+        BST_LOG(BST_LOG_ERROR, "ERROR(search()): Cannot search NULL tree.\n");
         return NULL;
     }
 
     // Validates timestamp
     if (timestamp < 0) {
-        printf("ERROR(search()): Invalid timestamp %ld.\n", timestamp);
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(search()): Invalid timestamp %ld.\n", timestamp);
         return NULL;
     }
 
     // Continues with normal search operation
-    printf("INFO(search()): Starting search for timestamp %ld.\n", timestamp);
-    printf("INFO(search()): Visiting these nodes:\n");
+    BST_LOG(BST_LOG_TRACE,
+            "INFO(search()): Starting search for timestamp %ld.\n", timestamp);
+    BST_LOG(BST_LOG_TRACE, "INFO(search()): Visiting these nodes:\n");
     
-    Node_t* current = tree->root;
+    Node_t* current = load_root(tree);
     
     // Searches until the program finds the timestamp or hits a leaf
     while (current != NULL && current->data.timestamp != timestamp) {
-        char date_str[26];
-        strftime(date_str,
-                 sizeof(date_str), 
-                 "%c", 
-                 localtime(&current->data.timestamp));
-        printf("-> [%ld] %s\n", current->data.timestamp, date_str);
+        if (BST_LOG_ENABLED(BST_LOG_TRACE)) {
+            char date_str[26];
+            strftime(date_str,
+                     sizeof(date_str), 
+                     "%c", 
+                     localtime(&current->data.timestamp));
+            printf("-> [%ld] %s\n", current->data.timestamp, date_str);
+        }
         
         if (timestamp < current->data.timestamp) {
             current = current->left;
@@ -132,7 +356,7 @@ Node_t* search(Tree_t* tree, time_t timestamp) {
     }
     
     // Reports if timestamp was found
-    if (current != NULL) {
+    if (current != NULL && BST_LOG_ENABLED(BST_LOG_TRACE)) {
         char date_str[26];
         strftime(date_str,
                  sizeof(date_str), 
@@ -146,65 +370,1100 @@ Node_t* search(Tree_t* tree, time_t timestamp) {
 
 
 
-void in_order(Tree_t* tree) {
+Node_t* search_floor(Tree_t* tree, time_t timestamp) {
     if (tree == NULL) {
-        printf("ERROR(in_order()): Cannot traverse NULL tree.\n");
-        return;
+        BST_LOG(BST_LOG_ERROR, 
+                "ERROR(search_floor()): Cannot search NULL tree.\n");
+        return NULL;
     }
 
-    printf("INFO(in_order()): There are %d nodes in the BST.\n", 
-           tree->node_count);
-    
-    // Starts recursive traversal from root
-    in_order_recursive(tree->root);
+    Node_t* floor = NULL;
+    Node_t* current = load_root(tree);
+
+    // Every node we step right from is a candidate, the last one is closest
+    while (current != NULL) {
+        if (current->data.timestamp <= timestamp) {
+            floor = current;
+            current = current->right;
+        }
+        else {
+            current = current->left;
+        }
+    }
+
+    return floor;
 }
 
 
 
-static void in_order_recursive(Node_t* node) {
-    if (node != NULL) {
-        // Traverses left subtree
-        in_order_recursive(node->left);
-        
-        // Displays current node's data
-        char date_str[26];
+Node_t* search_ceil(Tree_t* tree, time_t timestamp) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR, 
+                "ERROR(search_ceil()): Cannot search NULL tree.\n");
+        return NULL;
+    }
 
-        strftime(date_str, sizeof(date_str), "%d-%b-%Y", 
-                 localtime(&node->data.timestamp));
+    Node_t* ceil = NULL;
+    Node_t* current = load_root(tree);
 
-        printf("%s     %08X %08X\n", 
-               date_str, node->data.temp, node->data.humid);
-        
-        // Traverses right subtree
-        in_order_recursive(node->right);
+    // Every node we step left from is a candidate, the last one is closest
+    while (current != NULL) {
+        if (current->data.timestamp >= timestamp) {
+            ceil = current;
+            current = current->left;
+        }
+        else {
+            current = current->right;
+        }
     }
+
+    return ceil;
 }
 
 
 
-/**
- * delete_tree() - recursively deletes/frees all nodes in the tree, deallocates
- *                 all memory used by the BST
- * @param tree   Represents pointer to the tree to delete/free
- */
-void delete_tree(Tree_t* tree) {
-    if (tree != NULL) {
-        delete_tree_recursive(tree->root);
-        free(tree);
+Node_t* search_nearest(Tree_t* tree, time_t timestamp) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR, 
+                "ERROR(search_nearest()): Cannot search NULL tree.\n");
+        return NULL;
+    }
+
+    Node_t* floor = NULL;
+    Node_t* ceil = NULL;
+    Node_t* current = load_root(tree);
+
+    // Tracks both neighbours in a single descent
+    while (current != NULL) {
+        if (current->data.timestamp == timestamp) {
+            return current;
+        }
+
+        if (current->data.timestamp < timestamp) {
+            floor = current;
+            current = current->right;
+        }
+        else {
+            ceil = current;
+            current = current->left;
+        }
+    }
+
+    if (floor == NULL || ceil == NULL) {
+        return (floor != NULL) ? floor : ceil;
+    }
+
+    // Differences are taken from the target so they cannot overflow
+    if (timestamp - floor->data.timestamp <= ceil->data.timestamp - timestamp) {
+        return floor;
     }
+
+    return ceil;
 }
 
 
 
-/**
- * delete_tree_recursive() - Helper function to recursively delete/free nodes
- * 
- * @param node   Current node being deleted/freed
- */
-static void delete_tree_recursive(Node_t* node) {
-    if (node != NULL) {
-        delete_tree_recursive(node->left);
-        delete_tree_recursive(node->right);
-        free(node);
+size_t search_many(Tree_t* tree, const time_t* keys, size_t count,
+                   Node_t** out) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(search_many()): Cannot search NULL tree.\n");
+        return 0;
+    }
+
+    if ((keys == NULL || out == NULL) && count > 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(search_many()): Keys and results must not be NULL.\n");
+        return 0;
+    }
+
+    bool sorted = true;
+
+    for (size_t i = 1; i < count && sorted; i++) {
+        sorted = (keys[i - 1] <= keys[i]);
+    }
+
+    if (sorted) {
+        return many_recursive(load_root(tree), keys, NULL, 0, count, out);
+    }
+
+    // Sorts (key, position) pairs, then splits them into a sorted copy of the
+    // keys and an index mapping each sorted key back to its position
+    KeyIndex_t* pairs = malloc(count * sizeof(KeyIndex_t));
+    time_t* sorted_keys = malloc(count * sizeof(time_t));
+    size_t* order = malloc(count * sizeof(size_t));
+
+    if (pairs == NULL || sorted_keys == NULL || order == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(search_many()): Failed to allocate memory to sort "
+                "%zu keys.\n", count);
+        free(pairs);
+        free(sorted_keys);
+        free(order);
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        pairs[i].key = keys[i];
+        pairs[i].index = i;
+    }
+
+    qsort(pairs, count, sizeof(KeyIndex_t), compare_key_index);
+
+    for (size_t i = 0; i < count; i++) {
+        sorted_keys[i] = pairs[i].key;
+        order[i] = pairs[i].index;
+    }
+
+    free(pairs);
+
+    size_t found = many_recursive(load_root(tree), sorted_keys, order, 0,
+                                  count, out);
+
+    free(sorted_keys);
+    free(order);
+
+    return found;
+}
+
+
+
+Summary_t aggregate_range(Tree_t* tree, time_t t_begin, time_t t_end) {
+    Summary_t summary;
+
+    summary_clear(&summary);
+
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(aggregate_range()): Cannot summarize NULL tree.\n");
+        return summary;
+    }
+
+    if (t_begin > t_end) {
+        return summary;
+    }
+
+#if BST_AGGREGATES
+    // Finds the topmost node inside the range, where its boundaries split
+    Node_t* split = load_root(tree);
+
+    while (split != NULL && (split->data.timestamp < t_begin ||
+                             split->data.timestamp > t_end)) {
+        split = (split->data.timestamp < t_begin) ? split->right : split->left;
+    }
+
+    if (split == NULL) {
+        return summary;
+    }
+
+    summary_add_reading(&summary, &split->data);
+
+    // Walks the left boundary: whenever a node is in the range, so is its
+    // whole right subtree
+    for (Node_t* node = split->left; node != NULL; ) {
+        if (node->data.timestamp >= t_begin) {
+            summary_add_reading(&summary, &node->data);
+            summary_add(&summary, node->right);
+            node = node->left;
+        }
+        else {
+            node = node->right;
+        }
+    }
+
+    // Walks the right boundary: whenever a node is in the range, so is its
+    // whole left subtree
+    for (Node_t* node = split->right; node != NULL; ) {
+        if (node->data.timestamp <= t_end) {
+            summary_add_reading(&summary, &node->data);
+            summary_add(&summary, node->left);
+            node = node->right;
+        }
+        else {
+            node = node->left;
+        }
+    }
+#else
+    search_range(tree, t_begin, t_end, summary_visit, &summary);
+#endif
+
+    return summary;
+}
+
+
+
+size_t search_range(Tree_t* tree, time_t t_begin, time_t t_end,
+                    Visit_t visit, void* context) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(search_range()): Cannot search NULL tree.\n");
+        return 0;
+    }
+
+    if (visit == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(search_range()): No visit callback given.\n");
+        return 0;
+    }
+
+    size_t visited = 0;
+
+    if (t_begin <= t_end) {
+        range_recursive(load_root(tree), t_begin, t_end, visit, context, 
+                        &visited);
+    }
+
+    return visited;
+}
+
+
+
+bool delete_node(Tree_t* tree, time_t timestamp) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(delete_node()): Cannot delete from NULL tree.\n");
+        return false;
+    }
+
+    if (tree->epoch != NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(delete_node()): Cannot delete from a shared tree.\n");
+        return false;
+    }
+
+    // Finds the node, remembering the links we follow for rebalancing
+    Node_t** path[BST_MAX_HEIGHT];
+    int depth = 0;
+    Node_t** link = &tree->root;
+
+    while (*link != NULL && (*link)->data.timestamp != timestamp) {
+        path[depth++] = link;
+
+        if (timestamp < (*link)->data.timestamp) {
+            link = &(*link)->left;
+        }
+        else {
+            link = &(*link)->right;
+        }
+    }
+
+    if (*link == NULL) {
+        return false;
     }
-}
\ No newline at end of file
+
+    Node_t* target = *link;
+
+    // With two children, the in-order successor (leftmost node of the right
+    // subtree) takes the target's place and is unlinked instead
+    if (target->left != NULL && target->right != NULL) {
+        path[depth++] = link;
+        link = &target->right;
+
+        while ((*link)->left != NULL) {
+            path[depth++] = link;
+            link = &(*link)->left;
+        }
+
+        target->data = (*link)->data;
+        target = *link;
+    }
+
+    // The node being unlinked has at most one child, which takes its place
+    *link = (target->left != NULL) ? target->left : target->right;
+    node_free(tree, target);
+    tree->node_count--;
+
+    // Retraces the whole path, a deletion can need a rotation at every level
+    while (depth > 0) {
+        Node_t** parent_link = path[--depth];
+        *parent_link = rebalance(*parent_link);
+    }
+
+    return true;
+}
+
+
+
+size_t delete_before(Tree_t* tree, time_t cutoff) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(delete_before()): Cannot delete from NULL tree.\n");
+        return 0;
+    }
+
+    if (tree->epoch != NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(delete_before()): Cannot delete from a shared "
+                "tree.\n");
+        return 0;
+    }
+
+    size_t removed = 0;
+
+    tree->root = drop_before(tree, tree->root, cutoff, &removed);
+    tree->node_count -= (int)removed;
+
+    return removed;
+}
+
+
+
+void in_order(Tree_t* tree) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(in_order()): Cannot traverse NULL tree.\n");
+        return;
+    }
+
+    BST_LOG(BST_LOG_INFO,
+            "INFO(in_order()): There are %d nodes in the BST.\n", 
+            tree->node_count);
+    
+    // Displays each reading's data in timestamp order, after anything
+    // already printf()'d so the table lands in the right place
+    fflush(stdout);
+    tree_export(tree, STDOUT_FILENO);
+}
+
+
+
+void tree_iter_begin(TreeIter_t* iter, const Tree_t* tree) {
+    if (iter == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_iter_begin()): Cannot initialize NULL cursor.\n");
+        return;
+    }
+
+    iter->depth = 0;
+
+    // Pushes the path down to the oldest reading
+    for (const Node_t* node = (tree != NULL) ? load_root(tree) : NULL;
+         node != NULL; node = node->left) {
+        iter->stack[iter->depth++] = node;
+    }
+}
+
+
+
+void tree_iter_seek(TreeIter_t* iter, const Tree_t* tree, time_t timestamp) {
+    if (iter == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_iter_seek()): Cannot initialize NULL cursor.\n");
+        return;
+    }
+
+    iter->depth = 0;
+
+    // Keeps only the nodes at or after the timestamp, the oldest on top
+    const Node_t* node = (tree != NULL) ? load_root(tree) : NULL;
+
+    while (node != NULL) {
+        if (node->data.timestamp >= timestamp) {
+            iter->stack[iter->depth++] = node;
+            node = node->left;
+        }
+        else {
+            node = node->right;
+        }
+    }
+}
+
+
+
+const Data_t* tree_iter_next(TreeIter_t* iter) {
+    if (iter == NULL || iter->depth == 0) {
+        return NULL;
+    }
+
+    const Node_t* node = iter->stack[--iter->depth];
+
+    // The next reading after this one is the leftmost in its right subtree
+    for (const Node_t* next = node->right; next != NULL; next = next->left) {
+        iter->stack[iter->depth++] = next;
+    }
+
+    return &node->data;
+}
+
+
+
+void tree_iter_end(TreeIter_t* iter) {
+    if (iter != NULL) {
+        iter->depth = 0;
+    }
+}
+
+
+
+void delete_tree(Tree_t* tree) {
+    if (tree != NULL) {
+        // Retired nodes live in the slabs too, only the lists need freeing
+        delete_epoch(tree->epoch);
+
+        // Frees whole slabs, the nodes inside them go with them
+        Slab_t* slab = tree->slabs;
+
+        while (slab != NULL) {
+            Slab_t* next = slab->next;
+            free(slab);
+            slab = next;
+        }
+
+        free(tree);
+    }
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * load_root() - reads the root pointer of a tree that may be shared
+ *
+ * @param tree   Tree whose root to read
+ * @return       Root node, every node reachable from it is fully written
+ */
+static Node_t* load_root(const Tree_t* tree) {
+    return __atomic_load_n(&tree->root, __ATOMIC_ACQUIRE);
+}
+
+
+
+/**
+ * insert_shared() - inserts a node into a shared tree by copying its path
+ *
+ * @param tree       Shared tree to insert into
+ * @param new_node   Initialized leaf to insert
+ * @return           new_node, or NULL if a copy or room to retire the
+ *                   originals could not be allocated
+ *
+ * Every node on the path from the root is copied and only the copies are
+ * relinked and rotated. The AVL rotations an insert needs only involve nodes
+ * on that path, so nodes readers can reach are never written. The copies are
+ * published by storing the new root, and the originals are retired.
+ */
+static Node_t* insert_shared(Tree_t* tree, Node_t* new_node) {
+    Node_t* originals[BST_MAX_HEIGHT];
+    Node_t* copies[BST_MAX_HEIGHT];
+    int depth = 0;
+    time_t timestamp = new_node->data.timestamp;
+
+    // Copies the path down to the insertion point
+    for (Node_t* node = tree->root; node != NULL; ) {
+        Node_t* copy = node_alloc(tree);
+
+        if (copy == NULL) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(insert()): Failed to allocate memory for path "
+                    "copy.\n");
+
+            // Nothing was published, so the copies can be reused at once
+            while (depth > 0) {
+                node_free(tree, copies[--depth]);
+            }
+            node_free(tree, new_node);
+            return NULL;
+        }
+
+        *copy = *node;
+        originals[depth] = node;
+        copies[depth++] = copy;
+        node = (timestamp < node->data.timestamp) ? node->left : node->right;
+    }
+
+    // Every copy is in hand and the originals have room in limbo, so the
+    // insert can no longer fail
+    if (epoch_reserve(tree->epoch, (size_t)depth) != 0
+        || !log_insert(tree, &new_node->data)) {
+        while (depth > 0) {
+            node_free(tree, copies[--depth]);
+        }
+        node_free(tree, new_node);
+        return NULL;
+    }
+
+    // Links the copies back up, rebalancing each one
+    Node_t* child = new_node;
+
+    for (int i = depth - 1; i >= 0; i--) {
+        if (timestamp < copies[i]->data.timestamp) {
+            copies[i]->left = child;
+        }
+        else {
+            copies[i]->right = child;
+        }
+
+        child = rebalance(copies[i]);
+    }
+
+    __atomic_store_n(&tree->root, child, __ATOMIC_RELEASE);
+    tree->node_count++;
+
+    // Readers that loaded the old root may still be on the old path. The
+    // room reserved above means none of these can fail
+    for (int i = 0; i < depth; i++) {
+        epoch_retire(tree->epoch, originals[i]);
+    }
+
+    return new_node;
+}
+
+
+
+/**
+ * log_insert() - appends a reading to the tree's write-ahead log, if it has
+ *                one, once the insert is certain to succeed
+ *
+ * @param tree   Tree being inserted into
+ * @param info   Reading being inserted
+ * @return       true if logged or the tree has no log
+ *
+ * The record is durable once its group commits, so a crash can still lose
+ * the readings of a group that has not been committed yet.
+ */
+static bool log_insert(Tree_t* tree, const Data_t* info) {
+    if (tree->wal != NULL && !wal_append(tree->wal, info)) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(insert()): Failed to log reading, not inserted.\n");
+        return false;
+    }
+
+    return true;
+}
+
+
+
+/**
+ * node_reclaim() - returns a retired node to its tree's free list
+ *
+ * @param memory    Node no reader can reach any more
+ * @param context   Tree the node belongs to
+ */
+static void node_reclaim(void* memory, void* context) {
+    node_free((Tree_t*)context, (Node_t*)memory);
+}
+
+
+
+/**
+ * build_balanced() - links nodes[low, high) into a perfectly balanced subtree
+ *
+ * @param nodes   Nodes whose data is already in timestamp order
+ * @param low     Index of first node in the range
+ * @param high    One past the index of the last node in the range
+ * @return        Root of the subtree, NULL for an empty range
+ */
+static Node_t* build_balanced(Node_t* nodes, size_t low, size_t high) {
+    if (low >= high) {
+        return NULL;
+    }
+
+    size_t mid = low + (high - low) / 2;
+    Node_t* node = &nodes[mid];
+
+    node->left = build_balanced(nodes, low, mid);
+    node->right = build_balanced(nodes, mid + 1, high);
+    node_update(node);
+
+    return node;
+}
+
+
+
+/**
+ * compare_timestamps() - qsort() comparator ordering readings by timestamp
+ */
+static int compare_timestamps(const void* a, const void* b) {
+    time_t ts_a = ((const Data_t*)a)->timestamp;
+    time_t ts_b = ((const Data_t*)b)->timestamp;
+
+    return (ts_a > ts_b) - (ts_a < ts_b);
+}
+
+
+
+/**
+ * many_recursive() - Helper function for search_many(), resolves the sorted
+ *                    keys [low, high) against a subtree
+ *
+ * @param node    Root of the subtree
+ * @param keys    Timestamps being looked up, in sorted order
+ * @param order   Position in the caller's batch of each sorted key, NULL if
+ *                the caller's keys were already sorted
+ * @param low     First sorted key handled by this subtree
+ * @param high    One past the last sorted key handled by this subtree
+ * @param out     Results, indexed by position in the caller's batch
+ * @return        Number of keys found in the subtree
+ */
+static size_t many_recursive(Node_t* node, const time_t* keys,
+                             const size_t* order, size_t low, size_t high,
+                             Node_t** out) {
+    if (low >= high) {
+        return 0;
+    }
+
+    // A lone key has no path left to share, so it just walks down
+    if (high - low == 1) {
+        time_t key = keys[low];
+
+        while (node != NULL && node->data.timestamp != key) {
+            node = (key < node->data.timestamp) ? node->left : node->right;
+        }
+
+        out[(order != NULL) ? order[low] : low] = node;
+        return (node != NULL) ? 1 : 0;
+    }
+
+    if (node == NULL) {
+        for (size_t i = low; i < high; i++) {
+            out[(order != NULL) ? order[i] : i] = NULL;
+        }
+        return 0;
+    }
+
+    // Splits the keys into [low, less) going left, [less, more) matching
+    // this node and [more, high) going right
+    size_t less = key_bound(keys, low, high, node->data.timestamp, false);
+    size_t more = key_bound(keys, less, high, node->data.timestamp, true);
+
+    for (size_t i = less; i < more; i++) {
+        out[(order != NULL) ? order[i] : i] = node;
+    }
+
+    // Both children will be needed, so the right one is fetched while the
+    // left subtree is being walked
+    if (less > low && high > more && node->right != NULL) {
+        BST_PREFETCH(node->right);
+    }
+
+    return (more - less) +
+           many_recursive(node->left, keys, order, low, less, out) +
+           many_recursive(node->right, keys, order, more, high, out);
+}
+
+
+
+/**
+ * key_bound() - binary searches sorted keys for the first position whose key
+ *               is >= timestamp, or > timestamp if inclusive is true
+ *
+ * @param keys        Timestamps in sorted order
+ * @param low         First position to consider
+ * @param high        One past the last position to consider
+ * @param timestamp   Timestamp to compare against
+ * @param inclusive   true to skip past keys equal to timestamp
+ * @return            The bounding position in [low, high]
+ */
+static size_t key_bound(const time_t* keys, size_t low, size_t high, 
+                        time_t timestamp, bool inclusive) {
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if (keys[mid] < timestamp || (inclusive && keys[mid] == timestamp)) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+
+
+/**
+ * compare_key_index() - qsort() comparator ordering (key, position) pairs
+ *                       by key
+ */
+static int compare_key_index(const void* a, const void* b) {
+    time_t key_a = ((const KeyIndex_t*)a)->key;
+    time_t key_b = ((const KeyIndex_t*)b)->key;
+
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+
+
+/**
+ * range_recursive() - Helper function for search_range(), visits the readings
+ *                     of a subtree that fall in [t_begin, t_end] in order
+ *
+ * @param node      Root of the subtree
+ * @param t_begin   First timestamp of the range
+ * @param t_end     Last timestamp of the range
+ * @param visit     Callback for each reading in the range
+ * @param context   Caller data passed through to visit
+ * @param visited   Running count of readings visited
+ * @return          false if visit asked to stop, true otherwise
+ */
+static bool range_recursive(const Node_t* node, time_t t_begin, time_t t_end,
+                            Visit_t visit, void* context, size_t* visited) {
+    if (node == NULL) {
+        return true;
+    }
+
+    time_t timestamp = node->data.timestamp;
+
+    // Left subtree only holds timestamps <= this one, skip it if all are early
+    if (t_begin <= timestamp && 
+        !range_recursive(node->left, t_begin, t_end, visit, context, visited)) {
+        return false;
+    }
+
+    if (t_begin <= timestamp && timestamp <= t_end) {
+        (*visited)++;
+
+        if (!visit(&node->data, context)) {
+            return false;
+        }
+    }
+
+    // Right subtree only holds timestamps >= this one, skip it if all are late
+    if (timestamp <= t_end) {
+        return range_recursive(node->right, t_begin, t_end, visit, context, 
+                               visited);
+    }
+
+    return true;
+}
+
+
+
+/**
+ * drop_before() - Helper function for delete_before(), removes the readings
+ *                 of a subtree older than cutoff
+ *
+ * A node older than the cutoff takes its whole left subtree with it, and the
+ * search carries on in its right subtree. A node that stays is rejoined with
+ * what is left of its left subtree, which restores the AVL property.
+ *
+ * @param tree      Tree that owns the nodes
+ * @param node      Root of the subtree
+ * @param cutoff    Readings with timestamps < cutoff are removed
+ * @param removed   Running count of readings removed
+ * @return          Root of the trimmed subtree
+ */
+static Node_t* drop_before(Tree_t* tree, Node_t* node, time_t cutoff,
+                           size_t* removed) {
+    while (node != NULL && node->data.timestamp < cutoff) {
+        Node_t* right = node->right;
+
+        *removed += free_subtree(tree, node->left) + 1;
+        node_free(tree, node);
+        node = right;
+    }
+
+    if (node == NULL) {
+        return NULL;
+    }
+
+    Node_t* left = drop_before(tree, node->left, cutoff, removed);
+
+    return join(left, node, node->right);
+}
+
+
+
+/**
+ * free_subtree() - returns every node of a subtree to the tree's free list
+ *
+ * @param tree   Tree that owns the nodes
+ * @param node   Root of the subtree
+ * @return       Number of nodes freed
+ */
+static size_t free_subtree(Tree_t* tree, Node_t* node) {
+    if (node == NULL) {
+        return 0;
+    }
+
+    Node_t* left = node->left;
+    Node_t* right = node->right;
+
+    node_free(tree, node);
+
+    return 1 + free_subtree(tree, left) + free_subtree(tree, right);
+}
+
+
+
+/**
+ * join() - joins two AVL subtrees and a node that sorts between them
+ *
+ * Walks down the spine of the taller subtree until it reaches a subtree no
+ * more than one level taller than the other, hangs the node there, then
+ * rebalances back up. Costs O(|height(left) - height(right)|).
+ *
+ * @param left    Subtree of readings <= node's timestamp
+ * @param node    Node to place between them
+ * @param right   Subtree of readings >= node's timestamp
+ * @return        Root of the joined subtree
+ */
+static Node_t* join(Node_t* left, Node_t* node, Node_t* right) {
+    int left_height = node_height(left);
+    int right_height = node_height(right);
+
+    if (left_height > right_height + 1) {
+        left->right = join(left->right, node, right);
+        return rebalance(left);
+    }
+
+    if (right_height > left_height + 1) {
+        right->left = join(left, node, right->left);
+        return rebalance(right);
+    }
+
+    node->left = left;
+    node->right = right;
+    node_update(node);
+
+    return node;
+}
+
+
+
+/**
+ * node_alloc() - hands out an uninitialized node from the tree's slabs
+ *
+ * Reuses a node from the free list if there is one, otherwise carves the next
+ * node out of the newest slab. When that slab is full a new one twice its size
+ * (up to BST_SLAB_MAX_NODES) is allocated, so nodes inserted together end up
+ * next to each other in memory.
+ *
+ * @param tree   Tree that will own the node
+ * @return       Pointer to the node or NULL if out of memory
+ */
+static Node_t* node_alloc(Tree_t* tree) {
+    if (tree->free_list != NULL) {
+        Node_t* node = tree->free_list;
+        tree->free_list = node->left;
+        return node;
+    }
+
+    if (tree->slabs == NULL || tree->slab_used == tree->slabs->capacity) {
+        size_t capacity = BST_SLAB_MIN_NODES;
+
+        if (tree->slabs != NULL) {
+            capacity = tree->slabs->capacity * 2;
+
+            if (capacity > BST_SLAB_MAX_NODES) {
+                capacity = BST_SLAB_MAX_NODES;
+            }
+        }
+
+        Slab_t* slab = (Slab_t*)malloc(sizeof(Slab_t) + 
+                                       capacity * sizeof(Node_t));
+        if (slab == NULL) {
+            return NULL;
+        }
+
+        slab->next = tree->slabs;
+        slab->capacity = capacity;
+        tree->slabs = slab;
+        tree->slab_used = 0;
+    }
+
+    return &tree->slabs->nodes[tree->slab_used++];
+}
+
+
+
+/**
+ * node_free() - returns a node to the tree's free list
+ *
+ * @param tree   Tree that owns the node
+ * @param node   Node that is no longer linked into the tree
+ */
+static void node_free(Tree_t* tree, Node_t* node) {
+    node->left = tree->free_list;
+    tree->free_list = node;
+}
+
+
+
+/**
+ * node_height() - returns the height of a subtree, 0 for an empty subtree
+ *
+ * @param node   Root of the subtree
+ */
+static int node_height(const Node_t* node) {
+    return (node != NULL) ? node->height : 0;
+}
+
+
+
+/**
+ * node_update() - recomputes a node's height from its children
+ *
+ * @param node   Node whose children may have changed
+ */
+static void node_update(Node_t* node) {
+    int left_height = node_height(node->left);
+    int right_height = node_height(node->right);
+
+    node->height = 1 + ((left_height > right_height) ? left_height 
+                                                     : right_height);
+
+#if BST_AGGREGATES
+    summary_clear(&node->summary);
+    summary_add(&node->summary, node->left);
+    summary_add_reading(&node->summary, &node->data);
+    summary_add(&node->summary, node->right);
+#endif
+}
+
+
+
+/**
+ * summary_clear() - resets a summary to cover no readings
+ */
+static void summary_clear(Summary_t* summary) {
+    summary->count = 0;
+    summary->temp_sum = 0;
+    summary->temp_min = UINT32_MAX;
+    summary->temp_max = 0;
+    summary->humid_sum = 0;
+    summary->humid_min = UINT32_MAX;
+    summary->humid_max = 0;
+}
+
+
+
+/**
+ * summary_add_reading() - adds one reading to a summary
+ */
+static void summary_add_reading(Summary_t* summary, const Data_t* reading) {
+    summary->count++;
+    summary->temp_sum += reading->temp;
+    summary->humid_sum += reading->humid;
+
+    if (reading->temp < summary->temp_min) {
+        summary->temp_min = reading->temp;
+    }
+    if (reading->temp > summary->temp_max) {
+        summary->temp_max = reading->temp;
+    }
+    if (reading->humid < summary->humid_min) {
+        summary->humid_min = reading->humid;
+    }
+    if (reading->humid > summary->humid_max) {
+        summary->humid_max = reading->humid;
+    }
+}
+
+
+
+#if BST_AGGREGATES
+/**
+ * summary_add() - adds a whole subtree's summary to a summary
+ *
+ * @param summary   Summary to add to
+ * @param node      Root of the subtree, may be NULL
+ */
+static void summary_add(Summary_t* summary, const Node_t* node) {
+    if (node == NULL) {
+        return;
+    }
+
+    const Summary_t* other = &node->summary;
+
+    summary->count += other->count;
+    summary->temp_sum += other->temp_sum;
+    summary->humid_sum += other->humid_sum;
+
+    if (other->temp_min < summary->temp_min) {
+        summary->temp_min = other->temp_min;
+    }
+    if (other->temp_max > summary->temp_max) {
+        summary->temp_max = other->temp_max;
+    }
+    if (other->humid_min < summary->humid_min) {
+        summary->humid_min = other->humid_min;
+    }
+    if (other->humid_max > summary->humid_max) {
+        summary->humid_max = other->humid_max;
+    }
+}
+#else
+/**
+ * summary_visit() - search_range() callback that adds a reading to the
+ *                   Summary_t passed as context
+ */
+static bool summary_visit(const Data_t* reading, void* context) {
+    summary_add_reading((Summary_t*)context, reading);
+    return true;
+}
+#endif
+
+
+
+/**
+ * rotate_left() - rotates a subtree left around its root
+ *
+ * @param node   Root of the subtree, must have a right child
+ * @return       New root of the subtree
+ */
+static Node_t* rotate_left(Node_t* node) {
+    Node_t* pivot = node->right;
+
+    node->right = pivot->left;
+    pivot->left = node;
+
+    node_update(node);
+    node_update(pivot);
+
+    return pivot;
+}
+
+
+
+/**
+ * rotate_right() - rotates a subtree right around its root
+ *
+ * @param node   Root of the subtree, must have a left child
+ * @return       New root of the subtree
+ */
+static Node_t* rotate_right(Node_t* node) {
+    Node_t* pivot = node->left;
+
+    node->left = pivot->right;
+    pivot->right = node;
+
+    node_update(node);
+    node_update(pivot);
+
+    return pivot;
+}
+
+
+
+/**
+ * rebalance() - restores the AVL property at a node whose children are
+ *               balanced but may differ in height by 2
+ *
+ * @param node   Root of the subtree to rebalance
+ * @return       New root of the subtree
+ */
+static Node_t* rebalance(Node_t* node) {
+    node_update(node);
+
+    int balance = node_height(node->left) - node_height(node->right);
+
+    // Left heavy, double rotation needed if left child leans right
+    if (balance > 1) {
+        if (node_height(node->left->left) < node_height(node->left->right)) {
+            node->left = rotate_left(node->left);
+        }
+        return rotate_right(node);
+    }
+
+    // Right heavy, double rotation needed if right child leans left
+    if (balance < -1) {
+        if (node_height(node->right->right) < node_height(node->right->left)) {
+            node->right = rotate_right(node->right);
+        }
+        return rotate_left(node);
+    }
+
+    return node;
+}
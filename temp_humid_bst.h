@@ -4,6 +4,8 @@
  * Defines a Binary Search Tree (BST) ADT specialized for storing temperature 
  * and humidity sensor readings with timestamps. The BST maintains data
  * in timestamp-sorted order, allowing efficient searching and ordered traversal.
+ * The tree is self-balancing (AVL), so readings can be inserted in timestamp
+ * order without the tree degenerating into a linked list.
  * The ADT includes core operations like creation, insertion, search, and 
  * inorder traversal with built-in display functionality.
  *
@@ -16,12 +18,28 @@
  #define TEMP_HUMID_BST_H
  
  #include <time.h>
+ #include <stddef.h>
  #include <stdint.h>
  #include <stdbool.h>
+ #include "bst_epoch.h"
  
 
  /*********************** Definitions, Typedefs, Structs ************************/
 
+// Upper bound on the height of an AVL tree, enough for well over 2^40 nodes
+#define BST_MAX_HEIGHT 64
+
+// Node counts for the first slab of a tree and the cap slabs double up to
+#define BST_SLAB_MIN_NODES 64
+#define BST_SLAB_MAX_NODES 65536
+
+// Set to 0 to drop the per-subtree summaries from Node_t, which halves the
+// node size. aggregate_range() then falls back to an O(log n + k) walk
+#ifndef BST_AGGREGATES
+#define BST_AGGREGATES 1
+#endif
+
+
 // Defines data item struct to hold sensor reading data
 typedef struct temperature_humidity_data {
     time_t timestamp;   // Time the reading was taken
@@ -31,23 +49,70 @@ typedef struct temperature_humidity_data {
 
 
 
+// Defines a summary of the readings in a range: how many there are and the
+// total, minimum and maximum of each sensor value. min > max when count is 0
+typedef struct temperature_humidity_summary {
+    size_t count;           // Number of readings summarized
+    uint64_t temp_sum;      // Sum of temperature readings
+    uint32_t temp_min;      // Lowest temperature reading
+    uint32_t temp_max;      // Highest temperature reading
+    uint64_t humid_sum;     // Sum of humidity readings
+    uint32_t humid_min;     // Lowest humidity reading
+    uint32_t humid_max;     // Highest humidity reading
+} Summary_t;
+
+
+
 // Defines the binary search tree node structure
 typedef struct binary_search_tree_node {
     Data_t data;                             // Node's data
     struct binary_search_tree_node* left;    // Pointer to left child
     struct binary_search_tree_node* right;   // Pointer to right child
+    int height;                              // Height of subtree (leaf is 1)
+#if BST_AGGREGATES
+    Summary_t summary;                       // Summary of the whole subtree
+#endif
 } Node_t;
 
 
 
+// Defines a slab, one contiguous chunk of nodes handed out by a tree
+typedef struct binary_search_tree_slab {
+    struct binary_search_tree_slab* next;    // Next (older) slab in the list
+    size_t capacity;                         // Number of nodes in this slab
+    Node_t nodes[];                          // The nodes themselves
+} Slab_t;
+
+
+
 // Defines the temp/humidity binary search tree structure
 typedef struct temperature_humidity_binary_search_tree {
     Node_t* root;       // Pointer to root node of tree
     int node_count;     // Number of nodes in tree
+    Slab_t* slabs;      // Slabs owned by the tree, newest first
+    size_t slab_used;   // Nodes handed out from the newest slab
+    Node_t* free_list;  // Recycled nodes, chained through their left pointer
+    Epoch_t* epoch;     // Reader reclamation, NULL unless tree is shared
+    struct temperature_humidity_wal* wal;   // Log written ahead, or NULL
 } Tree_t;
 
 
 
+// Defines an in-order cursor over a tree. The stack holds the nodes whose
+// left subtree is being walked, so memory use is O(height) and no I/O is done
+typedef struct temperature_humidity_tree_iterator {
+    const Node_t* stack[BST_MAX_HEIGHT];    // Ancestors still to be visited
+    int depth;                              // Number of entries on the stack
+} TreeIter_t;
+
+
+
+// Defines the callback used to visit readings during a traversal. Return
+// true to keep going or false to stop the traversal early
+typedef bool (*Visit_t)(const Data_t* reading, void* context);
+
+
+
 /************************** API Function Prototypes ***************************/
 
 /**
@@ -60,6 +125,38 @@ typedef struct temperature_humidity_binary_search_tree {
  
 
 
+/**
+ * build_tree_from_sorted() - builds a perfectly balanced tree from readings
+ *                            already sorted by timestamp
+ *
+ * @param	readings	array of readings in non-decreasing timestamp order
+ * @param	count		number of readings in the array
+ * @return				a pointer to the new Temp/Humidity tree if succeeds.
+ *						NULL if allocation fails, the readings are not sorted
+ *						or there are more than INT_MAX of them
+ *
+ * @note Runs in O(n). All nodes are placed in one slab in timestamp order, so
+ * an in-order walk of the result touches memory sequentially.
+ */
+Tree_t* build_tree_from_sorted(const Data_t* readings, size_t count);
+
+
+
+/**
+ * build_tree() - sorts readings by timestamp and builds a balanced tree
+ *
+ * @param	readings	array of readings in any order.  Sorted in place
+ * @param	count		number of readings in the array
+ * @return				a pointer to the new Temp/Humidity tree if succeeds.
+ *						NULL if it fails
+ *
+ * @note Runs in O(n log n) for the sort, then hands off to
+ * build_tree_from_sorted(). Readings already in order skip the sort
+ */
+Tree_t* build_tree(Data_t* readings, size_t count);
+
+
+
 /**
  * insert() - inserts a temp/humid data record into the tree
  *
@@ -67,6 +164,12 @@ typedef struct temperature_humidity_binary_search_tree {
  * @param	info	Temp/Humid data node to add to tree
  * @return			pointer to the new BST node
  *
+ * The tree is rebalanced (AVL rotations) on the way back up the insertion
+ * path, so search depth stays O(log n) regardless of the insertion order.
+ * If a write-ahead log is attached (see temp_humid_wal.h) the reading is
+ * logged just before it is linked in, once nothing else can fail, and NULL
+ * is returned without inserting or logging if allocation or logging fails.
+ *
  * @note Not a good idea to expose the data node but w/o a pointer to
  * root I don't see much harm and it could be useful for debug
  */
@@ -74,6 +177,63 @@ Node_t* insert(Tree_t* tree, Data_t info);
 
 
 
+/**
+ * share_tree() - lets reader threads search a tree while one writer inserts
+ *
+ * @param	tree	pointer to the TempHumidtree to share
+ * @return			true if succeeds, false if it fails
+ *
+ * @brief
+ * After this call insert() no longer changes any node a reader might be
+ * looking at. It copies the nodes on the insertion path, rebalances the
+ * copies, and publishes them by swapping the root pointer. The nodes it
+ * replaced are retired through the epoch domain in bst_epoch.h and go back
+ * on the free list once no reader can still be holding them.
+ *
+ * @note Only one thread may call insert() at a time. delete_node() and
+ * delete_before() rewrite nodes in place and refuse to run on a shared tree.
+ * All readers must be done before delete_tree().
+ */
+bool share_tree(Tree_t* tree);
+
+
+
+/**
+ * tree_add_reader() - gives a reader thread its slot in a shared tree
+ *
+ * @param	tree	pointer to a TempHumidtree passed to share_tree()
+ * @return			reader slot to pass to tree_read_begin()/tree_read_end(),
+ *					-1 if the tree is not shared or all slots are taken
+ */
+int tree_add_reader(Tree_t* tree);
+
+
+
+/**
+ * tree_read_begin() - starts a lock-free read of a shared tree
+ *
+ * @param	tree	pointer to a TempHumidtree passed to share_tree()
+ * @param	reader	slot returned by tree_add_reader()
+ *
+ * @note Any of the search functions, search_range(), aggregate_range() and
+ * a TreeIter_t walk may be used until tree_read_end(). Node pointers they
+ * return are only valid until then. Keep read sections short, nodes retired
+ * meanwhile cannot be reused.
+ */
+void tree_read_begin(Tree_t* tree, int reader);
+
+
+
+/**
+ * tree_read_end() - ends a read started with tree_read_begin()
+ *
+ * @param	tree	pointer to a TempHumidtree passed to share_tree()
+ * @param	reader	slot returned by tree_add_reader()
+ */
+void tree_read_end(Tree_t* tree, int reader);
+
+
+
 /**
  * search() - searches for a temp/humid data record into the tree w/ the 
  *			  specified timestamp
@@ -83,6 +243,9 @@ Node_t* insert(Tree_t* tree, Data_t info);
  * @return				pointer to the BST node with that timestamp or NULL if 
  *						not found
  *
+ * @note The nodes visited are printed at log level BST_LOG_TRACE, see
+ * bst_log.h for how to turn that off at run time or compile it out.
+ *
  * @note Not a good idea to expose the data node but w/o a pointer to
  * root I don't see much harm and it could be useful for debug
  */
@@ -90,6 +253,140 @@ Node_t* insert(Tree_t* tree, Data_t info);
  
  
 
+/**
+ * search_floor() - finds the reading at or just before a timestamp
+ *
+ * @param	tree		pointer to the TempHumidtree to search
+ * @param	timestamp	timestamp to search for, need not match a reading
+ * @return				pointer to the BST node with the largest timestamp
+ *						<= timestamp, or NULL if every reading is later
+ *
+ * @note Runs in O(log n) in one descent. Nothing is printed.
+ */
+Node_t* search_floor(Tree_t* tree, time_t timestamp);
+
+
+
+/**
+ * search_ceil() - finds the reading at or just after a timestamp
+ *
+ * @param	tree		pointer to the TempHumidtree to search
+ * @param	timestamp	timestamp to search for, need not match a reading
+ * @return				pointer to the BST node with the smallest timestamp
+ *						>= timestamp, or NULL if every reading is earlier
+ *
+ * @note Runs in O(log n) in one descent. Nothing is printed.
+ */
+Node_t* search_ceil(Tree_t* tree, time_t timestamp);
+
+
+
+/**
+ * search_nearest() - finds the reading closest in time to a timestamp
+ *
+ * @param	tree		pointer to the TempHumidtree to search
+ * @param	timestamp	timestamp to search for, need not match a reading
+ * @return				pointer to the BST node closest to timestamp, the
+ *						earlier one on a tie. NULL only if the tree is empty
+ *
+ * @note Runs in O(log n). Nothing is printed.
+ */
+Node_t* search_nearest(Tree_t* tree, time_t timestamp);
+
+
+
+/**
+ * search_many() - looks up a batch of timestamps in one merged traversal
+ *
+ * @param	tree		pointer to the TempHumidtree to search
+ * @param	keys		timestamps to look up, in any order
+ * @param	count		number of timestamps in keys
+ * @param	out			filled with one result per key: out[i] is the BST node
+ *						with timestamp keys[i] or NULL if not found
+ * @return				number of keys found
+ *
+ * @note Keys that are already sorted are used as is, otherwise an index of
+ * them is sorted first. The batch then descends the tree once: at each node
+ * the keys are split into those going left, those matching, and those going
+ * right, so a path shared by many keys is walked only once. Nothing is
+ * printed, unlike search().
+ */
+size_t search_many(Tree_t* tree, const time_t* keys, size_t count,
+                   Node_t** out);
+
+
+
+/**
+ * aggregate_range() - summarizes the readings with a timestamp in 
+ *                     [t_begin, t_end]
+ *
+ * @param	tree		pointer to the TempHumidtree to summarize
+ * @param	t_begin		first timestamp of the range (inclusive)
+ * @param	t_end		last timestamp of the range (inclusive)
+ * @return				count, sums, minimums and maximums of the readings.
+ *						Average = sum / count
+ *
+ * @note Each node carries a summary of its subtree, kept up to date by
+ * insert, delete and every rotation. The range is covered by O(log n) whole
+ * subtrees along its two boundary paths, so no reading is visited one by one.
+ * Built with BST_AGGREGATES=0 this walks the range instead.
+ */
+Summary_t aggregate_range(Tree_t* tree, time_t t_begin, time_t t_end);
+
+
+
+/**
+ * search_range() - visits every reading with a timestamp in [t_begin, t_end]
+ *                  in timestamp order
+ *
+ * @param	tree		pointer to the TempHumidtree to search
+ * @param	t_begin		first timestamp of the range (inclusive)
+ * @param	t_end		last timestamp of the range (inclusive)
+ * @param	visit		callback called once per reading in the range
+ * @param	context		caller data passed through to visit
+ * @return				number of readings visited
+ *
+ * @note Subtrees entirely outside the range are skipped, so the cost is
+ * O(log n + k) for k readings in the range.
+ */
+size_t search_range(Tree_t* tree, time_t t_begin, time_t t_end,
+                    Visit_t visit, void* context);
+
+
+
+/**
+ * delete_node() - removes the reading w/ the specified timestamp from the tree
+ *
+ * @param	tree		pointer to the TempHumidtree to remove the reading from
+ * @param	timestamp	timestamp of the Temp/Humid reading to remove
+ * @return				true if a reading was removed, false if not found
+ *
+ * @note If several readings share the timestamp only one is removed. The
+ * node is returned to the tree's free list for reuse by insert(). A node
+ * with two children is removed by moving its in-order successor's data into
+ * it and freeing the successor's node instead, so pointers to the removed
+ * reading's node and to its in-order successor's node are both invalidated.
+ */
+bool delete_node(Tree_t* tree, time_t timestamp);
+
+
+
+/**
+ * delete_before() - removes every reading older than a cutoff
+ *
+ * @param	tree		pointer to the TempHumidtree to trim
+ * @param	cutoff		readings with timestamps < cutoff are removed
+ * @return				number of readings removed
+ *
+ * @note Whole subtrees older than the cutoff are released without being
+ * rebalanced, and the remainder is rejoined in O(log n), so trimming k
+ * readings costs O(log n + k). Removed nodes go back on the tree's free list,
+ * which keeps memory flat for a rolling retention window.
+ */
+size_t delete_before(Tree_t* tree, time_t cutoff);
+
+
+
 /**
  * in_order() - performs in order traversal of tree
  *
@@ -97,43 +394,72 @@ Node_t* insert(Tree_t* tree, Data_t info);
  *
  * @brief
  * Performs an in order traversal of the BST.  The data in the nodes are
- * displayed using the helper (non-API) function _displayDataNode(). This 
- * function is a wrapper for _inorder() (non-AIPI) which does the work.
+ * displayed one line per reading, oldest first. The traversal is done with a
+ * TreeIter_t so it does not recurse, and the table is written to stdout in
+ * large blocks by tree_export().
  */ 
 void in_order(Tree_t* tree);
 
 
 
 /**
- * in_order_recursive() - Helper function for recursive in-order traversal
+ * tree_iter_begin() - positions a cursor before the oldest reading in a tree
  *
- * @param   node    Current node in traversal
+ * @param	iter	pointer to the cursor to initialize
+ * @param	tree	pointer to the TempHumidtree to walk.  The tree must not be
+ *					modified while the cursor is in use
+ */
+void tree_iter_begin(TreeIter_t* iter, const Tree_t* tree);
+
+
+
+/**
+ * tree_iter_seek() - positions a cursor before the first reading at or after
+ *                    a timestamp
  *
- * @brief
- * Recursively traverses the BST inorder, displaying each node's data, resulting
- * in an ordered list. The order is left subtree, current node, and then the
- * right subtree.
+ * @param	iter		pointer to the cursor to initialize
+ * @param	tree		pointer to the TempHumidtree to walk
+ * @param	timestamp	readings older than this are skipped
+ *
+ * @note Runs in O(log n), the walk then continues in timestamp order to the
+ * end of the tree.
  */
-static void in_order_recursive(Node_t* node);
+void tree_iter_seek(TreeIter_t* iter, const Tree_t* tree, time_t timestamp);
 
 
 
 /**
- * delete_tree() - recursively deletes/frees all nodes in the tree, deallocates
- *                 all memory used by the BST
+ * tree_iter_next() - returns the next reading in timestamp order
  *
- * @param tree   Represents pointer to the tree to delete/free
+ * @param	iter	pointer to the cursor
+ * @return			pointer to the next reading or NULL once the walk is done
  */
-void delete_tree(Tree_t* tree);
+const Data_t* tree_iter_next(TreeIter_t* iter);
 
 
 
 /**
- * delete_tree_recursive() - Helper function to recursively delete/free nodes
- * 
- * @param node   Current node being deleted/freed
+ * tree_iter_end() - finishes a walk, the cursor returns no more readings
+ *
+ * @param	iter	pointer to the cursor
+ *
+ * @note The cursor owns no memory, this only needs to be called when a walk
+ * is abandoned early and the cursor might be reused by mistake.
  */
-static void delete_tree_recursive(Node_t* node);
+void tree_iter_end(TreeIter_t* iter);
+
+
+
+/**
+ * delete_tree() - deletes/frees all nodes in the tree, deallocates all memory
+ *                 used by the BST
+ *
+ * @param tree   Represents pointer to the tree to delete/free
+ *
+ * @note Nodes live in slabs owned by the tree, so this frees one slab at a
+ * time rather than walking every node.
+ */
+void delete_tree(Tree_t* tree);
 
 
 
@@ -0,0 +1,352 @@
+/**
+ * @file        temp_humid_cols.c
+ * @brief
+ * Implements the columnar Temp/Humidity store defined in temp_humid_cols.h.
+ * The three columns grow together by doubling. Range summaries use SSE2 on
+ * x86 and fall back to plain loops elsewhere.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "temp_humid_cols.h"
+#include "temp_humid_export.h"
+#include "bst_log.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static bool grow_columns(ColStore_t* store);
+static size_t lower_bound(const ColStore_t* store, time_t timestamp);
+static size_t upper_bound(const ColStore_t* store, time_t timestamp);
+static void scan_column(const uint32_t* values, size_t count, uint64_t* sum,
+                        uint32_t* min, uint32_t* max);
+
+
+
+/************************ API Function Implementations ************************/
+
+ColStore_t* create_colstore(void) {
+    ColStore_t* store = (ColStore_t*)malloc(sizeof(ColStore_t));
+
+    if (store == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(create_colstore()): Failed to create store.\n");
+        return NULL;
+    }
+
+    store->timestamps = NULL;
+    store->temps = NULL;
+    store->humids = NULL;
+    store->count = 0;
+    store->capacity = 0;
+
+    BST_LOG(BST_LOG_INFO,
+            "INFO(create_colstore()): Successfully created a "
+            "Temp/Humidity column store.\n");
+
+    return store;
+}
+
+
+
+bool colstore_insert(ColStore_t* store, Data_t info) {
+    if (store == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(colstore_insert()): Cannot insert into NULL store.\n");
+        return false;
+    }
+
+    if (store->count == store->capacity && !grow_columns(store)) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(colstore_insert()): Failed to allocate memory for "
+                "new reading.\n");
+        return false;
+    }
+
+    // Appends in the common case, otherwise opens a gap after any readings
+    // with the same timestamp, matching where insert() puts duplicates
+    size_t position = store->count;
+
+    if (store->count > 0 && 
+        info.timestamp < store->timestamps[store->count - 1]) {
+        position = upper_bound(store, info.timestamp);
+        size_t moved = store->count - position;
+
+        memmove(&store->timestamps[position + 1], &store->timestamps[position],
+                moved * sizeof(time_t));
+        memmove(&store->temps[position + 1], &store->temps[position],
+                moved * sizeof(uint32_t));
+        memmove(&store->humids[position + 1], &store->humids[position],
+                moved * sizeof(uint32_t));
+    }
+
+    store->timestamps[position] = info.timestamp;
+    store->temps[position] = info.temp;
+    store->humids[position] = info.humid;
+    store->count++;
+
+    return true;
+}
+
+
+
+bool colstore_search(ColStore_t* store, time_t timestamp, Data_t* out) {
+    if (store == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(colstore_search()): Cannot search NULL store.\n");
+        return false;
+    }
+
+    size_t position = lower_bound(store, timestamp);
+
+    if (position == store->count || store->timestamps[position] != timestamp) {
+        return false;
+    }
+
+    if (out != NULL) {
+        out->timestamp = timestamp;
+        out->temp = store->temps[position];
+        out->humid = store->humids[position];
+    }
+
+    return true;
+}
+
+
+
+Summary_t colstore_summarize(ColStore_t* store, time_t t_begin, time_t t_end) {
+    Summary_t summary = {0, 0, UINT32_MAX, 0, 0, UINT32_MAX, 0};
+
+    if (store == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(colstore_summarize()): Cannot scan NULL store.\n");
+        return summary;
+    }
+
+    if (t_begin > t_end) {
+        return summary;
+    }
+
+    size_t first = lower_bound(store, t_begin);
+    size_t last = upper_bound(store, t_end);
+
+    if (first >= last) {
+        return summary;
+    }
+
+    summary.count = last - first;
+    scan_column(&store->temps[first], summary.count, &summary.temp_sum,
+                &summary.temp_min, &summary.temp_max);
+    scan_column(&store->humids[first], summary.count, &summary.humid_sum,
+                &summary.humid_min, &summary.humid_max);
+
+    return summary;
+}
+
+
+
+void colstore_in_order(ColStore_t* store) {
+    if (store == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(colstore_in_order()): Cannot traverse NULL store.\n");
+        return;
+    }
+
+    BST_LOG(BST_LOG_INFO,
+            "INFO(colstore_in_order()): There are %zu readings in the "
+            "store.\n", store->count);
+
+    Export_t out;
+
+    fflush(stdout);
+    export_begin(&out, STDOUT_FILENO);
+
+    for (size_t i = 0; i < store->count; i++) {
+        Data_t reading = {store->timestamps[i], store->temps[i], 
+                          store->humids[i]};
+
+        if (!export_reading(&out, &reading)) {
+            break;
+        }
+    }
+
+    export_end(&out);
+}
+
+
+
+void delete_colstore(ColStore_t* store) {
+    if (store != NULL) {
+        free(store->timestamps);
+        free(store->temps);
+        free(store->humids);
+        free(store);
+    }
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * grow_columns() - doubles the capacity of all three columns
+ *
+ * @param store   Store to grow
+ * @return        true if it succeeds, false if out of memory.  The store is
+ *                unchanged on failure
+ */
+static bool grow_columns(ColStore_t* store) {
+    size_t capacity = (store->capacity > 0) ? store->capacity * 2 
+                                            : COLSTORE_MIN_CAPACITY;
+
+    time_t* timestamps = realloc(store->timestamps, capacity * sizeof(time_t));
+    if (timestamps == NULL) {
+        return false;
+    }
+    store->timestamps = timestamps;
+
+    uint32_t* temps = realloc(store->temps, capacity * sizeof(uint32_t));
+    if (temps == NULL) {
+        return false;
+    }
+    store->temps = temps;
+
+    uint32_t* humids = realloc(store->humids, capacity * sizeof(uint32_t));
+    if (humids == NULL) {
+        return false;
+    }
+    store->humids = humids;
+
+    store->capacity = capacity;
+
+    return true;
+}
+
+
+
+/**
+ * lower_bound() - returns the position of the first timestamp >= timestamp
+ */
+static size_t lower_bound(const ColStore_t* store, time_t timestamp) {
+    size_t low = 0;
+    size_t high = store->count;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if (store->timestamps[mid] < timestamp) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+
+
+/**
+ * upper_bound() - returns the position of the first timestamp > timestamp
+ */
+static size_t upper_bound(const ColStore_t* store, time_t timestamp) {
+    size_t low = 0;
+    size_t high = store->count;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if (store->timestamps[mid] <= timestamp) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+
+
+/**
+ * scan_column() - sums a value column and finds its minimum and maximum
+ *
+ * SSE2 has no unsigned 32-bit compare, so values are biased by 2^31 to make
+ * a signed compare order them correctly. Sums are widened to 64 bits.
+ *
+ * @param values   First value to scan
+ * @param count    Number of values to scan, at least 1
+ * @param sum      Set to the sum of the values
+ * @param min      Set to the smallest value
+ * @param max      Set to the largest value
+ */
+static void scan_column(const uint32_t* values, size_t count, uint64_t* sum,
+                        uint32_t* min, uint32_t* max) {
+    uint64_t total = 0;
+    uint32_t lowest = UINT32_MAX;
+    uint32_t highest = 0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i bias = _mm_set1_epi32((int)0x80000000);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vsum = _mm_setzero_si128();
+    __m128i vmin = _mm_set1_epi32(0x7FFFFFFF);
+    __m128i vmax = _mm_set1_epi32((int)0x80000000);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)&values[i]);
+
+        vsum = _mm_add_epi64(vsum, _mm_unpacklo_epi32(v, zero));
+        vsum = _mm_add_epi64(vsum, _mm_unpackhi_epi32(v, zero));
+
+        __m128i biased = _mm_xor_si128(v, bias);
+        __m128i lt = _mm_cmplt_epi32(biased, vmin);
+        __m128i gt = _mm_cmpgt_epi32(biased, vmax);
+
+        vmin = _mm_or_si128(_mm_and_si128(lt, biased), 
+                            _mm_andnot_si128(lt, vmin));
+        vmax = _mm_or_si128(_mm_and_si128(gt, biased), 
+                            _mm_andnot_si128(gt, vmax));
+    }
+
+    uint64_t sums[2];
+    uint32_t mins[4];
+    uint32_t maxs[4];
+
+    _mm_storeu_si128((__m128i*)sums, vsum);
+    _mm_storeu_si128((__m128i*)mins, _mm_xor_si128(vmin, bias));
+    _mm_storeu_si128((__m128i*)maxs, _mm_xor_si128(vmax, bias));
+
+    total = sums[0] + sums[1];
+
+    for (int lane = 0; lane < 4; lane++) {
+        lowest = (mins[lane] < lowest) ? mins[lane] : lowest;
+        highest = (maxs[lane] > highest) ? maxs[lane] : highest;
+    }
+#endif
+
+    // Handles the values left over from the vector loop, or all of them
+    for (; i < count; i++) {
+        total += values[i];
+        lowest = (values[i] < lowest) ? values[i] : lowest;
+        highest = (values[i] > highest) ? values[i] : highest;
+    }
+
+    *sum = total;
+    *min = lowest;
+    *max = highest;
+}
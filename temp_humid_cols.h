@@ -0,0 +1,119 @@
+/**
+ * @file        temp_humid_cols.h
+ * @brief
+ * Defines a columnar (structure-of-arrays) store for temperature and humidity
+ * readings, an alternative backend to the BST for append-mostly sensor data.
+ * Timestamps, temperatures and humidities are kept in three separate
+ * contiguous arrays sorted by timestamp. Lookups binary search the timestamp
+ * column and range summaries scan only the value columns, using SSE2 where
+ * available.
+ *
+ * The API mirrors the BST: create, insert, search, in_order and delete.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef TEMP_HUMID_COLS_H
+#define TEMP_HUMID_COLS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "temp_humid_bst.h"
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Initial number of readings the columns have room for
+#define COLSTORE_MIN_CAPACITY 64
+
+// Defines the columnar Temp/Humidity store
+typedef struct temperature_humidity_column_store {
+    time_t* timestamps;     // Timestamp column, sorted
+    uint32_t* temps;        // Temperature column, same order
+    uint32_t* humids;       // Humidity column, same order
+    size_t count;           // Number of readings stored
+    size_t capacity;        // Number of readings the columns have room for
+} ColStore_t;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * create_colstore() - creates an empty columnar Temp/Humidity store
+ *
+ * @return	a pointer to the new store if succeeds.  NULL if it fails
+ */
+ColStore_t* create_colstore(void);
+
+
+
+/**
+ * colstore_insert() - inserts a temp/humid reading into the store
+ *
+ * @param	store	pointer to the store to add the reading to
+ * @param	info	Temp/Humid reading to add
+ * @return			true if the reading was added, false if it fails
+ *
+ * @note Readings at or after the newest timestamp are appended in O(1)
+ * amortized. Out-of-order readings are shifted into place in O(n).
+ */
+bool colstore_insert(ColStore_t* store, Data_t info);
+
+
+
+/**
+ * colstore_search() - searches the store for a reading w/ the specified
+ *                     timestamp
+ *
+ * @param	store		pointer to the store to search
+ * @param	timestamp	timestamp of the Temp/Humid reading we are seeking
+ * @param	out			filled with the reading if it is found
+ * @return				true if found, false if not
+ *
+ * @note Binary searches the timestamp column, O(log n).
+ */
+bool colstore_search(ColStore_t* store, time_t timestamp, Data_t* out);
+
+
+
+/**
+ * colstore_summarize() - summarizes the readings in [t_begin, t_end]
+ *
+ * @param	store		pointer to the store to scan
+ * @param	t_begin		first timestamp of the range (inclusive)
+ * @param	t_end		last timestamp of the range (inclusive)
+ * @return				count, sums, minimums and maximums of the readings
+ *
+ * @note The range is located by binary search, then the temperature and
+ * humidity columns are scanned four values at a time with SSE2.
+ */
+Summary_t colstore_summarize(ColStore_t* store, time_t t_begin, time_t t_end);
+
+
+
+/**
+ * colstore_in_order() - displays every reading in timestamp order
+ *
+ * @param	store	pointer to the store to display
+ *
+ * @note Output is formatted the same as in_order() for the BST.
+ */
+void colstore_in_order(ColStore_t* store);
+
+
+
+/**
+ * delete_colstore() - frees all memory used by the store
+ *
+ * @param store   Represents pointer to the store to delete/free
+ */
+void delete_colstore(ColStore_t* store);
+
+
+
+#endif
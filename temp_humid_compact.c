@@ -0,0 +1,487 @@
+/**
+ * @file        temp_humid_compact.c
+ * @brief
+ * Implements the compact-node tree defined in temp_humid_compact.h. The pool
+ * grows by doubling and indices stay valid across a realloc(), which is why
+ * insertion tracks its path by index rather than by pointer.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "temp_humid_compact.h"
+#include "bst_log.h"
+
+
+
+/******************************** Definitions *********************************/
+
+// Largest packed value, and the widest window of timestamps a tree can hold
+#define COMPACT_VALUE_MAX       ((1u << COMPACT_VALUE_BITS) - 1)
+#define COMPACT_SPAN_MAX        ((uint64_t)UINT32_MAX)
+
+// Most nodes a tree can hold, index 0 is reserved for no child
+#define COMPACT_MAX_NODES       ((uint64_t)UINT32_MAX - 1)
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static CompactTree_t* new_compact_tree(size_t count);
+static bool fits(const CompactTree_t* tree, const Data_t* reading);
+static time_t choose_base(time_t first, time_t last);
+static void set_node(CompactTree_t* tree, uint32_t index,
+                     const Data_t* reading);
+static uint32_t build_sorted(CompactTree_t* tree, const Data_t* readings,
+                             uint32_t low, uint32_t high);
+static int height(const CompactTree_t* tree, uint32_t index);
+static void update(CompactTree_t* tree, uint32_t index);
+static uint32_t rotate(CompactTree_t* tree, uint32_t index, int side);
+static uint32_t rebalance(CompactTree_t* tree, uint32_t index);
+
+
+
+/************************ API Function Implementations ************************/
+
+CompactTree_t* create_compact_tree(void) {
+    CompactTree_t* tree = new_compact_tree(COMPACT_MIN_CAPACITY);
+
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(create_compact_tree()): Failed to create tree.\n");
+    }
+
+    return tree;
+}
+
+
+
+CompactTree_t* build_compact_from_sorted(const Data_t* readings, size_t count) {
+    if (readings == NULL && count > 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(build_compact_from_sorted()): Cannot build from NULL "
+                "readings.\n");
+        return NULL;
+    }
+
+    if (count > COMPACT_MAX_NODES) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(build_compact_from_sorted()): Too many readings.\n");
+        return NULL;
+    }
+
+    CompactTree_t* tree = new_compact_tree(count + 1);
+
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(build_compact_from_sorted()): Failed to allocate "
+                "memory.\n");
+        return NULL;
+    }
+
+    if (count == 0) {
+        return tree;
+    }
+
+    // Sorted, so the first and last readings bound every timestamp
+    if ((uint64_t)readings[count - 1].timestamp -
+        (uint64_t)readings[0].timestamp > COMPACT_SPAN_MAX ||
+        readings[count - 1].timestamp < readings[0].timestamp) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(build_compact_from_sorted()): Readings span more "
+                "than 2^32 seconds or are not sorted.\n");
+        delete_compact_tree(tree);
+        return NULL;
+    }
+
+    tree->base = choose_base(readings[0].timestamp,
+                             readings[count - 1].timestamp);
+
+    for (size_t i = 0; i < count; i++) {
+        if ((i > 0 && readings[i].timestamp < readings[i - 1].timestamp) ||
+            !fits(tree, &readings[i])) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(build_compact_from_sorted()): Reading %zu is out "
+                    "of order or does not fit.\n", i);
+            delete_compact_tree(tree);
+            return NULL;
+        }
+    }
+
+    tree->count = (uint32_t)count;
+    tree->root = build_sorted(tree, readings, 0, (uint32_t)count);
+
+    return tree;
+}
+
+
+
+CompactTree_t* compact_tree(const Tree_t* tree) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(compact_tree()): Cannot copy NULL tree.\n");
+        return NULL;
+    }
+
+    size_t count = (size_t)tree->node_count;
+    Data_t* readings = (Data_t*)malloc((count + 1) * sizeof(Data_t));
+
+    if (readings == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(compact_tree()): Failed to allocate memory.\n");
+        return NULL;
+    }
+
+    TreeIter_t iter;
+    const Data_t* reading;
+    size_t copied = 0;
+
+    tree_iter_begin(&iter, tree);
+
+    while (copied < count && (reading = tree_iter_next(&iter)) != NULL) {
+        readings[copied++] = *reading;
+    }
+
+    tree_iter_end(&iter);
+
+    CompactTree_t* compact = build_compact_from_sorted(readings, copied);
+
+    free(readings);
+
+    return compact;
+}
+
+
+
+bool compact_insert(CompactTree_t* tree, Data_t info) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(compact_insert()): Cannot insert into NULL tree.\n");
+        return false;
+    }
+
+    if (tree->count == 0) {
+        tree->base = choose_base(info.timestamp, info.timestamp);
+    }
+
+    if (!fits(tree, &info)) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(compact_insert()): Reading does not fit the compact "
+                "format.\n");
+        return false;
+    }
+
+    // Grows the pool first, so no index below changes meaning
+    if (tree->count + 1 >= tree->capacity) {
+        uint64_t capacity = 2 * (uint64_t)tree->capacity;
+
+        if (capacity > COMPACT_MAX_NODES + 1) {
+            capacity = COMPACT_MAX_NODES + 1;
+        }
+
+        CompactNode_t* grown = NULL;
+
+        if (capacity > tree->capacity) {
+            grown = (CompactNode_t*)realloc(tree->nodes,
+                                            capacity * sizeof(CompactNode_t));
+        }
+
+        if (grown == NULL) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(compact_insert()): Failed to allocate memory for "
+                    "new node.\n");
+            return false;
+        }
+
+        tree->nodes = grown;
+        tree->capacity = (uint32_t)capacity;
+    }
+
+    uint32_t node = ++tree->count;
+
+    set_node(tree, node, &info);
+
+    // Finds the insertion point, remembering each node and the side taken
+    uint32_t path[BST_MAX_HEIGHT];
+    int side[BST_MAX_HEIGHT];
+    int depth = 0;
+    uint32_t offset = tree->nodes[node].offset;
+
+    for (uint32_t at = tree->root; at != 0; ) {
+        path[depth] = at;
+        side[depth] = (offset >= tree->nodes[at].offset);
+        at = tree->nodes[at].child[side[depth]];
+        depth++;
+    }
+
+    if (depth == 0) {
+        tree->root = node;
+        return true;
+    }
+
+    tree->nodes[path[depth - 1]].child[side[depth - 1]] = node;
+
+    // Retraces the path, stopping once a subtree's height is unchanged
+    while (depth > 0) {
+        uint32_t at = path[--depth];
+        int old_height = tree->nodes[at].height;
+        uint32_t top = rebalance(tree, at);
+
+        if (depth == 0) {
+            tree->root = top;
+        }
+        else {
+            tree->nodes[path[depth - 1]].child[side[depth - 1]] = top;
+        }
+
+        if (tree->nodes[top].height == old_height) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+
+
+bool compact_search(const CompactTree_t* tree, time_t timestamp, Data_t* out) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(compact_search()): Cannot search NULL tree.\n");
+        return false;
+    }
+
+    if (tree->count == 0 || timestamp < tree->base ||
+        (uint64_t)timestamp - (uint64_t)tree->base > COMPACT_SPAN_MAX) {
+        return false;
+    }
+
+    uint32_t offset = (uint32_t)((uint64_t)timestamp - (uint64_t)tree->base);
+    const CompactNode_t* nodes = tree->nodes;
+    uint32_t at = tree->root;
+
+    while (at != 0 && nodes[at].offset != offset) {
+        at = nodes[at].child[offset > nodes[at].offset];
+    }
+
+    if (at == 0) {
+        return false;
+    }
+
+    if (out != NULL) {
+        uint64_t packed = ((uint64_t)nodes[at].values_high << 32) |
+                          nodes[at].values_low;
+
+        out->timestamp = timestamp;
+        out->temp = (uint32_t)(packed & COMPACT_VALUE_MAX);
+        out->humid = (uint32_t)(packed >> COMPACT_VALUE_BITS);
+    }
+
+    return true;
+}
+
+
+
+size_t compact_bytes(const CompactTree_t* tree) {
+    if (tree == NULL) {
+        return 0;
+    }
+
+    return sizeof(CompactTree_t) +
+           (size_t)tree->capacity * sizeof(CompactNode_t);
+}
+
+
+
+void delete_compact_tree(CompactTree_t* tree) {
+    if (tree != NULL) {
+        free(tree->nodes);
+        free(tree);
+    }
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * new_compact_tree() - allocates an empty tree with a pool of capacity nodes
+ *
+ * @return   the tree, or NULL if allocation fails
+ */
+static CompactTree_t* new_compact_tree(size_t capacity) {
+    CompactTree_t* tree = (CompactTree_t*)malloc(sizeof(CompactTree_t));
+
+    if (tree == NULL) {
+        return NULL;
+    }
+
+    tree->nodes = (CompactNode_t*)malloc(capacity * sizeof(CompactNode_t));
+    if (tree->nodes == NULL) {
+        free(tree);
+        return NULL;
+    }
+
+    tree->root = 0;
+    tree->count = 0;
+    tree->capacity = (uint32_t)capacity;
+    tree->base = 0;
+
+    return tree;
+}
+
+
+
+/**
+ * fits() - true if a reading can be stored in the tree's compact format
+ */
+static bool fits(const CompactTree_t* tree, const Data_t* reading) {
+    return reading->temp <= COMPACT_VALUE_MAX &&
+           reading->humid <= COMPACT_VALUE_MAX &&
+           reading->timestamp >= tree->base &&
+           (uint64_t)reading->timestamp - (uint64_t)tree->base <=
+           COMPACT_SPAN_MAX;
+}
+
+
+
+/**
+ * choose_base() - picks the base time that centers [first, last] in the
+ *                 window of offsets, so later readings can land either side
+ *
+ * @note last - first must be at most COMPACT_SPAN_MAX
+ */
+static time_t choose_base(time_t first, time_t last) {
+    uint64_t slack = (COMPACT_SPAN_MAX -
+                      ((uint64_t)last - (uint64_t)first)) / 2;
+
+    // Keeps the base from wrapping below the earliest time_t
+    if ((int64_t)first < INT64_MIN + (int64_t)slack) {
+        return (time_t)INT64_MIN;
+    }
+
+    return (time_t)((int64_t)first - (int64_t)slack);
+}
+
+
+
+/**
+ * set_node() - fills a pool entry with a reading and no children
+ */
+static void set_node(CompactTree_t* tree, uint32_t index,
+                     const Data_t* reading) {
+    CompactNode_t* node = &tree->nodes[index];
+    uint64_t packed = (uint64_t)reading->temp |
+                      ((uint64_t)reading->humid << COMPACT_VALUE_BITS);
+
+    node->offset = (uint32_t)((uint64_t)reading->timestamp -
+                              (uint64_t)tree->base);
+    node->child[0] = 0;
+    node->child[1] = 0;
+    node->values_low = (uint32_t)packed;
+    node->values_high = (uint8_t)(packed >> 32);
+    node->height = 1;
+}
+
+
+
+/**
+ * build_sorted() - builds a balanced subtree from readings[low, high),
+ *                  storing reading i in pool entry i + 1
+ *
+ * @return   index of the subtree's root, 0 if the range is empty
+ */
+static uint32_t build_sorted(CompactTree_t* tree, const Data_t* readings,
+                             uint32_t low, uint32_t high) {
+    if (low >= high) {
+        return 0;
+    }
+
+    uint32_t middle = low + (high - low) / 2;
+    uint32_t index = middle + 1;
+
+    set_node(tree, index, &readings[middle]);
+    tree->nodes[index].child[0] = build_sorted(tree, readings, low, middle);
+    tree->nodes[index].child[1] = build_sorted(tree, readings, middle + 1,
+                                               high);
+    update(tree, index);
+
+    return index;
+}
+
+
+
+/**
+ * height() - returns the height of a subtree, 0 for no node
+ */
+static int height(const CompactTree_t* tree, uint32_t index) {
+    return (index != 0) ? tree->nodes[index].height : 0;
+}
+
+
+
+/**
+ * update() - recomputes a node's height from its children
+ */
+static void update(CompactTree_t* tree, uint32_t index) {
+    CompactNode_t* node = &tree->nodes[index];
+    int left = height(tree, node->child[0]);
+    int right = height(tree, node->child[1]);
+
+    node->height = (uint8_t)(1 + (left > right ? left : right));
+}
+
+
+
+/**
+ * rotate() - rotates a subtree, side 0 lifts the left child (a right
+ *            rotation) and side 1 lifts the right child (a left rotation)
+ *
+ * @return   index of the new subtree root
+ */
+static uint32_t rotate(CompactTree_t* tree, uint32_t index, int side) {
+    CompactNode_t* nodes = tree->nodes;
+    uint32_t lifted = nodes[index].child[side];
+
+    nodes[index].child[side] = nodes[lifted].child[!side];
+    nodes[lifted].child[!side] = index;
+    update(tree, index);
+    update(tree, lifted);
+
+    return lifted;
+}
+
+
+
+/**
+ * rebalance() - updates a node's height and rotates it if its children's
+ *               heights differ by more than one
+ *
+ * @return   index of the subtree root after any rotation
+ */
+static uint32_t rebalance(CompactTree_t* tree, uint32_t index) {
+    CompactNode_t* nodes = tree->nodes;
+
+    update(tree, index);
+
+    int balance = height(tree, nodes[index].child[0]) -
+                  height(tree, nodes[index].child[1]);
+
+    if (balance > 1 || balance < -1) {
+        // Heavy side, double rotation needed if that child leans inwards
+        int side = (balance < -1);
+        uint32_t heavy = nodes[index].child[side];
+
+        if (height(tree, nodes[heavy].child[side]) <
+            height(tree, nodes[heavy].child[!side])) {
+            nodes[index].child[side] = rotate(tree, heavy, !side);
+        }
+
+        return rotate(tree, index, side);
+    }
+
+    return index;
+}
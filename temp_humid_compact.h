@@ -0,0 +1,147 @@
+/**
+ * @file        temp_humid_compact.h
+ * @brief
+ * Defines a compact-node variant of the Temp/Humidity BST. Nodes live in one
+ * growing pool and link to each other by 32-bit pool index instead of by
+ * pointer, timestamps are stored as 32-bit offsets from a base time chosen by
+ * the tree, and temperature and humidity are packed together into the 40
+ * bits their 20-bit AHT20 registers need. A node is 20 bytes against the 40
+ * of a Node_t built without summaries, so twice as many fit in cache and
+ * search() touches half the memory.
+ *
+ * The tree is kept height balanced with AVL rotations like Tree_t. It holds
+ * at most UINT32_MAX - 1 readings, all within a 2^32 second (136 year)
+ * window, with values below 2^20.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef TEMP_HUMID_COMPACT_H
+#define TEMP_HUMID_COMPACT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "temp_humid_bst.h"
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Width of a packed temperature or humidity value
+#define COMPACT_VALUE_BITS      20
+
+// Initial number of nodes the pool has room for
+#define COMPACT_MIN_CAPACITY    64
+
+
+// Defines a compact node. Children are pool indices, 0 means no child
+typedef struct temperature_humidity_compact_node {
+    uint32_t offset;        // Timestamp - tree base
+    uint32_t child[2];      // Left (earlier) and right (later) child
+    uint32_t values_low;    // Low 32 bits of temp | humid << 20
+    uint8_t values_high;    // High 8 bits of the packed values
+    uint8_t height;         // Height of subtree (leaf is 1)
+} CompactNode_t;
+
+
+
+// Defines the compact Temp/Humidity tree
+typedef struct temperature_humidity_compact_tree {
+    CompactNode_t* nodes;   // Node pool, nodes[0] is never used
+    uint32_t root;          // Index of the root node, 0 if empty
+    uint32_t count;         // Number of readings in the tree
+    uint32_t capacity;      // Number of entries in nodes
+    time_t base;            // Timestamp stored as offset 0
+} CompactTree_t;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * create_compact_tree() - creates an empty compact Temp/Humidity tree
+ *
+ * @return	a pointer to the new tree if succeeds.  NULL if it fails
+ *
+ * @note The base time is set by the first insert, centering the window of
+ * timestamps the tree can hold on that reading.
+ */
+CompactTree_t* create_compact_tree(void);
+
+
+
+/**
+ * build_compact_from_sorted() - builds a perfectly balanced compact tree from
+ *                               readings already sorted by timestamp
+ *
+ * @param	readings	array of readings in non-decreasing timestamp order
+ * @param	count		number of readings in the array
+ * @return				a pointer to the new tree, or NULL if allocation
+ *						fails or the readings are unsorted or do not fit
+ */
+CompactTree_t* build_compact_from_sorted(const Data_t* readings, size_t count);
+
+
+
+/**
+ * compact_tree() - builds a compact copy of a tree
+ *
+ * @param	tree	pointer to the TempHumidtree to copy.  The tree is not
+ *					modified and may be deleted once the copy is built
+ * @return			pointer to the new compact tree or NULL if it fails
+ */
+CompactTree_t* compact_tree(const Tree_t* tree);
+
+
+
+/**
+ * compact_insert() - inserts a temp/humid reading into the tree
+ *
+ * @param	tree	pointer to the compact tree to add the reading to
+ * @param	info	Temp/Humid reading to add
+ * @return			true if the reading was added, false if allocation fails
+ *					or the reading does not fit the compact format
+ *
+ * @note Rebalances the insertion path like insert(), O(log n).
+ */
+bool compact_insert(CompactTree_t* tree, Data_t info);
+
+
+
+/**
+ * compact_search() - searches the tree for a reading w/ the specified
+ *                    timestamp
+ *
+ * @param	tree		pointer to the compact tree to search
+ * @param	timestamp	timestamp of the Temp/Humid reading we are seeking
+ * @param	out			filled with the reading if it is found
+ * @return				true if found, false if not
+ *
+ * @note Finds a reading whenever search() would. If several readings share
+ * the timestamp it returns one of them, not necessarily the one search()
+ * returns. Never prints.
+ */
+bool compact_search(const CompactTree_t* tree, time_t timestamp, Data_t* out);
+
+
+
+/**
+ * compact_bytes() - returns the memory held by a compact tree in bytes
+ */
+size_t compact_bytes(const CompactTree_t* tree);
+
+
+
+/**
+ * delete_compact_tree() - frees all memory used by a compact tree
+ *
+ * @param tree   Represents pointer to the tree to delete/free
+ */
+void delete_compact_tree(CompactTree_t* tree);
+
+
+
+#endif
@@ -0,0 +1,219 @@
+/**
+ * @file        temp_humid_export.c
+ * @brief
+ * Implements the text export engine defined in temp_humid_export.h.
+ *
+ * The date cache is filled with localtime_r() and strftime(), so the table
+ * matches in_order() in any time zone or locale, and remembers when the next
+ * local midnight falls so that a daylight saving change is not missed.
+ * Readings arrive in timestamp order, so the cache only misses once per day.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "temp_humid_export.h"
+#include "bst_log.h"
+
+
+
+/******************************** Definitions *********************************/
+
+// Spaces between the date and the temperature
+#define EXPORT_GAP          "     "
+#define EXPORT_GAP_LENGTH   5
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static void cache_date(Export_t* out, time_t timestamp);
+static char* put_hex(char* p, uint32_t value);
+static bool flush_buffer(Export_t* out);
+
+
+
+/************************ API Function Implementations ************************/
+
+void export_begin(Export_t* out, int fd) {
+    if (out == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(export_begin()): Cannot start NULL export.\n");
+        return;
+    }
+
+    // localtime_r() need not read the TZ setting itself
+    tzset();
+
+    out->fd = fd;
+    out->failed = (fd < 0);
+    out->used = 0;
+    out->day_begin = 0;
+    out->day_end = 0;
+    out->date_length = 0;
+}
+
+
+
+bool export_reading(Export_t* out, const Data_t* reading) {
+    if (out == NULL || reading == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(export_reading()): Cannot export NULL reading.\n");
+        return false;
+    }
+
+    if (EXPORT_BUFFER_SIZE - out->used < EXPORT_MAX_LINE &&
+        !flush_buffer(out)) {
+        return false;
+    }
+
+    if (reading->timestamp < out->day_begin ||
+        reading->timestamp >= out->day_end) {
+        cache_date(out, reading->timestamp);
+    }
+
+    char* p = out->buffer + out->used;
+
+    memcpy(p, out->date, out->date_length);
+    p += out->date_length;
+    memcpy(p, EXPORT_GAP, EXPORT_GAP_LENGTH);
+    p += EXPORT_GAP_LENGTH;
+    p = put_hex(p, reading->temp);
+    *p++ = ' ';
+    p = put_hex(p, reading->humid);
+    *p++ = '\n';
+
+    out->used = (size_t)(p - out->buffer);
+
+    return !out->failed;
+}
+
+
+
+bool export_end(Export_t* out) {
+    if (out == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(export_end()): Cannot finish NULL export.\n");
+        return false;
+    }
+
+    return flush_buffer(out);
+}
+
+
+
+bool tree_export(const Tree_t* tree, int fd) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_export()): Cannot export NULL tree.\n");
+        return false;
+    }
+
+    Export_t out;
+    TreeIter_t iter;
+    const Data_t* reading;
+
+    export_begin(&out, fd);
+    tree_iter_begin(&iter, tree);
+
+    while ((reading = tree_iter_next(&iter)) != NULL &&
+           export_reading(&out, reading)) {
+    }
+
+    tree_iter_end(&iter);
+
+    return export_end(&out);
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * cache_date() - formats the date of a timestamp and works out how long the
+ *                same date applies
+ *
+ * @param out         Export whose cache is refilled
+ * @param timestamp   Reading that missed the cache
+ */
+static void cache_date(Export_t* out, time_t timestamp) {
+    struct tm local;
+
+    out->day_begin = timestamp;
+    out->day_end = timestamp;
+
+    if (localtime_r(&timestamp, &local) == NULL) {
+        out->date_length = 0;
+        return;
+    }
+
+    out->date_length = strftime(out->date, sizeof(out->date), "%d-%b-%Y",
+                                &local);
+
+    // Next local midnight, mktime() picks standard or daylight time
+    local.tm_mday++;
+    local.tm_hour = 0;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+
+    time_t midnight = mktime(&local);
+
+    // Leaves the cache empty for one reading if midnight cannot be found
+    if (midnight != (time_t)-1 && midnight > timestamp) {
+        out->day_end = midnight;
+    }
+}
+
+
+
+/**
+ * put_hex() - writes a value as 8 upper case hex digits, like "%08X"
+ *
+ * @return   position just after the digits
+ */
+static char* put_hex(char* p, uint32_t value) {
+    static const char digits[] = "0123456789ABCDEF";
+
+    for (int i = 7; i >= 0; i--) {
+        p[i] = digits[value & 0xF];
+        value >>= 4;
+    }
+
+    return p + 8;
+}
+
+
+
+/**
+ * flush_buffer() - hands the buffered lines to write(), retrying short writes
+ *
+ * @return   true if everything buffered so far has been written
+ */
+static bool flush_buffer(Export_t* out) {
+    size_t done = 0;
+
+    while (!out->failed && done < out->used) {
+        ssize_t wrote = write(out->fd, out->buffer + done, out->used - done);
+
+        if (wrote > 0) {
+            done += (size_t)wrote;
+        }
+        else if (wrote == 0 || errno != EINTR) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(export_end()): Failed to write output.\n");
+            out->failed = true;
+        }
+    }
+
+    out->used = 0;
+
+    return !out->failed;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file        temp_humid_export.h
+ * @brief
+ * Defines a buffered text export engine for Temp/Humidity readings. It writes
+ * the same table as in_order(), one "dd-Mon-yyyy     TTTTTTTT HHHHHHHH" line
+ * per reading, without a printf() or localtime() call per line:
+ *   - lines are formatted into a fixed buffer that is handed to write() only
+ *     when it fills, and nothing is allocated
+ *   - the formatted date is cached and reused until the next local midnight,
+ *     since loggers take many readings per day
+ *   - the values are converted to fixed-width hex by a lookup table
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef TEMP_HUMID_EXPORT_H
+#define TEMP_HUMID_EXPORT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <time.h>
+#include "temp_humid_bst.h"
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Bytes buffered before each write() call
+#define EXPORT_BUFFER_SIZE  (64 * 1024)
+
+// Longest line written, the date string plus the two values
+#define EXPORT_MAX_DATE     26
+#define EXPORT_MAX_LINE     (EXPORT_MAX_DATE + 24)
+
+
+// Defines an export in progress. It is meant to live on the caller's stack
+typedef struct temperature_humidity_export {
+    int fd;                         // Output, not closed by export_end()
+    bool failed;                    // Set once a write() has failed
+    size_t used;                    // Bytes waiting in buffer
+    time_t day_begin;               // Cached date is valid from here ...
+    time_t day_end;                 // ... up to, not including, here
+    size_t date_length;             // Length of the cached date
+    char date[EXPORT_MAX_DATE];     // Cached "%d-%b-%Y" string
+    char buffer[EXPORT_BUFFER_SIZE];
+} Export_t;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * export_begin() - starts an export to an open file descriptor
+ *
+ * @param	out		export to set up
+ * @param	fd		file, pipe or terminal to write to
+ */
+void export_begin(Export_t* out, int fd);
+
+
+
+/**
+ * export_reading() - adds one reading to the table
+ *
+ * @param	out		export in progress
+ * @param	reading	reading to format
+ * @return			false if an earlier write() failed
+ */
+bool export_reading(Export_t* out, const Data_t* reading);
+
+
+
+/**
+ * export_end() - writes out whatever is still buffered
+ *
+ * @param	out		export in progress
+ * @return			true if every line was written
+ */
+bool export_end(Export_t* out);
+
+
+
+/**
+ * tree_export() - writes every reading in a tree, oldest first
+ *
+ * @param	tree	tree to export
+ * @param	fd		file, pipe or terminal to write to
+ * @return			true if the whole table was written
+ *
+ * @note Output is byte for byte what in_order() prints. Anything the caller
+ * has left in stdout's buffer is not flushed, do that first when fd is
+ * STDOUT_FILENO.
+ */
+bool tree_export(const Tree_t* tree, int fd);
+
+
+
+#endif
@@ -0,0 +1,520 @@
+/**
+ * @file        temp_humid_frozen.c
+ * @brief
+ * Implements the frozen Temp/Humidity index defined in temp_humid_frozen.h.
+ * The sorted readings of a tree are copied into a 1-indexed array in
+ * Eytzinger order: the children of slot k are slots 2k and 2k + 1. A search
+ * descends by index arithmetic, so the next comparison never depends on a
+ * pointer load and upcoming levels can be prefetched.
+ *
+ * A snapshot file is the header followed by the keys and data arrays exactly
+ * as they are laid out in memory, so opening one only maps and checks it.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "temp_humid_frozen.h"
+#include "temp_humid_wal.h"
+#include "bst_log.h"
+
+
+
+/******************************** Definitions *********************************/
+
+// Keys are cache line aligned so a block of 8 siblings shares one line
+#define FROZEN_CACHE_LINE 64
+
+// Keys per cache line, prefetching keys[k * this] fetches the line holding
+// the descendants of slot k three levels down
+#define FROZEN_KEYS_PER_LINE (FROZEN_CACHE_LINE / sizeof(time_t))
+
+#ifdef __GNUC__
+#define FROZEN_PREFETCH(addr)   __builtin_prefetch(addr)
+#else
+#define FROZEN_PREFETCH(addr)   ((void)0)
+#endif
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static size_t fill_eytzinger(Frozen_t* frozen, const Data_t* sorted,
+                             size_t next, size_t k);
+static size_t first_zero_bit(size_t k);
+static uint64_t align_up(uint64_t offset);
+static bool write_snapshot(const Frozen_t* frozen, FILE* file);
+static bool header_valid(const SnapshotHeader_t* header, size_t file_size);
+static bool sync_directory(const char* path);
+
+
+
+/************************ API Function Implementations ************************/
+
+Frozen_t* freeze_tree(const Tree_t* tree) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(freeze_tree()): Cannot freeze NULL tree.\n");
+        return NULL;
+    }
+
+    size_t count = (size_t)tree->node_count;
+    Frozen_t* frozen = (Frozen_t*)malloc(sizeof(Frozen_t));
+    Data_t* sorted = (Data_t*)malloc((count + 1) * sizeof(Data_t));
+    void* keys = NULL;
+
+    if (frozen == NULL || sorted == NULL ||
+        posix_memalign(&keys, FROZEN_CACHE_LINE, 
+                       (count + 1) * sizeof(time_t)) != 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(freeze_tree()): Failed to allocate memory for %zu "
+                "readings.\n", count);
+        free(frozen);
+        free(sorted);
+        return NULL;
+    }
+
+    frozen->keys = (time_t*)keys;
+    frozen->data = (Data_t*)malloc((count + 1) * sizeof(Data_t));
+    frozen->count = count;
+    frozen->mapping = NULL;
+    frozen->mapping_size = 0;
+
+    if (frozen->data == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(freeze_tree()): Failed to allocate memory for %zu "
+                "readings.\n", count);
+        free(sorted);
+        delete_frozen(frozen);
+        return NULL;
+    }
+
+    // Flattens the tree, then deals the sorted readings out in BFS order
+    TreeIter_t iter;
+    const Data_t* reading;
+    size_t next = 0;
+
+    tree_iter_begin(&iter, tree);
+
+    while ((reading = tree_iter_next(&iter)) != NULL) {
+        sorted[next++] = *reading;
+    }
+
+    fill_eytzinger(frozen, sorted, 0, 1);
+
+    free(sorted);
+
+    return frozen;
+}
+
+
+
+const Data_t* frozen_search(const Frozen_t* frozen, time_t timestamp) {
+    if (frozen == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(frozen_search()): Cannot search NULL index.\n");
+        return NULL;
+    }
+
+    const time_t* keys = frozen->keys;
+    size_t count = frozen->count;
+    size_t k = 1;
+
+    // Descends to a leaf, going right whenever the key is smaller than the
+    // one we want. The comparison result is used as an index, not a branch
+    while (k <= count) {
+        FROZEN_PREFETCH(keys + k * FROZEN_KEYS_PER_LINE);
+        k = 2 * k + (keys[k] < timestamp);
+    }
+
+    // Undoes the trailing right turns (1 bits) and the final left turn to
+    // land on the first key >= timestamp, k is 0 if there is none
+    k >>= first_zero_bit(k) + 1;
+
+    if (k == 0 || keys[k] != timestamp) {
+        return NULL;
+    }
+
+    return &frozen->data[k];
+}
+
+
+
+bool tree_save(const Tree_t* tree, const char* path) {
+    if (tree == NULL || path == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_save()): Invalid tree or path.\n");
+        return false;
+    }
+
+    Frozen_t* frozen = freeze_tree(tree);
+    size_t path_length = strlen(path);
+    char* temp_path = (char*)malloc(path_length + sizeof(".tmp"));
+
+    if (frozen == NULL || temp_path == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_save()): Failed to allocate memory.\n");
+        delete_frozen(frozen);
+        free(temp_path);
+        return false;
+    }
+
+    memcpy(temp_path, path, path_length);
+    memcpy(temp_path + path_length, ".tmp", sizeof(".tmp"));
+
+    // Writes and syncs the whole file before it replaces the old one
+    FILE* file = fopen(temp_path, "wb");
+    bool saved = (file != NULL && write_snapshot(frozen, file) &&
+                  fflush(file) == 0 && fsync(fileno(file)) == 0);
+
+    if (file != NULL && fclose(file) != 0) {
+        saved = false;
+    }
+
+    // The rename is only durable once the directory holding it is synced
+    if (saved && (rename(temp_path, path) != 0 || !sync_directory(path))) {
+        saved = false;
+    }
+
+    if (!saved) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_save()): Failed to write snapshot %s.\n", path);
+        remove(temp_path);
+    }
+
+    // Every logged reading is in the snapshot now, including deletions
+    if (saved && tree->wal != NULL && !wal_checkpoint(tree->wal)) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_save()): Saved %s but could not checkpoint the "
+                "log.\n", path);
+        saved = false;
+    }
+
+    delete_frozen(frozen);
+    free(temp_path);
+
+    return saved;
+}
+
+
+
+Tree_t* tree_recover(const char* snapshot, const char* log) {
+    if (snapshot == NULL || log == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_recover()): Invalid snapshot or log path.\n");
+        return NULL;
+    }
+
+    // A missing file has no readings, one that cannot be read is an error
+    bool has_snapshot = (access(snapshot, F_OK) == 0);
+    Frozen_t* frozen = has_snapshot ? tree_open_mmap(snapshot) : NULL;
+    Tree_t* logged = (access(log, F_OK) == 0) ? wal_replay(log)
+                                              : create_tree();
+    size_t saved_count = (frozen != NULL) ? frozen->count : 0;
+    Data_t* readings = NULL;
+
+    if ((frozen != NULL || !has_snapshot) && logged != NULL) {
+        readings = (Data_t*)malloc((saved_count + logged->node_count + 1) *
+                                   sizeof(Data_t));
+    }
+
+    if (readings == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_recover()): Cannot recover from %s and %s.\n",
+                snapshot, log);
+        delete_frozen(frozen);
+        delete_tree(logged);
+        return NULL;
+    }
+
+    // The snapshot holds entries 1 to count, build_tree() sorts them all
+    if (saved_count > 0) {
+        memcpy(readings, frozen->data + 1, saved_count * sizeof(Data_t));
+    }
+
+    TreeIter_t iter;
+    const Data_t* reading;
+    size_t used = saved_count;
+
+    tree_iter_begin(&iter, logged);
+    while ((reading = tree_iter_next(&iter)) != NULL) {
+        readings[used++] = *reading;
+    }
+    tree_iter_end(&iter);
+
+    Tree_t* tree = build_tree(readings, used);
+
+    free(readings);
+    delete_frozen(frozen);
+    delete_tree(logged);
+
+    return tree;
+}
+
+
+
+Frozen_t* tree_open_mmap(const char* path) {
+    if (path == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_open_mmap()): Cannot open NULL path.\n");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_open_mmap()): Cannot open snapshot %s.\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    size_t file_size = (size_t)info.st_size;
+
+    if (file_size < sizeof(SnapshotHeader_t)) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_open_mmap()): %s is too short to be a "
+                "snapshot.\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* mapping = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_open_mmap()): Cannot map snapshot %s.\n", path);
+        return NULL;
+    }
+
+    const SnapshotHeader_t* header = (const SnapshotHeader_t*)mapping;
+    Frozen_t* frozen = NULL;
+
+    if (!header_valid(header, file_size)) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_open_mmap()): %s is not a valid snapshot for "
+                "this build.\n", path);
+    }
+    else if ((frozen = (Frozen_t*)malloc(sizeof(Frozen_t))) == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_open_mmap()): Failed to allocate index.\n");
+    }
+
+    if (frozen == NULL) {
+        munmap(mapping, file_size);
+        return NULL;
+    }
+
+    frozen->keys = (time_t*)((char*)mapping + header->keys_offset);
+    frozen->data = (Data_t*)((char*)mapping + header->data_offset);
+    frozen->count = (size_t)header->count;
+    frozen->mapping = mapping;
+    frozen->mapping_size = file_size;
+
+    BST_LOG(BST_LOG_INFO,
+            "INFO(tree_open_mmap()): Mapped %zu readings from %s.\n",
+            frozen->count, path);
+
+    return frozen;
+}
+
+
+
+void delete_frozen(Frozen_t* frozen) {
+    if (frozen != NULL) {
+        if (frozen->mapping != NULL) {
+            munmap(frozen->mapping, frozen->mapping_size);
+        }
+        else {
+            free(frozen->keys);
+            free(frozen->data);
+        }
+        free(frozen);
+    }
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * fill_eytzinger() - deals sorted readings into Eytzinger slots by walking
+ *                    the implicit tree rooted at slot k in order
+ *
+ * @param frozen   Index being filled
+ * @param sorted   Readings in timestamp order
+ * @param next     Index in sorted of the next reading to place
+ * @param k        Eytzinger slot at the root of the implicit subtree
+ * @return         Index in sorted of the next reading after the subtree
+ */
+static size_t fill_eytzinger(Frozen_t* frozen, const Data_t* sorted,
+                             size_t next, size_t k) {
+    if (k <= frozen->count) {
+        next = fill_eytzinger(frozen, sorted, next, 2 * k);
+        frozen->keys[k] = sorted[next].timestamp;
+        frozen->data[k] = sorted[next++];
+        next = fill_eytzinger(frozen, sorted, next, 2 * k + 1);
+    }
+
+    return next;
+}
+
+
+
+/**
+ * first_zero_bit() - returns the index of the lowest 0 bit in k
+ */
+static size_t first_zero_bit(size_t k) {
+#ifdef __GNUC__
+    return (size_t)__builtin_ctzll(~(unsigned long long)k);
+#else
+    size_t bit = 0;
+
+    while (k & 1) {
+        k >>= 1;
+        bit++;
+    }
+
+    return bit;
+#endif
+}
+
+
+
+/**
+ * align_up() - rounds a file offset up to the next cache line boundary
+ */
+static uint64_t align_up(uint64_t offset) {
+    uint64_t mask = FROZEN_CACHE_LINE - 1;
+
+    return (offset + mask) & ~mask;
+}
+
+
+
+/**
+ * write_snapshot() - writes the header and arrays of a frozen index
+ *
+ * @param frozen   Index to write
+ * @param file     File open for binary writing, positioned at its start
+ * @return         true if every byte was written
+ */
+static bool write_snapshot(const Frozen_t* frozen, FILE* file) {
+    static const char zeros[FROZEN_CACHE_LINE] = {0};
+    SnapshotHeader_t header;
+    uint64_t slots = (uint64_t)frozen->count + 1;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.key_size = (uint32_t)sizeof(time_t);
+    header.data_size = (uint32_t)sizeof(Data_t);
+    header.count = frozen->count;
+    header.keys_offset = align_up(sizeof(header));
+    header.data_offset = align_up(header.keys_offset + slots * sizeof(time_t));
+    header.file_size = header.data_offset + slots * sizeof(Data_t);
+
+    // Slot 0 of each array is unused but written so offsets match memory
+    size_t keys_padding = (size_t)(header.data_offset - header.keys_offset - 
+                                   slots * sizeof(time_t));
+
+    return fwrite(&header, sizeof(header), 1, file) == 1 &&
+           fwrite(zeros, 1, (size_t)header.keys_offset - sizeof(header), 
+                  file) == (size_t)header.keys_offset - sizeof(header) &&
+           fwrite(frozen->keys, sizeof(time_t), (size_t)slots, file) == slots &&
+           fwrite(zeros, 1, keys_padding, file) == keys_padding &&
+           fwrite(frozen->data, sizeof(Data_t), (size_t)slots, file) == slots;
+}
+
+
+
+/**
+ * header_valid() - checks a snapshot header against this build and the
+ *                  length of the file it came from
+ *
+ * @param header      Header at the start of the mapped file
+ * @param file_size   Length of the file in bytes
+ * @return            true if the arrays it describes lie within the file
+ */
+static bool header_valid(const SnapshotHeader_t* header, size_t file_size) {
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION ||
+        header->byte_order != SNAPSHOT_BYTE_ORDER ||
+        header->key_size != sizeof(time_t) ||
+        header->data_size != sizeof(Data_t) ||
+        header->file_size != file_size) {
+        return false;
+    }
+
+    // Checks the count first so the sizes below cannot overflow
+    uint64_t slots = header->count + 1;
+
+    // Offsets are checked against the file before the spaces between them
+    // are measured, so a huge offset cannot wrap around into range
+    if (header->count > file_size / sizeof(time_t) ||
+        header->keys_offset % FROZEN_CACHE_LINE != 0 ||
+        header->data_offset % FROZEN_CACHE_LINE != 0 ||
+        header->keys_offset < sizeof(*header) ||
+        header->keys_offset > header->data_offset ||
+        header->data_offset > file_size ||
+        slots * sizeof(time_t) > header->data_offset - header->keys_offset ||
+        slots * sizeof(Data_t) > file_size - header->data_offset) {
+        return false;
+    }
+
+    return true;
+}
+
+
+
+/**
+ * sync_directory() - flushes the directory entry of a file to disk
+ *
+ * @param path   File whose directory to sync
+ * @return       true if synced, or if the file system cannot sync directories
+ */
+static bool sync_directory(const char* path) {
+    const char* slash = strrchr(path, '/');
+    size_t length = (slash == NULL) ? 0 : (size_t)(slash - path);
+    char* directory = (char*)malloc(length + 2);
+
+    if (directory == NULL) {
+        return false;
+    }
+
+    // "dir/file" syncs "dir", "/file" syncs "/" and "file" syncs "."
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    }
+    else {
+        memcpy(directory, path, (length == 0) ? 1 : length);
+        directory[(length == 0) ? 1 : length] = '\0';
+    }
+
+    int fd = open(directory, O_RDONLY);
+    bool synced = (fd >= 0 && (fsync(fd) == 0 || errno == EINVAL));
+
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(directory);
+
+    return synced;
+}
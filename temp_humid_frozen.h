@@ -0,0 +1,157 @@
+/**
+ * @file        temp_humid_frozen.h
+ * @brief
+ * Defines a read-only "frozen" index built from a Temp/Humidity BST. Once a
+ * day's readings are loaded and only queried, the tree can be frozen into one
+ * contiguous array laid out in Eytzinger (breadth-first) order. Searching it
+ * touches one cache line per few levels instead of one scattered heap node
+ * per level, and the search loop is branch-free with software prefetching.
+ *
+ * The same arrays make the on-disk snapshot format. tree_save() writes them
+ * after a fixed header and tree_open_mmap() maps the file read-only, so a
+ * saved index is searchable as soon as the header has been checked, with no
+ * rebuild or deserialization.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef TEMP_HUMID_FROZEN_H
+#define TEMP_HUMID_FROZEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "temp_humid_bst.h"
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Identifies a snapshot file and the layout version it was written with
+#define SNAPSHOT_MAGIC      "THBSTSNP"
+#define SNAPSHOT_VERSION    1
+
+// Written as a number and read back to detect a file from another byte order
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+
+// Defines the frozen (read-only, Eytzinger ordered) index
+typedef struct temperature_humidity_frozen_tree {
+    time_t* keys;           // Timestamps in Eytzinger order, keys[1] is root
+    Data_t* data;           // Readings in the same order as keys
+    size_t count;           // Number of readings in the index
+    void* mapping;          // Snapshot file mapping, NULL if arrays are heap
+    size_t mapping_size;    // Length of the mapping in bytes
+} Frozen_t;
+
+
+
+// Defines the header at the start of a snapshot file. Every offset is from
+// the start of the file and a multiple of 64, so the arrays are cache line
+// aligned in the mapping
+typedef struct temperature_humidity_snapshot_header {
+    char magic[8];          // SNAPSHOT_MAGIC, not NUL terminated
+    uint32_t version;       // SNAPSHOT_VERSION
+    uint32_t byte_order;    // SNAPSHOT_BYTE_ORDER as written
+    uint32_t key_size;      // sizeof(time_t) of the writer
+    uint32_t data_size;     // sizeof(Data_t) of the writer
+    uint64_t count;         // Number of readings
+    uint64_t keys_offset;   // Offset of keys[0], count + 1 entries
+    uint64_t data_offset;   // Offset of data[0], count + 1 entries
+    uint64_t file_size;     // Total length of the file
+    uint8_t reserved[8];    // Zero, pads the header to 64 bytes
+} SnapshotHeader_t;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * freeze_tree() - builds a read-only Eytzinger index from a tree
+ *
+ * @param	tree	pointer to the TempHumidtree to freeze.  The tree is not
+ *					modified and may be deleted once the index is built
+ * @return			pointer to the new index or NULL if it fails
+ */
+Frozen_t* freeze_tree(const Tree_t* tree);
+
+
+
+/**
+ * frozen_search() - searches the frozen index for a reading w/ the specified
+ *                   timestamp
+ *
+ * @param	frozen		pointer to the frozen index to search
+ * @param	timestamp	timestamp of the Temp/Humid reading we are seeking
+ * @return				pointer to the reading with that timestamp or NULL if 
+ *						not found
+ *
+ * @note Finds a reading whenever search() finds one on the source tree. If
+ * several readings share the timestamp this returns the earliest of them in
+ * the tree's order, which need not be the one search() returns. The search
+ * never prints, it is meant for query-heavy workloads.
+ */
+const Data_t* frozen_search(const Frozen_t* frozen, time_t timestamp);
+
+
+
+/**
+ * tree_save() - writes a tree to a snapshot file as a frozen index
+ *
+ * @param	tree	pointer to the TempHumidtree to save
+ * @param	path	file to write.  Replaced only once the new file is
+ *					complete, so a crash leaves the old snapshot intact
+ * @return			true if succeeds, false if it fails
+ *
+ * @note The file is written to path + ".tmp", flushed to disk and renamed,
+ * and the directory is synced so the rename survives a crash too. If the
+ * tree has a write-ahead log it is then checkpointed with wal_checkpoint(),
+ * and false is returned if that fails even though the snapshot was saved.
+ * Snapshots are only readable on machines with the same byte order and
+ * sizeof(time_t) as the writer, tree_open_mmap() checks both.
+ */
+bool tree_save(const Tree_t* tree, const char* path);
+
+
+
+/**
+ * tree_recover() - rebuilds a tree from a snapshot and the write-ahead log
+ *                  checkpointed by it
+ *
+ * @param	snapshot	snapshot written by tree_save(), may not exist yet
+ * @param	log			write-ahead log attached to the saved tree
+ * @return				pointer to a new balanced tree holding the snapshot's
+ *						readings and those logged since, or NULL if either
+ *						file exists but cannot be read
+ */
+Tree_t* tree_recover(const char* snapshot, const char* log);
+
+
+
+/**
+ * tree_open_mmap() - opens a snapshot file written by tree_save()
+ *
+ * @param	path	snapshot file to open
+ * @return			pointer to a frozen index backed by the mapped file, or
+ *					NULL if the file cannot be mapped or fails its checks
+ *
+ * @note Costs one mmap() and a header check regardless of the file size.
+ * frozen_search() then reads the mapped pages directly and the OS pages in
+ * only the parts of the index that are searched. delete_frozen() unmaps it.
+ */
+Frozen_t* tree_open_mmap(const char* path);
+
+
+
+/**
+ * delete_frozen() - frees all memory used by a frozen index
+ *
+ * @param frozen   Represents pointer to the index to delete/free.  A mapped
+ *                 snapshot is unmapped
+ */
+void delete_frozen(Frozen_t* frozen);
+
+
+
+#endif
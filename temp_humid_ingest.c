@@ -0,0 +1,464 @@
+/**
+ * @file        temp_humid_ingest.c
+ * @brief
+ * Implements the bulk loaders defined in temp_humid_ingest.h.
+ *
+ * Both loaders append into one growing array of readings and hand it to
+ * build_tree() at the end. CSV input is read a block at a time, every whole
+ * line in the block is parsed straight out of the buffer and the partial
+ * line at its end is carried over to the next read. Binary input is read
+ * straight into the array with no copy at all.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "temp_humid_ingest.h"
+#include "bst_log.h"
+
+
+
+/******************************** Definitions *********************************/
+
+// Shortest possible CSV reading, "0,0,0\n", bounds the readings in a block
+#define INGEST_MIN_LINE     6
+
+// Readings allocated up front when the input size is unknown
+#define INGEST_MIN_READINGS 65536
+
+// Most digits a value may have, so it cannot overflow 64 bits while parsed
+#define INGEST_MAX_DECIMAL  19
+#define INGEST_MAX_HEX      16
+
+
+// Defines the readings loaded so far
+typedef struct temperature_humidity_ingest_batch {
+    Data_t* readings;       // Readings in input order
+    size_t count;           // Number of readings loaded
+    size_t capacity;        // Readings the array has room for
+} Batch_t;
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static bool read_csv(int fd, Batch_t* batch);
+static bool read_binary(int fd, Batch_t* batch);
+static const char* parse_line(const char* p, Data_t* reading);
+static const char* parse_value(const char* p, uint64_t limit, uint64_t* value);
+static bool batch_reserve(Batch_t* batch, size_t extra);
+static size_t input_size(int fd);
+static ssize_t read_some(int fd, void* buffer, size_t length);
+
+
+
+/************************ API Function Implementations ************************/
+
+Tree_t* ingest_fd(int fd, IngestFormat_t format) {
+    if (fd < 0 || (format != INGEST_CSV && format != INGEST_BINARY)) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(ingest_fd()): Invalid file or format.\n");
+        return NULL;
+    }
+
+    Batch_t batch = {NULL, 0, 0};
+    bool loaded = (format == INGEST_CSV) ? read_csv(fd, &batch)
+                                         : read_binary(fd, &batch);
+
+    Tree_t* tree = loaded ? build_tree(batch.readings, batch.count) : NULL;
+
+    free(batch.readings);
+
+    return tree;
+}
+
+
+
+Tree_t* ingest_file(const char* path, IngestFormat_t format) {
+    if (path == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(ingest_file()): Cannot read NULL path.\n");
+        return NULL;
+    }
+
+    bool from_stdin = (strcmp(path, "-") == 0);
+    int fd = from_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+
+    if (fd < 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(ingest_file()): Cannot open %s.\n", path);
+        return NULL;
+    }
+
+    Tree_t* tree = ingest_fd(fd, format);
+
+    if (!from_stdin) {
+        close(fd);
+    }
+
+    if (tree != NULL) {
+        BST_LOG(BST_LOG_INFO,
+                "INFO(ingest_file()): Loaded %d readings from %s.\n",
+                tree->node_count, from_stdin ? "stdin" : path);
+    }
+
+    return tree;
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * read_csv() - parses CSV readings until end of file
+ *
+ * @param fd      Input to read
+ * @param batch   Readings are appended here
+ * @return        true if the whole input parsed
+ */
+static bool read_csv(int fd, Batch_t* batch) {
+    // One spare byte so a last line without a newline can be given one
+    char* block = (char*)malloc(INGEST_BLOCK_SIZE + 1);
+
+    if (block == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(ingest_fd()): Failed to allocate memory.\n");
+        return false;
+    }
+
+    size_t carried = 0;
+    size_t line = 0;
+    bool done = false;
+
+    while (!done) {
+        ssize_t got = read_some(fd, block + carried,
+                                INGEST_BLOCK_SIZE - carried);
+
+        if (got < 0) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(ingest_fd()): Failed to read input.\n");
+            free(block);
+            return false;
+        }
+
+        size_t length = carried + (size_t)got;
+
+        if (got == 0) {
+            done = true;
+            if (length > 0 && block[length - 1] != '\n') {
+                block[length++] = '\n';
+            }
+        }
+
+        // Only whole lines are parsed, so the parser never checks for the
+        // end of the buffer, each line ends at its own newline
+        size_t end = length;
+
+        while (end > 0 && block[end - 1] != '\n') {
+            end--;
+        }
+
+        if (end == 0 && length == INGEST_BLOCK_SIZE) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(ingest_fd()): Line %zu is too long.\n", line + 1);
+            free(block);
+            return false;
+        }
+
+        if (!batch_reserve(batch, end / INGEST_MIN_LINE + 1)) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(ingest_fd()): Failed to allocate memory.\n");
+            free(block);
+            return false;
+        }
+
+        const char* p = block;
+        const char* stop = block + end;
+        Data_t* out = batch->readings + batch->count;
+
+        while (p < stop) {
+            const char* next;
+
+            line++;
+
+            if (*p == '\n' || (*p == '\r' && p[1] == '\n')) {
+                next = p + (*p == '\r') + 1;
+            }
+            else if (line == 1 && (*p | 0x20) >= 'a' && (*p | 0x20) <= 'z') {
+                next = (const char*)memchr(p, '\n', stop - p) + 1;
+            }
+            else if ((next = parse_line(p, out)) != NULL) {
+                out++;
+            }
+            else {
+                BST_LOG(BST_LOG_ERROR,
+                        "ERROR(ingest_fd()): Malformed reading on line "
+                        "%zu.\n", line);
+                free(block);
+                return false;
+            }
+
+            p = next;
+        }
+
+        batch->count = (size_t)(out - batch->readings);
+
+        carried = length - end;
+        memmove(block, block + end, carried);
+    }
+
+    free(block);
+
+    return true;
+}
+
+
+
+/**
+ * read_binary() - reads raw Data_t records until end of file
+ *
+ * @param fd      Input to read
+ * @param batch   Readings are appended here
+ * @return        true if the input held only whole records
+ */
+static bool read_binary(int fd, Batch_t* batch) {
+    // A regular file is read into an array of exactly the right size, plus
+    // one so the read that finds end of file has room
+    if (!batch_reserve(batch, input_size(fd) / sizeof(Data_t) + 1)) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(ingest_fd()): Failed to allocate memory.\n");
+        return false;
+    }
+
+    size_t bytes = 0;
+    ssize_t got;
+
+    do {
+        // A full array holds whole records only, so count them before
+        // asking for room, otherwise batch_reserve() thinks it is empty
+        batch->count = bytes / sizeof(Data_t);
+
+        if (bytes == batch->capacity * sizeof(Data_t) &&
+            !batch_reserve(batch, batch->capacity)) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(ingest_fd()): Failed to allocate memory.\n");
+            return false;
+        }
+
+        got = read_some(fd, (char*)batch->readings + bytes,
+                        batch->capacity * sizeof(Data_t) - bytes);
+        bytes += (got > 0) ? (size_t)got : 0;
+    } while (got > 0);
+
+    batch->count = bytes / sizeof(Data_t);
+
+    if (got < 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(ingest_fd()): Failed to read input.\n");
+        return false;
+    }
+
+    if (bytes % sizeof(Data_t) != 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(ingest_fd()): Input ends part way through reading "
+                "%zu.\n", batch->count + 1);
+        return false;
+    }
+
+    return true;
+}
+
+
+
+/**
+ * parse_line() - parses one "timestamp,temp,humid" line
+ *
+ * @param p         Start of the line, which must end in '\n'
+ * @param reading   Filled with the reading
+ * @return          start of the next line, or NULL if the line is malformed
+ */
+static const char* parse_line(const char* p, Data_t* reading) {
+    uint64_t seconds, temp, humid;
+    bool negative;
+
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+
+    negative = (*p == '-');
+    p += negative;
+
+    if ((p = parse_value(p, INT64_MAX, &seconds)) == NULL || *p != ',') {
+        return NULL;
+    }
+
+    do {
+        p++;
+    } while (*p == ' ' || *p == '\t');
+
+    if ((p = parse_value(p, UINT32_MAX, &temp)) == NULL || *p != ',') {
+        return NULL;
+    }
+
+    do {
+        p++;
+    } while (*p == ' ' || *p == '\t');
+
+    if ((p = parse_value(p, UINT32_MAX, &humid)) == NULL) {
+        return NULL;
+    }
+
+    p += (*p == '\r');
+
+    if (*p != '\n') {
+        return NULL;
+    }
+
+    reading->timestamp = negative ? -(time_t)seconds : (time_t)seconds;
+    reading->temp = (uint32_t)temp;
+    reading->humid = (uint32_t)humid;
+
+    return p + 1;
+}
+
+
+
+/**
+ * parse_value() - parses an unsigned decimal or 0x prefixed hex value
+ *
+ * @param p       First character of the value
+ * @param limit   Largest value allowed
+ * @param value   Filled with the value
+ * @return        first character after the value, or NULL if there are no
+ *                digits, too many digits or the value is above limit
+ */
+static const char* parse_value(const char* p, uint64_t limit, uint64_t* value) {
+    const char* start;
+    uint64_t result = 0;
+
+    if (p[0] == '0' && (p[1] | 0x20) == 'x') {
+        p += 2;
+        start = p;
+
+        for (;;) {
+            unsigned digit = (unsigned char)*p - '0';
+            unsigned letter = ((unsigned char)*p | 0x20) - 'a';
+
+            if (digit < 10) {
+                result = (result << 4) | digit;
+            }
+            else if (letter < 6) {
+                result = (result << 4) | (letter + 10);
+            }
+            else {
+                break;
+            }
+            p++;
+        }
+
+        if (p - start > INGEST_MAX_HEX) {
+            return NULL;
+        }
+    }
+    else {
+        start = p;
+
+        for (unsigned digit; (digit = (unsigned char)*p - '0') < 10; p++) {
+            result = result * 10 + digit;
+        }
+
+        if (p - start > INGEST_MAX_DECIMAL) {
+            return NULL;
+        }
+    }
+
+    if (p == start || result > limit) {
+        return NULL;
+    }
+
+    *value = result;
+
+    return p;
+}
+
+
+
+/**
+ * batch_reserve() - makes room for more readings, at least doubling the array
+ *
+ * @param batch   Readings loaded so far
+ * @param extra   Readings about to be added
+ * @return        true if there is room
+ */
+static bool batch_reserve(Batch_t* batch, size_t extra) {
+    if (batch->capacity - batch->count >= extra) {
+        return true;
+    }
+
+    size_t capacity = 2 * batch->capacity;
+
+    if (capacity < batch->count + extra) {
+        capacity = batch->count + extra;
+    }
+
+    if (capacity < INGEST_MIN_READINGS) {
+        capacity = INGEST_MIN_READINGS;
+    }
+
+    Data_t* grown = (Data_t*)realloc(batch->readings,
+                                     capacity * sizeof(Data_t));
+    if (grown == NULL) {
+        return false;
+    }
+
+    batch->readings = grown;
+    batch->capacity = capacity;
+
+    return true;
+}
+
+
+
+/**
+ * input_size() - returns the bytes left in a regular file, 0 for a pipe
+ */
+static size_t input_size(int fd) {
+    struct stat info;
+    off_t position = lseek(fd, 0, SEEK_CUR);
+
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || position < 0 ||
+        info.st_size < position) {
+        return 0;
+    }
+
+    return (size_t)(info.st_size - position);
+}
+
+
+
+/**
+ * read_some() - read() that retries when interrupted by a signal
+ *
+ * @return   bytes read, 0 at end of file, -1 on error
+ */
+static ssize_t read_some(int fd, void* buffer, size_t length) {
+    ssize_t got;
+
+    do {
+        got = read(fd, buffer, length);
+    } while (got < 0 && errno == EINTR);
+
+    return got;
+}
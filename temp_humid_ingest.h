@@ -0,0 +1,72 @@
+/**
+ * @file        temp_humid_ingest.h
+ * @brief
+ * Defines bulk loading of logged Temp/Humidity readings from a file or pipe.
+ * Input is read in large blocks and parsed in place by a hand-written
+ * parser, with no per-line scanf() or strptime(), and the readings are bulk
+ * loaded into a balanced tree in one pass once the input ends.
+ *
+ * Two formats are read:
+ *   - CSV, one "timestamp,temp,humid" reading per line. The timestamp is
+ *     Unix seconds, temp and humid are the raw register values in decimal or
+ *     as 0x prefixed hex. Blank lines, '\r' line ends, spaces before a field
+ *     and one header line starting with a letter are skipped
+ *   - binary, a stream of Data_t structs exactly as they sit in memory on
+ *     this machine
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef TEMP_HUMID_INGEST_H
+#define TEMP_HUMID_INGEST_H
+
+#include <stddef.h>
+#include "temp_humid_bst.h"
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Bytes requested per read() call
+#define INGEST_BLOCK_SIZE   (1 << 20)
+
+
+// Defines the input formats
+typedef enum temperature_humidity_ingest_format {
+    INGEST_CSV,             // Text lines of timestamp,temp,humid
+    INGEST_BINARY           // Raw Data_t records
+} IngestFormat_t;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * ingest_fd() - reads every reading from an open file or pipe into a tree
+ *
+ * @param	fd		file descriptor to read until end of file.  Not closed
+ * @param	format	INGEST_CSV or INGEST_BINARY
+ * @return			a pointer to a new balanced tree holding every reading,
+ *					or NULL if the input cannot be read or is malformed
+ *
+ * @note The whole input must be valid, a bad CSV line or a binary stream
+ * that ends part way through a record is reported and nothing is loaded.
+ * Readings in timestamp order are loaded without sorting.
+ */
+Tree_t* ingest_fd(int fd, IngestFormat_t format);
+
+
+
+/**
+ * ingest_file() - reads every reading from a file into a tree
+ *
+ * @param	path	file to read, "-" to read stdin
+ * @param	format	INGEST_CSV or INGEST_BINARY
+ * @return			a pointer to a new balanced tree, or NULL if it fails
+ */
+Tree_t* ingest_file(const char* path, IngestFormat_t format);
+
+
+
+#endif
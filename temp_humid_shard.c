@@ -0,0 +1,334 @@
+/**
+ * @file        temp_humid_shard.c
+ * @brief
+ * Implements the sharded Temp/Humidity tree set defined in temp_humid_shard.h.
+ * A reading's sensor id and time bucket are hashed to pick its shard. Range
+ * queries lock the shards in index order, so they cannot deadlock with each
+ * other, and inserts only ever hold one lock.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "temp_humid_shard.h"
+#include "bst_log.h"
+
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Defines one shard's position in a merged range walk
+typedef struct {
+    TreeIter_t iter;        // Cursor into the shard's tree
+    const Data_t* head;     // Next reading from this shard
+} Cursor_t;
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static size_t shard_index(const ShardSet_t* set, uint32_t sensor_id,
+                          time_t timestamp);
+static void sift_down(const Cursor_t* cursors, size_t* heap, size_t size,
+                      size_t slot);
+static void summary_merge(Summary_t* total, const Summary_t* part);
+
+
+
+/************************ API Function Implementations ************************/
+
+ShardSet_t* create_shardset(size_t shard_count, time_t bucket_seconds) {
+    if (shard_count == 0 || shard_count > SHARD_MAX_COUNT) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(create_shardset()): Shard count must be 1 to %d.\n",
+                SHARD_MAX_COUNT);
+        return NULL;
+    }
+
+    if (bucket_seconds < 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(create_shardset()): Invalid bucket width %ld.\n",
+                (long)bucket_seconds);
+        return NULL;
+    }
+
+    ShardSet_t* set = (ShardSet_t*)malloc(sizeof(ShardSet_t));
+    Shard_t* shards = (Shard_t*)calloc(shard_count, sizeof(Shard_t));
+
+    if (set == NULL || shards == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(create_shardset()): Failed to create set.\n");
+        free(set);
+        free(shards);
+        return NULL;
+    }
+
+    set->shards = shards;
+    set->count = 0;
+    set->bucket_seconds = bucket_seconds;
+
+    // Counts shards as they are set up so a failure frees only those
+    for (size_t i = 0; i < shard_count; i++) {
+        shards[i].tree = create_tree();
+
+        if (shards[i].tree == NULL ||
+            pthread_mutex_init(&shards[i].lock, NULL) != 0) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(create_shardset()): Failed to create shard %zu.\n",
+                    i);
+            delete_tree(shards[i].tree);
+            delete_shardset(set);
+            return NULL;
+        }
+
+        set->count++;
+    }
+
+    BST_LOG(BST_LOG_INFO,
+            "INFO(create_shardset()): Successfully created a set of %zu "
+            "Temp/Humidity trees.\n", shard_count);
+
+    return set;
+}
+
+
+
+bool shardset_insert(ShardSet_t* set, uint32_t sensor_id, Data_t info) {
+    if (set == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(shardset_insert()): Cannot insert into NULL set.\n");
+        return false;
+    }
+
+    Shard_t* shard = &set->shards[shard_index(set, sensor_id, info.timestamp)];
+
+    pthread_mutex_lock(&shard->lock);
+    bool added = (insert(shard->tree, info) != NULL);
+    pthread_mutex_unlock(&shard->lock);
+
+    return added;
+}
+
+
+
+size_t shardset_range(ShardSet_t* set, time_t t_begin, time_t t_end,
+                      Visit_t visit, void* context) {
+    if (set == NULL || visit == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(shardset_range()): Invalid set or visit callback.\n");
+        return 0;
+    }
+
+    if (t_begin > t_end) {
+        return 0;
+    }
+
+    Cursor_t* cursors = (Cursor_t*)malloc(set->count * sizeof(Cursor_t));
+    size_t* heap = (size_t*)malloc(set->count * sizeof(size_t));
+
+    if (cursors == NULL || heap == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(shardset_range()): Failed to allocate cursors.\n");
+        free(cursors);
+        free(heap);
+        return 0;
+    }
+
+    // Locks every shard in index order and seeks its cursor to t_begin
+    size_t size = 0;
+
+    for (size_t i = 0; i < set->count; i++) {
+        pthread_mutex_lock(&set->shards[i].lock);
+
+        tree_iter_seek(&cursors[i].iter, set->shards[i].tree, t_begin);
+        cursors[i].head = tree_iter_next(&cursors[i].iter);
+
+        if (cursors[i].head != NULL && cursors[i].head->timestamp <= t_end) {
+            heap[size++] = i;
+        }
+    }
+
+    for (size_t slot = size / 2; slot-- > 0; ) {
+        sift_down(cursors, heap, size, slot);
+    }
+
+    // Repeatedly takes the oldest head, then advances that shard's cursor
+    size_t visited = 0;
+
+    while (size > 0) {
+        Cursor_t* cursor = &cursors[heap[0]];
+
+        visited++;
+        if (!visit(cursor->head, context)) {
+            break;
+        }
+
+        cursor->head = tree_iter_next(&cursor->iter);
+
+        if (cursor->head == NULL || cursor->head->timestamp > t_end) {
+            heap[0] = heap[--size];
+        }
+
+        sift_down(cursors, heap, size, 0);
+    }
+
+    for (size_t i = set->count; i-- > 0; ) {
+        pthread_mutex_unlock(&set->shards[i].lock);
+    }
+
+    free(cursors);
+    free(heap);
+
+    return visited;
+}
+
+
+
+Summary_t shardset_aggregate(ShardSet_t* set, time_t t_begin, time_t t_end) {
+    Summary_t total = {0, 0, UINT32_MAX, 0, 0, UINT32_MAX, 0};
+
+    if (set == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(shardset_aggregate()): Cannot summarize NULL set.\n");
+        return total;
+    }
+
+    for (size_t i = 0; i < set->count; i++) {
+        pthread_mutex_lock(&set->shards[i].lock);
+        Summary_t part = aggregate_range(set->shards[i].tree, t_begin, t_end);
+        pthread_mutex_unlock(&set->shards[i].lock);
+
+        summary_merge(&total, &part);
+    }
+
+    return total;
+}
+
+
+
+size_t shardset_count(ShardSet_t* set) {
+    size_t count = 0;
+
+    if (set == NULL) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < set->count; i++) {
+        pthread_mutex_lock(&set->shards[i].lock);
+        count += (size_t)set->shards[i].tree->node_count;
+        pthread_mutex_unlock(&set->shards[i].lock);
+    }
+
+    return count;
+}
+
+
+
+void delete_shardset(ShardSet_t* set) {
+    if (set == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < set->count; i++) {
+        pthread_mutex_destroy(&set->shards[i].lock);
+        delete_tree(set->shards[i].tree);
+    }
+
+    free(set->shards);
+    free(set);
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * shard_index() - picks the shard for a sensor's reading
+ *
+ * @param set         Set the reading belongs to
+ * @param sensor_id   Sensor the reading came from
+ * @param timestamp   Time of the reading, only its bucket is used
+ * @return            Index of the shard
+ *
+ * Mixes the sensor id with the time bucket and scrambles the result, so
+ * sensors that are numbered consecutively still spread over every shard.
+ */
+static size_t shard_index(const ShardSet_t* set, uint32_t sensor_id,
+                          time_t timestamp) {
+    uint64_t key = sensor_id;
+
+    if (set->bucket_seconds > 0) {
+        key = key * 0x9E3779B97F4A7C15ULL +
+              (uint64_t)(timestamp / set->bucket_seconds);
+    }
+
+    // 64-bit finalizer from MurmurHash3
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+
+    return (size_t)(key % set->count);
+}
+
+
+
+/**
+ * sift_down() - restores the heap order below a slot of the cursor heap
+ *
+ * @param cursors   Cursors the heap entries refer to
+ * @param heap      Min-heap of cursor indices, ordered by head timestamp
+ * @param size      Number of entries in the heap
+ * @param slot      Slot whose entry may be later than its children's
+ */
+static void sift_down(const Cursor_t* cursors, size_t* heap, size_t size,
+                      size_t slot) {
+    while (2 * slot + 1 < size) {
+        size_t child = 2 * slot + 1;
+
+        if (child + 1 < size &&
+            cursors[heap[child + 1]].head->timestamp <
+            cursors[heap[child]].head->timestamp) {
+            child++;
+        }
+
+        if (cursors[heap[slot]].head->timestamp <=
+            cursors[heap[child]].head->timestamp) {
+            return;
+        }
+
+        size_t swap = heap[slot];
+        heap[slot] = heap[child];
+        heap[child] = swap;
+        slot = child;
+    }
+}
+
+
+
+/**
+ * summary_merge() - adds one shard's summary into a running total
+ *
+ * @param total   Summary to add to
+ * @param part    Summary to add, may be empty
+ */
+static void summary_merge(Summary_t* total, const Summary_t* part) {
+    total->count += part->count;
+    total->temp_sum += part->temp_sum;
+    total->humid_sum += part->humid_sum;
+
+    if (part->temp_min < total->temp_min) {
+        total->temp_min = part->temp_min;
+    }
+    if (part->temp_max > total->temp_max) {
+        total->temp_max = part->temp_max;
+    }
+    if (part->humid_min < total->humid_min) {
+        total->humid_min = part->humid_min;
+    }
+    if (part->humid_max > total->humid_max) {
+        total->humid_max = part->humid_max;
+    }
+}
@@ -0,0 +1,142 @@
+/**
+ * @file        temp_humid_shard.h
+ * @brief
+ * Defines a sharded set of Temp/Humidity trees for ingesting many sensors
+ * from many collector threads at once. Each reading goes to one shard chosen
+ * from its sensor id and time bucket, and every shard is an ordinary Tree_t
+ * behind its own mutex. Collectors writing to different shards never wait on
+ * each other, so ingest scales with the number of cores instead of queueing
+ * behind one root.
+ *
+ * Readings carry no sensor id, so a shard can hold several sensors' readings
+ * with the same timestamp. Queries therefore fan out to every shard and
+ * merge the results back into timestamp order, a point lookup being a range
+ * of one timestamp.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef TEMP_HUMID_SHARD_H
+#define TEMP_HUMID_SHARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include "temp_humid_bst.h"
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Most shards a set can have
+#define SHARD_MAX_COUNT 256
+
+
+// Defines one shard, a tree and the lock that guards it
+typedef struct temperature_humidity_shard {
+    pthread_mutex_t lock;   // Held for every access to tree
+    Tree_t* tree;           // Readings routed to this shard
+} Shard_t;
+
+
+
+// Defines the sharded Temp/Humidity tree set
+typedef struct temperature_humidity_shard_set {
+    Shard_t* shards;        // The shards themselves
+    size_t count;           // Number of shards
+    time_t bucket_seconds;  // Width of a time bucket, 0 to shard by sensor only
+} ShardSet_t;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * create_shardset() - creates an empty sharded Temp/Humidity tree set
+ *
+ * @param	shard_count		number of shards, 1 to SHARD_MAX_COUNT.  A few
+ *							times the number of collector threads keeps
+ *							collisions rare
+ * @param	bucket_seconds	width of the time buckets mixed into the shard
+ *							choice, e.g. 3600.  0 routes by sensor id only
+ * @return					a pointer to the new set if succeeds.  NULL if it
+ *							fails
+ */
+ShardSet_t* create_shardset(size_t shard_count, time_t bucket_seconds);
+
+
+
+/**
+ * shardset_insert() - inserts a reading from one sensor into its shard
+ *
+ * @param	set			pointer to the set to add the reading to
+ * @param	sensor_id	sensor the reading came from
+ * @param	info		Temp/Humid reading to add
+ * @return				true if the reading was added, false if it fails
+ *
+ * @note Safe to call from any number of threads. Only the chosen shard is
+ * locked.
+ */
+bool shardset_insert(ShardSet_t* set, uint32_t sensor_id, Data_t info);
+
+
+
+/**
+ * shardset_range() - visits every reading in [t_begin, t_end] from every
+ *                    shard, merged into timestamp order
+ *
+ * @param	set			pointer to the set to search
+ * @param	t_begin		first timestamp of the range (inclusive)
+ * @param	t_end		last timestamp of the range (inclusive)
+ * @param	visit		callback called once per reading in the range
+ * @param	context		caller data passed through to visit
+ * @return				number of readings visited
+ *
+ * @note Each shard is walked with a cursor seeked to t_begin and the cursors
+ * are merged through a heap, so the cost is O(s log n + k log s) for s
+ * shards and k readings. Every shard is locked while visit runs, so keep it
+ * short or copy the readings out.
+ */
+size_t shardset_range(ShardSet_t* set, time_t t_begin, time_t t_end,
+                      Visit_t visit, void* context);
+
+
+
+/**
+ * shardset_aggregate() - summarizes the readings in [t_begin, t_end] across
+ *                        every shard
+ *
+ * @param	set			pointer to the set to summarize
+ * @param	t_begin		first timestamp of the range (inclusive)
+ * @param	t_end		last timestamp of the range (inclusive)
+ * @return				count, sums, minimums and maximums of the readings
+ *
+ * @note Calls aggregate_range() on one shard at a time, so inserts into
+ * other shards carry on meanwhile.
+ */
+Summary_t shardset_aggregate(ShardSet_t* set, time_t t_begin, time_t t_end);
+
+
+
+/**
+ * shardset_count() - returns the number of readings in every shard
+ *
+ * @param	set		pointer to the set
+ */
+size_t shardset_count(ShardSet_t* set);
+
+
+
+/**
+ * delete_shardset() - frees every shard and the set itself
+ *
+ * @param	set		pointer to the set to free.  No other thread may be using it
+ */
+void delete_shardset(ShardSet_t* set);
+
+
+
+#endif
@@ -0,0 +1,577 @@
+/**
+ * @file        temp_humid_wal.c
+ * @brief
+ * Implements the write-ahead log defined in temp_humid_wal.h.
+ *
+ * The file starts with a 16 byte header (magic, version, byte order). Each
+ * record is 20 bytes: the timestamp as 8 bytes, temperature and humidity as
+ * 4 bytes each, then a 4 byte FNV-1a checksum of those 16 bytes. Values are
+ * stored in the writer's byte order, which the header records.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "temp_humid_wal.h"
+#include "bst_log.h"
+
+
+
+/******************************** Definitions *********************************/
+
+// Written as a number and read back to detect a log from another byte order
+#define WAL_BYTE_ORDER      0x01020304u
+
+// Records read per read() call during replay
+#define WAL_READ_RECORDS    4096
+
+
+
+/************************ Helper Function Prototypes **************************/
+
+static void encode_record(unsigned char* record, const Data_t* info);
+static bool decode_record(const unsigned char* record, Data_t* info);
+static uint32_t checksum(const unsigned char* bytes, size_t length);
+static int64_t monotonic_ms(void);
+static bool write_all(int fd, const unsigned char* bytes, size_t length);
+static bool read_header(int fd);
+static bool commit_locked(Wal_t* wal);
+static void* flush_thread(void* context);
+
+
+
+/************************ API Function Implementations ************************/
+
+Wal_t* wal_open(const char* path, size_t batch_records, long batch_ms) {
+    if (path == NULL || batch_records == 0 || batch_ms < 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_open()): Invalid path or batch limits.\n");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    struct stat info;
+
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_open()): Cannot open log %s.\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    // A new log gets a header, an existing one must already have one
+    bool ready;
+
+    if (info.st_size == 0) {
+        unsigned char header[WAL_HEADER_SIZE];
+        uint32_t version = WAL_VERSION;
+        uint32_t byte_order = WAL_BYTE_ORDER;
+
+        memcpy(header, WAL_MAGIC, 8);
+        memcpy(header + 8, &version, 4);
+        memcpy(header + 12, &byte_order, 4);
+        ready = write_all(fd, header, sizeof(header)) && fsync(fd) == 0;
+    }
+    else {
+        ready = read_header(fd);
+    }
+
+    Wal_t* wal = ready ? (Wal_t*)malloc(sizeof(Wal_t)) : NULL;
+    unsigned char* buffer = ready ? (unsigned char*)malloc(batch_records *
+                                                           WAL_RECORD_SIZE)
+                                  : NULL;
+
+    if (wal == NULL || buffer == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_open()): Cannot use %s as a log.\n", path);
+        free(wal);
+        free(buffer);
+        close(fd);
+        return NULL;
+    }
+
+    wal->fd = fd;
+    wal->buffer = buffer;
+    wal->pending = 0;
+    wal->committed = lseek(fd, 0, SEEK_END);
+    wal->batch_records = batch_records;
+    wal->batch_ms = batch_ms;
+    wal->commits = 0;
+    wal->flushing = false;
+    wal->closing = false;
+
+    // The flusher waits on the monotonic clock, like first_pending
+    pthread_condattr_t attr;
+    bool synced = (pthread_condattr_init(&attr) == 0);
+
+    synced = synced &&
+             pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0 &&
+             pthread_cond_init(&wal->wake, &attr) == 0;
+    if (synced && pthread_mutex_init(&wal->lock, NULL) != 0) {
+        pthread_cond_destroy(&wal->wake);
+        synced = false;
+    }
+    pthread_condattr_destroy(&attr);
+
+    if (synced && batch_ms > 0) {
+        wal->flushing = (pthread_create(&wal->flusher, NULL, flush_thread,
+                                        wal) == 0);
+        if (!wal->flushing) {
+            pthread_mutex_destroy(&wal->lock);
+            pthread_cond_destroy(&wal->wake);
+            synced = false;
+        }
+    }
+
+    if (!synced) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_open()): Cannot start committing to %s.\n", path);
+        free(wal);
+        free(buffer);
+        close(fd);
+        return NULL;
+    }
+
+    BST_LOG(BST_LOG_INFO,
+            "INFO(wal_open()): Logging to %s, %zu records or %ld ms per "
+            "commit.\n", path, batch_records, batch_ms);
+
+    return wal;
+}
+
+
+
+bool wal_append(Wal_t* wal, const Data_t* info) {
+    if (wal == NULL || info == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_append()): Invalid log or reading.\n");
+        return false;
+    }
+
+    bool logged = true;
+
+    pthread_mutex_lock(&wal->lock);
+
+    // A new group starts the flusher's clock
+    if (wal->pending == 0) {
+        wal->first_pending = monotonic_ms();
+        pthread_cond_signal(&wal->wake);
+    }
+
+    encode_record(wal->buffer + wal->pending * WAL_RECORD_SIZE, info);
+    wal->pending++;
+
+    if (wal->pending == wal->batch_records ||
+        (wal->batch_ms > 0 && 
+         monotonic_ms() - wal->first_pending >= wal->batch_ms)) {
+        // The caller is told this reading failed, so it must not be
+        // committed later. Earlier ones stay pending for the next try
+        if (!commit_locked(wal)) {
+            wal->pending--;
+            logged = false;
+        }
+    }
+
+    pthread_mutex_unlock(&wal->lock);
+
+    return logged;
+}
+
+
+
+bool wal_commit(Wal_t* wal) {
+    if (wal == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_commit()): Cannot commit NULL log.\n");
+        return false;
+    }
+
+    pthread_mutex_lock(&wal->lock);
+
+    bool committed = commit_locked(wal);
+
+    pthread_mutex_unlock(&wal->lock);
+
+    return committed;
+}
+
+
+
+bool wal_close(Wal_t* wal) {
+    if (wal == NULL) {
+        return false;
+    }
+
+    // The flusher exits without committing, the last commit is done here
+    if (wal->flushing) {
+        pthread_mutex_lock(&wal->lock);
+        wal->closing = true;
+        pthread_cond_signal(&wal->wake);
+        pthread_mutex_unlock(&wal->lock);
+        pthread_join(wal->flusher, NULL);
+    }
+
+    bool committed = wal_commit(wal);
+
+    pthread_mutex_destroy(&wal->lock);
+    pthread_cond_destroy(&wal->wake);
+    close(wal->fd);
+    free(wal->buffer);
+    free(wal);
+
+    return committed;
+}
+
+
+
+bool wal_checkpoint(Wal_t* wal) {
+    if (wal == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_checkpoint()): Cannot checkpoint NULL log.\n");
+        return false;
+    }
+
+    pthread_mutex_lock(&wal->lock);
+
+    bool emptied = (ftruncate(wal->fd, WAL_HEADER_SIZE) == 0 &&
+                    fsync(wal->fd) == 0);
+
+    if (emptied) {
+        wal->pending = 0;
+        wal->committed = WAL_HEADER_SIZE;
+    }
+    else {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_checkpoint()): Failed to empty the log.\n");
+    }
+
+    pthread_mutex_unlock(&wal->lock);
+
+    return emptied;
+}
+
+
+
+void tree_attach_wal(Tree_t* tree, Wal_t* wal) {
+    if (tree == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(tree_attach_wal()): Cannot log NULL tree.\n");
+        return;
+    }
+
+    tree->wal = wal;
+}
+
+
+
+Tree_t* wal_replay(const char* path) {
+    if (path == NULL) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_replay()): Cannot replay NULL path.\n");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDWR);
+
+    if (fd < 0 || !read_header(fd)) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_replay()): Cannot replay %s.\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+
+    unsigned char* chunk = (unsigned char*)malloc(WAL_READ_RECORDS *
+                                                  WAL_RECORD_SIZE);
+    size_t capacity = WAL_READ_RECORDS;
+    size_t count = 0;
+    Data_t* readings = (Data_t*)malloc(capacity * sizeof(Data_t));
+    bool torn = false;
+    size_t carried = 0;
+    ssize_t got = 0;
+
+    // Reads whole chunks, carrying a partial record over to the next read
+    while (chunk != NULL && readings != NULL && !torn &&
+           (got = read(fd, chunk + carried,
+                       WAL_READ_RECORDS * WAL_RECORD_SIZE - carried)) > 0) {
+        size_t length = carried + (size_t)got;
+        size_t records = length / WAL_RECORD_SIZE;
+
+        if (count + records > capacity) {
+            capacity = 2 * (count + records);
+            Data_t* grown = (Data_t*)realloc(readings,
+                                             capacity * sizeof(Data_t));
+            if (grown == NULL) {
+                free(readings);
+                readings = NULL;
+                break;
+            }
+
+            readings = grown;
+        }
+
+        for (size_t i = 0; i < records && !torn; i++) {
+            torn = !decode_record(chunk + i * WAL_RECORD_SIZE, 
+                                  &readings[count]);
+            count += !torn;
+        }
+
+        carried = length - records * WAL_RECORD_SIZE;
+        memmove(chunk, chunk + records * WAL_RECORD_SIZE, carried);
+    }
+
+    bool failed = (chunk == NULL || readings == NULL || got < 0);
+
+    free(chunk);
+
+    if (failed) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_replay()): Failed to read %s.\n", path);
+        free(readings);
+        close(fd);
+        return NULL;
+    }
+
+    // Anything after the last good record was torn by a crash
+    off_t valid = WAL_HEADER_SIZE + (off_t)count * WAL_RECORD_SIZE;
+
+    if (lseek(fd, 0, SEEK_END) > valid) {
+        BST_LOG(BST_LOG_INFO,
+                "INFO(wal_replay()): Removing torn tail of %s after %zu "
+                "records.\n", path, count);
+
+        if (ftruncate(fd, valid) != 0 || fsync(fd) != 0) {
+            BST_LOG(BST_LOG_ERROR,
+                    "ERROR(wal_replay()): Failed to truncate %s.\n", path);
+        }
+    }
+
+    close(fd);
+
+    Tree_t* tree = build_tree(readings, count);
+
+    free(readings);
+
+    if (tree != NULL) {
+        BST_LOG(BST_LOG_INFO,
+                "INFO(wal_replay()): Replayed %zu readings from %s.\n",
+                count, path);
+    }
+
+    return tree;
+}
+
+
+
+/****************************** Helper Functions ******************************/
+
+/**
+ * commit_locked() - wal_commit() for a caller holding the log's lock
+ */
+static bool commit_locked(Wal_t* wal) {
+    if (wal->pending == 0) {
+        return true;
+    }
+
+    // A failed commit whose cleanup also failed left part of a group behind
+    if (lseek(wal->fd, 0, SEEK_END) != wal->committed &&
+        ftruncate(wal->fd, wal->committed) != 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_commit()): Cannot remove a partial commit.\n");
+        return false;
+    }
+
+    // One write and one sync cover the whole group
+    size_t length = wal->pending * WAL_RECORD_SIZE;
+
+    if (!write_all(wal->fd, wal->buffer, length) || fsync(wal->fd) != 0) {
+        BST_LOG(BST_LOG_ERROR,
+                "ERROR(wal_commit()): Failed to commit %zu records.\n",
+                wal->pending);
+
+        // Records after a partial group would be cut off by wal_replay()
+        ftruncate(wal->fd, wal->committed);
+        return false;
+    }
+
+    wal->committed += (off_t)length;
+    wal->pending = 0;
+    wal->commits++;
+
+    return true;
+}
+
+
+
+/**
+ * flush_thread() - commits each group once its oldest record has waited
+ *                  batch_ms, so a quiet log does not hold records unsynced
+ *
+ * @param context   Log to commit
+ */
+static void* flush_thread(void* context) {
+    Wal_t* wal = (Wal_t*)context;
+
+    pthread_mutex_lock(&wal->lock);
+
+    while (!wal->closing) {
+        if (wal->pending == 0) {
+            pthread_cond_wait(&wal->wake, &wal->lock);
+            continue;
+        }
+
+        int64_t due = wal->first_pending + wal->batch_ms;
+
+        if (monotonic_ms() < due) {
+            struct timespec until = {(time_t)(due / 1000),
+                                     (long)(due % 1000) * 1000000};
+
+            pthread_cond_timedwait(&wal->wake, &wal->lock, &until);
+        }
+        else if (!commit_locked(wal)) {
+            // Tries again after another batch_ms instead of spinning
+            wal->first_pending = monotonic_ms();
+        }
+    }
+
+    pthread_mutex_unlock(&wal->lock);
+
+    return NULL;
+}
+
+
+
+/**
+ * encode_record() - packs a reading and its checksum into a record
+ *
+ * @param record   WAL_RECORD_SIZE bytes to fill
+ * @param info     Reading to pack
+ */
+static void encode_record(unsigned char* record, const Data_t* info) {
+    int64_t timestamp = (int64_t)info->timestamp;
+    uint32_t sum;
+
+    memcpy(record, &timestamp, 8);
+    memcpy(record + 8, &info->temp, 4);
+    memcpy(record + 12, &info->humid, 4);
+
+    sum = checksum(record, 16);
+    memcpy(record + 16, &sum, 4);
+}
+
+
+
+/**
+ * decode_record() - unpacks a record, checking its checksum
+ *
+ * @param record   WAL_RECORD_SIZE bytes read from the log
+ * @param info     Filled with the reading
+ * @return         true if the checksum matches
+ */
+static bool decode_record(const unsigned char* record, Data_t* info) {
+    int64_t timestamp;
+    uint32_t sum;
+
+    memcpy(&sum, record + 16, 4);
+
+    if (sum != checksum(record, 16)) {
+        return false;
+    }
+
+    memcpy(&timestamp, record, 8);
+    memcpy(&info->temp, record + 8, 4);
+    memcpy(&info->humid, record + 12, 4);
+    info->timestamp = (time_t)timestamp;
+
+    return true;
+}
+
+
+
+/**
+ * checksum() - 32-bit FNV-1a hash of a record's payload
+ */
+static uint32_t checksum(const unsigned char* bytes, size_t length) {
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+
+
+/**
+ * monotonic_ms() - returns a monotonic time stamp in milliseconds
+ */
+static int64_t monotonic_ms(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+
+
+/**
+ * write_all() - writes a whole buffer, retrying short writes
+ *
+ * @return   true if every byte was written
+ */
+static bool write_all(int fd, const unsigned char* bytes, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, bytes, length);
+
+        if (written <= 0) {
+            return false;
+        }
+
+        bytes += written;
+        length -= (size_t)written;
+    }
+
+    return true;
+}
+
+
+
+/**
+ * read_header() - reads and checks the header at the start of a log
+ *
+ * @param fd   Log file, positioned at its start
+ * @return     true if the header is one this build wrote
+ */
+static bool read_header(int fd) {
+    unsigned char header[WAL_HEADER_SIZE];
+    uint32_t version;
+    uint32_t byte_order;
+
+    if (lseek(fd, 0, SEEK_SET) != 0 ||
+        read(fd, header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        return false;
+    }
+
+    memcpy(&version, header + 8, 4);
+    memcpy(&byte_order, header + 12, 4);
+
+    // The read leaves the file positioned at the first record for replay
+    return memcmp(header, WAL_MAGIC, 8) == 0 &&
+           version == WAL_VERSION &&
+           byte_order == WAL_BYTE_ORDER;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file        temp_humid_wal.h
+ * @brief
+ * Defines an append-only write-ahead log (WAL) for Temp/Humidity readings.
+ * With a log attached to a tree, insert() appends each reading to the log
+ * before adding it to the tree, so the readings survive the process dying
+ * once their group has been committed.
+ *
+ * Records are buffered and committed in groups, one write() and one fsync()
+ * per batch of N records or T milliseconds, whichever comes first, so
+ * durability does not cost a system call per reading. On startup
+ * wal_replay() reads the log back and bulk loads a tree from it.
+ *
+ * tree_save() on a tree with a log checkpoints it: once the snapshot holds
+ * every logged reading the log is emptied, so it only grows between
+ * snapshots. tree_recover() (temp_humid_frozen.h) then loads the snapshot and
+ * the readings logged since.
+ *
+ * @version     1.0.0
+ * @author      Danny V. Restrepo (restrepo@pdx.edu)
+ * @date        06-Dec-2024
+ */
+
+#ifndef TEMP_HUMID_WAL_H
+#define TEMP_HUMID_WAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include "temp_humid_bst.h"
+
+
+/*********************** Definitions, Typedefs, Structs ************************/
+
+// Identifies a log file and the record format it was written with
+#define WAL_MAGIC           "THBSTWAL"
+#define WAL_VERSION         1
+
+// Bytes in the file header and in each record
+#define WAL_HEADER_SIZE     16
+#define WAL_RECORD_SIZE     20
+
+
+// Defines an open write-ahead log
+typedef struct temperature_humidity_wal {
+    int fd;                     // Log file, opened for appending
+    unsigned char* buffer;      // Records not yet written
+    size_t pending;             // Number of records in buffer
+    off_t committed;            // File length up to the last commit
+    size_t batch_records;       // Commit once this many records are pending
+    long batch_ms;              // Commit once the oldest pending is this old
+    int64_t first_pending;      // Monotonic ms when the oldest pending came
+    uint64_t commits;           // Number of group commits (fsyncs) done
+    pthread_mutex_t lock;       // Guards the fields above
+    pthread_cond_t wake;        // Tells the flusher a group has started
+    pthread_t flusher;          // Commits groups that wait batch_ms
+    bool flushing;              // true if the flusher was started
+    bool closing;               // Tells the flusher to exit
+} Wal_t;
+
+
+
+/************************** API Function Prototypes ***************************/
+
+/**
+ * wal_open() - opens a log for appending, creating it if needed
+ *
+ * @param	path			log file to append to
+ * @param	batch_records	records per group commit, at least 1
+ * @param	batch_ms		longest a record waits for its commit, in
+ *							milliseconds, enforced by a flusher thread even
+ *							if no more records arrive.  0 to commit only on
+ *							batch_records
+ * @return					a pointer to the open log if succeeds.  NULL if
+ *							it fails or the file is not a log
+ *
+ * @note Run wal_replay() on an existing log first, it also cuts off a
+ * record left half written by a crash so that new records follow whole ones.
+ */
+Wal_t* wal_open(const char* path, size_t batch_records, long batch_ms);
+
+
+
+/**
+ * wal_append() - adds a reading to the log
+ *
+ * @param	wal		pointer to the open log
+ * @param	info	Temp/Humid reading to log
+ * @return			true if succeeds, false if a commit it triggered failed
+ *
+ * @note The reading is durable once its group commit returns, at the latest
+ * batch_ms after the group started.
+ */
+bool wal_append(Wal_t* wal, const Data_t* info);
+
+
+
+/**
+ * wal_commit() - writes every pending record and syncs the log to disk
+ *
+ * @param	wal		pointer to the open log
+ * @return			true if succeeds, false if it fails
+ *
+ * @note On failure the file is cut back to its length after the last commit
+ * and every record stays pending, so the next commit writes them again after
+ * whole records instead of after a partial write.
+ */
+bool wal_commit(Wal_t* wal);
+
+
+
+/**
+ * wal_close() - commits pending records and closes the log
+ *
+ * @param	wal		pointer to the log to close
+ * @return			true if the final commit succeeded
+ */
+bool wal_close(Wal_t* wal);
+
+
+
+/**
+ * wal_checkpoint() - empties the log once its readings are safe elsewhere
+ *
+ * @param	wal		pointer to the open log
+ * @return			true if the log was cut back to its header and synced
+ *
+ * @note Pending records are dropped, not committed. Call it only once every
+ * reading in the log is durable in a snapshot, as tree_save() does.
+ */
+bool wal_checkpoint(Wal_t* wal);
+
+
+
+/**
+ * tree_attach_wal() - makes every insert() into a tree log its reading first
+ *
+ * @param	tree	pointer to the TempHumidtree to log
+ * @param	wal		pointer to an open log, NULL to stop logging.  The caller
+ *					still owns the log and closes it after the tree is done
+ *
+ * @note insert() fails, leaving the tree unchanged, if logging the reading
+ * fails. delete_node() and delete_before() are not logged, so a reading
+ * deleted since the last checkpoint comes back on replay. Saving a snapshot
+ * after trimming makes the deletion durable.
+ */
+void tree_attach_wal(Tree_t* tree, Wal_t* wal);
+
+
+
+/**
+ * wal_replay() - rebuilds a tree from the readings in a log
+ *
+ * @param	path	log file to read
+ * @return			a pointer to a new balanced tree holding every whole
+ *					record, or NULL if the log cannot be read
+ *
+ * @note The readings are sorted and bulk loaded with build_tree(). Replay
+ * stops at the first record that is cut short or fails its checksum, and
+ * that tail is removed from the file.
+ */
+Tree_t* wal_replay(const char* path);
+
+
+
+#endif
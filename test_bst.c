@@ -11,26 +11,167 @@
  * @date        06-Dec-2024
  */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include "bst_log.h"
 #include "temp_humid_bst.h"
+#include "temp_humid_wal.h"
+#include "temp_humid_frozen.h"
+#include "temp_humid_cols.h"
+#include "temp_humid_shard.h"
+#include "temp_humid_ingest.h"
+#include "temp_humid_export.h"
+#include "temp_humid_archive.h"
+#include "temp_humid_compact.h"
 #include "iom361_r2.h"
+#include "float_rndm.h"
+#include "rndm_engine.h"
 
 
 
 /**************************** Function Prototypes *****************************/
 
 static void greeting(void);
+static void check(bool condition, const char* message);
 static void test_error_conditions(void);
+static void test_sorted_insert_balance(void);
+static void test_bulk_load(void);
+static void test_freeze(void);
+static void test_search_range(void);
+static bool collect_reading(const Data_t* reading, void* context);
+static void test_iterator(void);
+static void test_search_many(void);
+static void test_search_neighbours(void);
+static void test_colstore(void);
+static int validate_subtree(const Node_t* node, time_t low, time_t high);
+static void test_delete(void);
+static void test_aggregate_range(void);
+static void* shared_reader(void* context);
+static void test_shared_tree(void);
+static void* collector(void* context);
+static bool check_order(const Data_t* reading, void* context);
+static bool mark_sensor(const Data_t* reading, void* context);
+static void test_shardset(void);
+static void test_snapshot(void);
+static void test_wal(void);
+static Tree_t* ingest_bytes(const void* bytes, size_t length,
+                            IngestFormat_t format);
+static void* feed_pipe(void* context);
+static void test_ingest(void);
+static void test_export(void);
+static bool hash_reading(const Data_t* reading, void* context);
+static void test_archive(void);
+static int compact_height(const CompactTree_t* tree, uint32_t index);
+static void test_compact(void);
+static void* drive_board(void* context);
+static void test_boards(uint32_t* io_base);
+static void* update_sensor(void* context);
+static void test_sensor_pairs(void);
+static void* draw_floats(void* context);
+static void test_rndm(void);
+static void test_batch(void);
 static void build_test_tree(Tree_t* tree);
 static void search_test_cases(Tree_t* tree);
 static time_t create_timestamp(int month, int day, int year);
 
 
 
+/*********************** Definitions, Typedefs, Structs ************************/
+
+#define SHARD_TEST_THREADS  4       // Collector threads in the sharded test
+#define SHARD_TEST_SENSORS  3       // Sensors polled by each collector
+#define SHARD_TEST_READINGS 1000    // Readings per sensor
+#define BOARD_TEST_THREADS  4       // Emulated boards in the board test
+#define BOARD_TEST_ROUNDS   100000  // Sensor updates per board
+#define PAIR_TEST_READS     200000  // Pair reads while the sensor changes
+#define RNDM_TEST_THREADS   4       // Threads drawing from float_rndm
+#define RNDM_TEST_DRAWS     100000  // Draws per range and thread
+#define BATCH_TEST_READINGS 100003  // Readings per generated batch
+
+
+// Defines what a reader thread in the shared tree test needs to know
+typedef struct {
+    Tree_t* tree;           // Shared tree being searched
+    time_t start;           // Timestamp of the first reading inserted
+    const int* published;   // Number of readings the writer has inserted
+    const bool* done;       // Set once the writer has finished
+    int lookups;            // Number of searches made
+    int errors;             // Searches that found the wrong thing
+} Reader_t;
+
+
+
+// Defines one collector thread in the sharded set test
+typedef struct {
+    ShardSet_t* set;        // Set being inserted into
+    time_t start;           // Timestamp of each sensor's first reading
+    uint32_t first_sensor;  // First of the sensors this thread owns
+    int errors;             // Inserts that failed
+} Collector_t;
+
+
+
+// Defines one board driven by its own thread in the board test
+typedef struct {
+    iom361_t* board;        // Board owned by this thread
+    uint32_t id;            // Written to the board's reserved register
+    int errors;             // Reads that returned another board's values
+} Board_t;
+
+
+
+// Defines the sensor updater in the paired read test
+typedef struct {
+    iom361_t* board;        // Board whose sensor is updated
+    const bool* done;       // Set once the reader has finished
+    int updates;            // Number of updates made
+} Updater_t;
+
+
+
+// Defines one thread drawing from float_rand_in_range() in the PRNG test
+typedef struct {
+    double first;           // First value drawn
+    int errors;             // Values outside their range
+} Drawer_t;
+
+
+
+// Defines the bytes a writer thread pushes through a pipe
+typedef struct {
+    int fd;                 // Write end of the pipe, closed when done
+    const void* bytes;      // Bytes to write
+    size_t length;          // Number of bytes
+} Feeder_t;
+
+
+
+// Defines the state of a merged range walk being checked for order
+typedef struct {
+    time_t last;            // Timestamp of the previous reading
+    size_t count;           // Number of readings visited
+    bool sorted;            // False once a reading is out of order
+} Order_t;
+
+
+
+/****************************** Global Variables ******************************/
+
+static int failures = 0;    // Number of failed checks
+
+
+
 /************************************ Main ************************************/
 
 int main(void) {
@@ -51,6 +192,72 @@ int main(void) {
     // Tests all error conditions first
     test_error_conditions();
 
+    // Tests that sorted ingest keeps the tree balanced
+    test_sorted_insert_balance();
+
+    // Tests bulk loading from sorted and unsorted arrays
+    test_bulk_load();
+
+    // Tests the frozen Eytzinger index against the tree it was built from
+    test_freeze();
+
+    // Tests range queries over timestamps
+    test_search_range();
+
+    // Tests the non-printing in-order cursor
+    test_iterator();
+
+    // Tests batched lookups
+    test_search_many();
+
+    // Tests floor, ceiling and nearest searches
+    test_search_neighbours();
+
+    // Tests the columnar store backend
+    test_colstore();
+
+    // Tests single-node delete and retention eviction
+    test_delete();
+
+    // Tests range summaries
+    test_aggregate_range();
+
+    // Tests lock-free readers alongside a writer
+    test_shared_tree();
+
+    // Tests the sharded set with several collector threads
+    test_shardset();
+
+    // Tests saving and mapping snapshot files
+    test_snapshot();
+
+    // Tests write-ahead logging and replay
+    test_wal();
+
+    // Tests loading CSV and binary readings from a file
+    test_ingest();
+
+    // Tests that the export engine matches the printf() table
+    test_export();
+
+    // Tests compressing readings into archive blocks
+    test_archive();
+
+    // Tests the compact-node tree
+    test_compact();
+
+    // Tests several emulated boards driven from their own threads
+    test_boards(io_base);
+
+    // Tests that sensor pairs read during updates are never torn
+    test_sensor_pairs();
+
+    // Tests the random number generator and the float_rndm wrappers
+    test_rndm();
+
+    // Tests generating batches of sensor register values
+    test_batch();
+
     // Creates main test tree
     Tree_t* tree = create_tree();
 
@@ -71,9 +278,15 @@ int main(void) {
     printf("---------------------------\n");
     in_order(tree);
 
+    delete_tree(tree);
+
     printf("\n\nTemp & Humid BST ADT test program complete!\n\n");
 
-    return 0;
+    if (failures > 0) {
+        printf("%d check(s) FAILED\n", failures);
+    }
+
+    return (failures > 0) ? 1 : 0;
 }
 
 
@@ -106,6 +319,21 @@ static void greeting(void) {
 
 
 
+/**
+ * check() - Reports a failed check and counts it
+ *
+ * @param condition   Represents the result of the check
+ * @param message     Represents what was expected, printed on failure
+ */
+static void check(bool condition, const char* message) {
+    if (!condition) {
+        printf("ERROR: %s\n", message);
+        failures++;
+    }
+}
+
+
+
 /**
  * create_timestamp() - Creates Unix timestamp for given date
  *
@@ -168,6 +396,8 @@ static void test_error_conditions(void) {
         if (result != NULL) {
             printf("ERROR: Search with invalid timestamp should return NULL\n");
         }
+
+        delete_tree(test_tree);
     }
     
     printf("\nTest of error conditions complete!\n\n");
@@ -175,6 +405,2225 @@ static void test_error_conditions(void) {
 
 
 
+/**
+ * test_sorted_insert_balance() - Tests AVL balancing on sorted input
+ *
+ * Inserts readings in strictly increasing timestamp order, the order a live
+ * sensor delivers them, and verifies that the tree height stays within the
+ * AVL bound and every reading can still be found.
+ */
+static void test_sorted_insert_balance(void) {
+    printf("\nTest 3: Sorted insert keeps tree balanced\n");
+
+    Tree_t* tree = create_tree();
+    const int count = 4096;
+    time_t start = create_timestamp(1, 1, 2023);
+
+    for (int i = 0; i < count; i++) {
+        Data_t reading = {start + (time_t)i * 86400, i, count - i};
+        insert(tree, reading);
+    }
+
+    check(tree->node_count == count, "Sorted insert lost nodes");
+
+    // Slabs double from 64 nodes, 64 + 128 + ... + 2048 = 4032 so the last
+    // 64 nodes land in a 7th slab
+    int slab_count = 0;
+
+    for (Slab_t* slab = tree->slabs; slab != NULL; slab = slab->next) {
+        slab_count++;
+    }
+
+    check(slab_count == 7, "Nodes were not carved out of slabs");
+
+    // An AVL tree of 4096 nodes is at most 1.44 * log2(4096) = 17 high
+    check(tree->root->height <= 17, "Sorted insert produced a deep tree");
+
+    Node_t* node = tree->root;
+    time_t last = start + (time_t)(count - 1) * 86400;
+
+    while (node != NULL && node->data.timestamp != last) {
+        node = (last < node->data.timestamp) ? node->left : node->right;
+    }
+
+    check(node != NULL && node->data.temp == (uint32_t)(count - 1),
+          "Could not find last sorted reading");
+
+    delete_tree(tree);
+
+    printf("\nTest of sorted insert balance complete!\n");
+}
+
+
+
+/**
+ * test_bulk_load() - Tests building a tree from an array of readings
+ *
+ * Shuffles an array of readings, bulk loads it through the sort-then-build
+ * path and verifies that the result is perfectly balanced, sorted, and still
+ * accepts inserts. Also checks that unsorted input and more readings than a
+ * tree can count are rejected by build_tree_from_sorted().
+ */
+static void test_bulk_load(void) {
+    printf("\nTest 4: Bulk load from an array\n");
+
+    const int count = 1000;
+    Data_t* readings = malloc(count * sizeof(Data_t));
+    time_t start = create_timestamp(1, 1, 2023);
+
+    for (int i = 0; i < count; i++) {
+        readings[i].timestamp = start + (time_t)((i * 7) % count) * 86400;
+        readings[i].temp = (i * 7) % count;
+        readings[i].humid = 0;
+    }
+
+    Tree_t* tree = build_tree_from_sorted(readings, count);
+    check(tree == NULL, "Unsorted readings should be rejected");
+
+    // Refused before a single reading is looked at
+    check(build_tree_from_sorted(readings, (size_t)INT_MAX + 1) == NULL,
+          "More readings than node_count can hold should be rejected");
+
+    tree = build_tree(readings, count);
+    check(tree != NULL && tree->node_count == count,
+          "Bulk load lost readings");
+
+    // 1000 nodes fit in a perfectly balanced tree of height 10
+    check(tree->root->height == 10, "Bulk load is not perfectly balanced");
+    check(tree->slabs->nodes[0].data.temp == 0 &&
+          tree->slabs->nodes[count - 1].data.temp == (uint32_t)(count - 1),
+          "Bulk loaded nodes are not laid out in timestamp order");
+
+    Data_t late = {start + (time_t)count * 86400, 0, 0};
+    check(insert(tree, late) != NULL && tree->node_count == count + 1,
+          "Insert after bulk load failed");
+
+    delete_tree(tree);
+    free(readings);
+
+    printf("\nTest of bulk load complete!\n");
+}
+
+
+
+/**
+ * test_freeze() - Tests searching a frozen index
+ *
+ * Freezes trees of several sizes (including sizes that do not fill the last
+ * level) and verifies every stored timestamp is found with the right reading
+ * and that timestamps before, between and after the readings are not.
+ */
+static void test_freeze(void) {
+    printf("\nTest 5: Frozen index search\n");
+
+    time_t start = create_timestamp(1, 1, 2023);
+    int sizes[] = {0, 1, 2, 7, 8, 100, 1023};
+
+    for (int s = 0; s < sizeof(sizes)/sizeof(int); s++) {
+        int count = sizes[s];
+        Tree_t* tree = create_tree();
+
+        for (int i = 0; i < count; i++) {
+            Data_t reading = {start + (time_t)i * 86400, i, i + 1};
+            insert(tree, reading);
+        }
+
+        Frozen_t* frozen = freeze_tree(tree);
+        check(frozen != NULL && frozen->count == (size_t)count,
+              "Freeze lost readings");
+
+        for (int i = 0; i < count; i++) {
+            const Data_t* found = frozen_search(frozen, 
+                                                start + (time_t)i * 86400);
+
+            check(found != NULL && found->temp == (uint32_t)i && 
+                  found->humid == (uint32_t)(i + 1),
+                  "Frozen search missed a stored reading");
+            check(frozen_search(frozen, start + (time_t)i * 86400 + 1) == NULL,
+                  "Frozen search found a reading between timestamps");
+        }
+
+        check(frozen_search(frozen, start - 1) == NULL,
+              "Frozen search found a reading before the first");
+
+        delete_frozen(frozen);
+        delete_tree(tree);
+    }
+
+    printf("\nTest of frozen index complete!\n");
+}
+
+
+
+/**
+ * Holds the readings collected by collect_reading()
+ */
+typedef struct {
+    time_t timestamps[64];
+    int count;
+    int limit;
+} Collected_t;
+
+
+
+/**
+ * collect_reading() - search_range() callback that records timestamps
+ *
+ * @param reading   Reading being visited
+ * @param context   Collected_t to record the reading in
+ * @return          false once limit readings have been collected
+ */
+static bool collect_reading(const Data_t* reading, void* context) {
+    Collected_t* collected = (Collected_t*)context;
+
+    collected->timestamps[collected->count++] = reading->timestamp;
+
+    return collected->count < collected->limit;
+}
+
+
+
+/**
+ * test_search_range() - Tests range queries
+ *
+ * Verifies that a range visits exactly the readings inside it in timestamp
+ * order, that empty and reversed ranges visit nothing, and that the callback
+ * can stop the query early.
+ */
+static void test_search_range(void) {
+    printf("\nTest 6: Range search\n");
+
+    const int count = 100;
+    time_t start = create_timestamp(1, 1, 2023);
+    Tree_t* tree = create_tree();
+
+    for (int i = 0; i < count; i++) {
+        Data_t reading = {start + (time_t)((i * 37) % count) * 86400, 0, 0};
+        insert(tree, reading);
+    }
+
+    // Range boundaries fall between readings, days 10 through 19 are inside
+    Collected_t collected = {{0}, 0, 64};
+    size_t visited = search_range(tree, start + 9 * 86400 + 1,
+                                  start + 19 * 86400, collect_reading, 
+                                  &collected);
+
+    check(visited == 10 && collected.count == 10,
+          "Range search visited the wrong number of readings");
+
+    for (int i = 0; i < collected.count; i++) {
+        check(collected.timestamps[i] == start + (time_t)(10 + i) * 86400,
+              "Range search visited readings out of order");
+    }
+
+    collected.count = 0;
+    check(search_range(tree, start + 19 * 86400, start, collect_reading,
+                       &collected) == 0, "Reversed range should be empty");
+    check(search_range(tree, start - 86400, start - 1, collect_reading,
+                       &collected) == 0, "Range before data should be empty");
+
+    // Callback asks to stop after 3 readings
+    collected.limit = 3;
+    check(search_range(tree, start, start + 50 * 86400, collect_reading,
+                       &collected) == 3, "Range search did not stop early");
+
+    check(search_range(NULL, start, start, collect_reading, &collected) == 0,
+          "Range search on NULL tree should visit nothing");
+
+    delete_tree(tree);
+
+    printf("\nTest of range search complete!\n");
+}
+
+
+
+/**
+ * test_iterator() - Tests the in-order cursor
+ *
+ * Walks a tree built from out-of-order inserts and verifies every reading is
+ * returned exactly once in increasing timestamp order. Also checks that an
+ * empty tree and a finished cursor return nothing.
+ */
+static void test_iterator(void) {
+    printf("\nTest 7: In-order cursor\n");
+
+    const int count = 500;
+    time_t start = create_timestamp(1, 1, 2023);
+    Tree_t* tree = create_tree();
+    TreeIter_t iter;
+
+    tree_iter_begin(&iter, tree);
+    check(tree_iter_next(&iter) == NULL, "Cursor on empty tree returned data");
+
+    for (int i = 0; i < count; i++) {
+        Data_t reading = {start + (time_t)((i * 211) % count) * 86400, 0, 0};
+        insert(tree, reading);
+    }
+
+    const Data_t* reading;
+    int seen = 0;
+
+    tree_iter_begin(&iter, tree);
+
+    while ((reading = tree_iter_next(&iter)) != NULL) {
+        check(reading->timestamp == start + (time_t)seen * 86400,
+              "Cursor returned readings out of order");
+        seen++;
+    }
+
+    check(seen == count, "Cursor did not return every reading");
+    check(tree_iter_next(&iter) == NULL, "Finished cursor returned data");
+
+    tree_iter_begin(&iter, tree);
+    tree_iter_next(&iter);
+    tree_iter_end(&iter);
+    check(tree_iter_next(&iter) == NULL, "Ended cursor returned data");
+
+    delete_tree(tree);
+
+    printf("\nTest of in-order cursor complete!\n");
+}
+
+
+
+/**
+ * test_search_many() - Tests batched lookups
+ *
+ * Looks up a batch of unsorted keys, with duplicates and misses, and then the
+ * same batch sorted, verifying every result lines up with its key.
+ */
+static void test_search_many(void) {
+    printf("\nTest 8: Batched search\n");
+
+    const int count = 200;
+    const int batch = 300;
+    time_t start = create_timestamp(1, 1, 2023);
+    Tree_t* tree = create_tree();
+
+    for (int i = 0; i < count; i++) {
+        int day = (i * 71) % count;
+        Data_t reading = {start + (time_t)day * 86400, day, 0};
+        insert(tree, reading);
+    }
+
+    // Days 0 to 299 in scrambled order, days past 199 are not in the tree
+    time_t keys[300];
+    Node_t* results[300];
+
+    for (int i = 0; i < batch; i++) {
+        keys[i] = start + (time_t)((i * 97) % batch) * 86400;
+    }
+    keys[batch - 1] = keys[0];
+
+    for (int pass = 0; pass < 2; pass++) {
+        size_t found = search_many(tree, keys, batch, results);
+        int expected = 0;
+
+        for (int i = 0; i < batch; i++) {
+            int day = (int)((keys[i] - start) / 86400);
+
+            if (day < count) {
+                expected++;
+                check(results[i] != NULL && 
+                      results[i]->data.temp == (uint32_t)day,
+                      "Batched search returned the wrong node");
+            }
+            else {
+                check(results[i] == NULL, 
+                      "Batched search found a missing timestamp");
+            }
+        }
+
+        check(found == (size_t)expected, "Batched search miscounted");
+
+        // Second pass runs the already sorted path
+        for (int i = 0; i < batch; i++) {
+            keys[i] = start + (time_t)i * 86400;
+        }
+    }
+
+    check(search_many(NULL, keys, batch, results) == 0,
+          "Batched search on NULL tree should find nothing");
+
+    delete_tree(tree);
+
+    printf("\nTest of batched search complete!\n");
+}
+
+
+
+/**
+ * test_search_neighbours() - Tests floor, ceiling and nearest searches
+ *
+ * Uses readings every 10 days so queries can land exactly on a reading,
+ * between two readings, or outside the range of the tree.
+ */
+static void test_search_neighbours(void) {
+    printf("\nTest 9: Floor, ceiling and nearest search\n");
+
+    time_t start = create_timestamp(1, 1, 2023);
+    time_t step = 10 * 86400;
+    Tree_t* tree = create_tree();
+
+    check(search_nearest(tree, start) == NULL, 
+          "Nearest on empty tree should be NULL");
+
+    for (int i = 0; i < 50; i++) {
+        Data_t reading = {start + (time_t)((i * 13) % 50) * step, 0, 0};
+        insert(tree, reading);
+    }
+
+    time_t last = start + 49 * step;
+    Node_t* node;
+
+    node = search_floor(tree, start + 3 * step);
+    check(node != NULL && node->data.timestamp == start + 3 * step,
+          "Floor missed an exact match");
+    node = search_floor(tree, start + 3 * step + 1);
+    check(node != NULL && node->data.timestamp == start + 3 * step,
+          "Floor picked the wrong reading");
+    check(search_floor(tree, start - 1) == NULL,
+          "Floor before the first reading should be NULL");
+
+    node = search_ceil(tree, start + 3 * step - 1);
+    check(node != NULL && node->data.timestamp == start + 3 * step,
+          "Ceiling picked the wrong reading");
+    check(search_ceil(tree, last + 1) == NULL,
+          "Ceiling after the last reading should be NULL");
+
+    node = search_nearest(tree, start + 3 * step + step / 2 - 1);
+    check(node != NULL && node->data.timestamp == start + 3 * step,
+          "Nearest should round down below the midpoint");
+    node = search_nearest(tree, start + 3 * step + step / 2);
+    check(node != NULL && node->data.timestamp == start + 3 * step,
+          "Nearest should prefer the earlier reading on a tie");
+    node = search_nearest(tree, start + 3 * step + step / 2 + 1);
+    check(node != NULL && node->data.timestamp == start + 4 * step,
+          "Nearest should round up above the midpoint");
+    node = search_nearest(tree, last + 1000 * step);
+    check(node != NULL && node->data.timestamp == last,
+          "Nearest past the end should be the last reading");
+    node = search_nearest(tree, start - 1000 * step);
+    check(node != NULL && node->data.timestamp == start,
+          "Nearest before the start should be the first reading");
+
+    delete_tree(tree);
+
+    printf("\nTest of floor, ceiling and nearest search complete!\n");
+}
+
+
+
+/**
+ * test_colstore() - Tests the columnar store backend
+ *
+ * Appends readings in order, inserts a few out of order, and verifies that
+ * searches and range summaries agree with the values inserted. The summary
+ * range is long enough to exercise both the SSE2 loop and its scalar tail.
+ */
+static void test_colstore(void) {
+    printf("\nTest 10: Columnar store\n");
+
+    const int count = 103;
+    time_t start = create_timestamp(1, 1, 2023);
+    ColStore_t* store = create_colstore();
+
+    // Even days appended in order, then odd days inserted out of order
+    for (int day = 0; day < count; day += 2) {
+        Data_t reading = {start + (time_t)day * 86400, 1000 + day, 
+                          0xFFFFF000u + day};
+        check(colstore_insert(store, reading), "Column store append failed");
+    }
+
+    for (int day = count - 2; day > 0; day -= 2) {
+        Data_t reading = {start + (time_t)day * 86400, 1000 + day, 
+                          0xFFFFF000u + day};
+        check(colstore_insert(store, reading), "Column store insert failed");
+    }
+
+    check(store->count == (size_t)count, "Column store lost readings");
+
+    Data_t found;
+    bool ordered = true;
+
+    for (int day = 0; day < count; day++) {
+        ordered = ordered && 
+                  store->timestamps[day] == start + (time_t)day * 86400;
+
+        check(colstore_search(store, start + (time_t)day * 86400, &found) &&
+              found.temp == (uint32_t)(1000 + day),
+              "Column store search missed a reading");
+    }
+
+    check(ordered, "Column store is not sorted by timestamp");
+    check(!colstore_search(store, start + 1, &found),
+          "Column store found a missing timestamp");
+
+    // Days 3 through 97 inclusive
+    Summary_t summary = colstore_summarize(store, start + 3 * 86400 - 1,
+                                           start + 97 * 86400);
+    uint64_t temp_sum = 0;
+
+    for (int day = 3; day <= 97; day++) {
+        temp_sum += 1000 + day;
+    }
+
+    check(summary.count == 95, "Column store summary miscounted");
+    check(summary.temp_sum == temp_sum, "Column store temp sum is wrong");
+    check(summary.temp_min == 1003 && summary.temp_max == 1097,
+          "Column store temp range is wrong");
+    check(summary.humid_min == 0xFFFFF003u && summary.humid_max == 0xFFFFF061u,
+          "Column store humidity range is wrong");
+
+    summary = colstore_summarize(store, start - 10, start - 1);
+    check(summary.count == 0 && summary.temp_min > summary.temp_max,
+          "Empty column store summary should be empty");
+
+    delete_colstore(store);
+
+    printf("\nTest of columnar store complete!\n");
+}
+
+
+
+/**
+ * validate_subtree() - Checks the BST ordering and AVL balance of a subtree
+ *
+ * @param node   Root of the subtree
+ * @param low    Smallest timestamp allowed in the subtree
+ * @param high   Largest timestamp allowed in the subtree
+ * @return       Height of the subtree, or -1 if it is invalid
+ */
+static int validate_subtree(const Node_t* node, time_t low, time_t high) {
+    if (node == NULL) {
+        return 0;
+    }
+
+    if (node->data.timestamp < low || node->data.timestamp > high) {
+        return -1;
+    }
+
+    int left = validate_subtree(node->left, low, node->data.timestamp);
+    int right = validate_subtree(node->right, node->data.timestamp, high);
+
+    if (left < 0 || right < 0 || left - right > 1 || right - left > 1) {
+        return -1;
+    }
+
+    int height = 1 + ((left > right) ? left : right);
+
+    return (node->height == height) ? height : -1;
+}
+
+
+
+/**
+ * test_delete() - Tests single-node delete and retention eviction
+ *
+ * Deletes readings one at a time in scrambled order, then trims a tree with
+ * delete_before() and runs a rolling retention window, checking that the tree
+ * stays a valid AVL tree and that recycled nodes keep memory flat.
+ */
+static void test_delete(void) {
+    printf("\nTest 11: Delete and retention eviction\n");
+
+    const int count = 1000;
+    time_t start = create_timestamp(1, 1, 2023);
+    Tree_t* tree = create_tree();
+
+    for (int i = 0; i < count; i++) {
+        Data_t reading = {start + (time_t)((i * 379) % count) * 86400, 0, 0};
+        insert(tree, reading);
+    }
+
+    // Deletes every other day in scrambled order
+    for (int i = 0; i < count; i++) {
+        int day = (i * 577) % count;
+
+        if (day % 2 == 0) {
+            check(delete_node(tree, start + (time_t)day * 86400),
+                  "Delete missed a stored reading");
+        }
+    }
+
+    check(!delete_node(tree, start), "Delete removed a missing reading");
+    check(tree->node_count == count / 2, "Delete miscounted nodes");
+    check(validate_subtree(tree->root, 0, start + (time_t)count * 86400) > 0,
+          "Tree is not a valid AVL tree after deletes");
+
+    TreeIter_t iter;
+    const Data_t* reading;
+    int day = 1;
+
+    tree_iter_begin(&iter, tree);
+
+    while ((reading = tree_iter_next(&iter)) != NULL) {
+        check(reading->timestamp == start + (time_t)day * 86400,
+              "Delete removed the wrong readings");
+        day += 2;
+    }
+
+    // Drops days 1 to 299, which leaves days 301 to 999
+    check(delete_before(tree, start + 300 * 86400) == 150,
+          "Delete before removed the wrong number of readings");
+    check(tree->node_count == 350 && 
+          search_floor(tree, start + 300 * 86400) == NULL,
+          "Delete before left old readings behind");
+    check(validate_subtree(tree->root, 0, start + (time_t)count * 86400) > 0,
+          "Tree is not a valid AVL tree after delete before");
+
+    delete_tree(tree);
+
+    // Keeps a rolling 100 day window for 20 windows' worth of readings
+    tree = create_tree();
+
+    for (int i = 0; i < 100; i++) {
+        Data_t reading = {start + (time_t)i * 86400, 0, 0};
+        insert(tree, reading);
+    }
+
+    Slab_t* slabs = tree->slabs;
+
+    for (int i = 100; i < 2000; i++) {
+        Data_t reading = {start + (time_t)i * 86400, 0, 0};
+        insert(tree, reading);
+        delete_before(tree, start + (time_t)(i - 99) * 86400);
+    }
+
+    check(tree->node_count == 100, "Retention window has the wrong size");
+    check(tree->slabs == slabs, "Retention window kept allocating slabs");
+    check(validate_subtree(tree->root, 0, start + 2000 * 86400) > 0,
+          "Tree is not a valid AVL tree after retention eviction");
+
+    check(delete_before(tree, start + 3000 * 86400) == 100 &&
+          tree->root == NULL && tree->node_count == 0,
+          "Delete before everything should empty the tree");
+
+    delete_tree(tree);
+
+    printf("\nTest of delete and retention eviction complete!\n");
+}
+
+
+
+/**
+ * test_aggregate_range() - Tests range summaries
+ *
+ * Builds a tree through inserts, deletes and retention eviction so that the
+ * per-subtree summaries have been through every kind of update, then checks
+ * aggregate_range() against a brute-force scan for many ranges.
+ */
+static void test_aggregate_range(void) {
+    printf("\nTest 12: Range summaries\n");
+
+    const int count = 600;
+    time_t start = create_timestamp(1, 1, 2023);
+    Tree_t* tree = create_tree();
+
+    for (int i = 0; i < count; i++) {
+        int day = (i * 233) % count;
+        Data_t reading = {start + (time_t)day * 86400, 
+                          (uint32_t)(day * 7919) % 100000,
+                          (uint32_t)(day * 104729) % 100000};
+        insert(tree, reading);
+    }
+
+    for (int day = 100; day < count; day += 3) {
+        delete_node(tree, start + (time_t)day * 86400);
+    }
+
+    delete_before(tree, start + 50 * 86400);
+
+    for (int first = 0; first < count; first += 37) {
+        for (int last = first; last < count + 20; last += 53) {
+            time_t t_begin = start + (time_t)first * 86400 - 1;
+            time_t t_end = start + (time_t)last * 86400;
+            Summary_t expected = {0, 0, UINT32_MAX, 0, 0, UINT32_MAX, 0};
+            TreeIter_t iter;
+            const Data_t* reading;
+
+            tree_iter_begin(&iter, tree);
+
+            while ((reading = tree_iter_next(&iter)) != NULL) {
+                if (reading->timestamp < t_begin || 
+                    reading->timestamp > t_end) {
+                    continue;
+                }
+
+                expected.count++;
+                expected.temp_sum += reading->temp;
+                expected.humid_sum += reading->humid;
+                if (reading->temp < expected.temp_min) {
+                    expected.temp_min = reading->temp;
+                }
+                if (reading->temp > expected.temp_max) {
+                    expected.temp_max = reading->temp;
+                }
+                if (reading->humid < expected.humid_min) {
+                    expected.humid_min = reading->humid;
+                }
+                if (reading->humid > expected.humid_max) {
+                    expected.humid_max = reading->humid;
+                }
+            }
+
+            Summary_t actual = aggregate_range(tree, t_begin, t_end);
+
+            check(actual.count == expected.count &&
+                  actual.temp_sum == expected.temp_sum &&
+                  actual.temp_min == expected.temp_min &&
+                  actual.temp_max == expected.temp_max &&
+                  actual.humid_sum == expected.humid_sum &&
+                  actual.humid_min == expected.humid_min &&
+                  actual.humid_max == expected.humid_max,
+                  "Range summary does not match a full scan");
+        }
+    }
+
+    Summary_t empty = aggregate_range(tree, start + 86400, start);
+    check(empty.count == 0, "Reversed range summary should be empty");
+
+    delete_tree(tree);
+
+    printf("\nTest of range summaries complete!\n");
+}
+
+
+
+/**
+ * shared_reader() - Reader thread for the shared tree test
+ *
+ * Searches for readings the writer has already published until the writer
+ * is done. Every one of them must be found with the right data.
+ *
+ * @param context   Reader_t for this thread
+ * @return          NULL
+ */
+static void* shared_reader(void* context) {
+    Reader_t* reader = (Reader_t*)context;
+    int slot = tree_add_reader(reader->tree);
+    unsigned int seed = (unsigned int)slot + 1;
+
+    if (slot < 0) {
+        reader->errors++;
+        return NULL;
+    }
+
+    while (!__atomic_load_n(reader->done, __ATOMIC_ACQUIRE)) {
+        int published = __atomic_load_n(reader->published, __ATOMIC_ACQUIRE);
+
+        if (published == 0) {
+            continue;
+        }
+
+        seed = seed * 1103515245 + 12345;
+        int i = (int)((seed >> 8) % (unsigned int)published);
+
+        tree_read_begin(reader->tree, slot);
+
+        Node_t* node = search(reader->tree, reader->start + (time_t)i * 60);
+        if (node == NULL || node->data.temp != (uint32_t)i) {
+            reader->errors++;
+        }
+
+        Summary_t summary = aggregate_range(reader->tree, reader->start,
+                                            reader->start + 
+                                            (time_t)(published - 1) * 60);
+        if (summary.count < (size_t)published) {
+            reader->errors++;
+        }
+
+        tree_read_end(reader->tree, slot);
+        reader->lookups++;
+    }
+
+    return NULL;
+}
+
+
+
+/**
+ * test_shared_tree() - Tests a shared tree with lock-free readers
+ *
+ * Checks that path-copy inserts keep the tree valid and recycle the nodes
+ * they replace, that in-place deletes are refused, and that reader threads
+ * always find published readings while the writer keeps inserting.
+ */
+static void test_shared_tree(void) {
+    printf("\nTest 13: Lock-free readers during inserts\n");
+
+    const int count = 20000;
+    time_t start = create_timestamp(1, 1, 2024);
+    Tree_t* tree = create_tree();
+
+    check(tree_add_reader(tree) == -1,
+          "Unshared tree should not accept readers");
+    check(share_tree(tree), "Failed to share tree");
+
+    // Writes with no readers first, retired nodes should be reused
+    for (int i = 0; i < count / 4; i++) {
+        Data_t reading = {start + (time_t)i * 60, (uint32_t)i, 0};
+        insert(tree, reading);
+    }
+
+    size_t capacity = 0;
+    for (Slab_t* slab = tree->slabs; slab != NULL; slab = slab->next) {
+        capacity += slab->capacity;
+    }
+
+    check(validate_subtree(tree->root, 0, start + count * 60) > 0,
+          "Path-copy inserts left an invalid tree");
+    check(tree->node_count == count / 4,
+          "Node count wrong after path-copy inserts");
+    check(capacity < (size_t)count,
+          "Replaced nodes were not recycled");
+    check(!delete_node(tree, start), "Shared tree should refuse delete_node");
+    check(delete_before(tree, start + 60) == 0,
+          "Shared tree should refuse delete_before");
+
+    // Inserts the rest while readers search, without tracing every search
+    int log_level = bst_set_log_level(BST_LOG_ERROR);
+    int published = count / 4;
+    bool done = false;
+    Reader_t readers[3];
+    pthread_t threads[3];
+
+    for (int i = 0; i < 3; i++) {
+        readers[i] = (Reader_t){tree, start, &published, &done, 0, 0};
+        pthread_create(&threads[i], NULL, shared_reader, &readers[i]);
+    }
+
+    for (int i = count / 4; i < count; i++) {
+        Data_t reading = {start + (time_t)i * 60, (uint32_t)i, 0};
+        insert(tree, reading);
+        __atomic_store_n(&published, i + 1, __ATOMIC_RELEASE);
+    }
+
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+
+    int errors = 0;
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+        errors += readers[i].errors;
+    }
+
+    bst_set_log_level(log_level);
+
+    check(errors == 0, "Reader found a wrong or missing reading");
+    check(validate_subtree(tree->root, 0, start + count * 60) > 0,
+          "Tree invalid after concurrent inserts");
+    check(tree->node_count == count,
+          "Node count wrong after concurrent inserts");
+
+    delete_tree(tree);
+
+    printf("\nTest of lock-free readers complete!\n");
+}
+
+
+
+/**
+ * collector() - Collector thread for the sharded set test
+ *
+ * Inserts SHARD_TEST_READINGS readings for each of SHARD_TEST_SENSORS
+ * sensors, interleaved the way a collector polling them would.
+ *
+ * @param context   Collector_t for this thread
+ * @return          NULL
+ */
+static void* collector(void* context) {
+    Collector_t* collector = (Collector_t*)context;
+
+    for (int i = 0; i < SHARD_TEST_READINGS; i++) {
+        for (uint32_t s = 0; s < SHARD_TEST_SENSORS; s++) {
+            uint32_t sensor = collector->first_sensor + s;
+            Data_t reading = {collector->start + (time_t)i * 60,
+                              sensor * 100000 + (uint32_t)i, sensor};
+
+            if (!shardset_insert(collector->set, sensor, reading)) {
+                collector->errors++;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+
+/**
+ * check_order() - shardset_range() callback that checks timestamp order
+ */
+static bool check_order(const Data_t* reading, void* context) {
+    Order_t* order = (Order_t*)context;
+
+    if (reading->timestamp < order->last) {
+        order->sorted = false;
+    }
+
+    order->last = reading->timestamp;
+    order->count++;
+
+    return true;
+}
+
+
+
+/**
+ * mark_sensor() - shardset_range() callback that records which sensors a
+ *                 reading at index 500 came from
+ */
+static bool mark_sensor(const Data_t* reading, void* context) {
+    uint32_t* sensor_mask = (uint32_t*)context;
+
+    // The test stores the sensor in humid and sensor * 100000 + i in temp
+    if (reading->temp == reading->humid * 100000 + 500) {
+        *sensor_mask |= 1u << reading->humid;
+    }
+
+    return true;
+}
+
+
+
+/**
+ * test_shardset() - Tests the sharded tree set
+ *
+ * Several collector threads insert readings from their own sensors at once.
+ * Nothing may be lost, and range queries must merge the shards back into
+ * timestamp order.
+ */
+static void test_shardset(void) {
+    printf("\nTest 14: Sharded tree set\n");
+
+    check(create_shardset(0, 3600) == NULL, "Zero shards should be refused");
+    check(create_shardset(SHARD_MAX_COUNT + 1, 3600) == NULL,
+          "Too many shards should be refused");
+
+    ShardSet_t* set = create_shardset(16, 3600);
+    time_t start = create_timestamp(1, 1, 2024);
+
+    check(set != NULL, "Failed to create sharded set");
+    if (set == NULL) {
+        return;
+    }
+
+    Collector_t collectors[SHARD_TEST_THREADS];
+    pthread_t threads[SHARD_TEST_THREADS];
+
+    for (int i = 0; i < SHARD_TEST_THREADS; i++) {
+        collectors[i] = (Collector_t){set, start, 
+                                      (uint32_t)(i * SHARD_TEST_SENSORS), 0};
+        pthread_create(&threads[i], NULL, collector, &collectors[i]);
+    }
+
+    int errors = 0;
+    for (int i = 0; i < SHARD_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        errors += collectors[i].errors;
+    }
+
+    const size_t sensors = SHARD_TEST_THREADS * SHARD_TEST_SENSORS;
+    const size_t total = sensors * SHARD_TEST_READINGS;
+    size_t used_shards = 0;
+
+    for (size_t i = 0; i < set->count; i++) {
+        used_shards += (set->shards[i].tree->node_count > 0);
+    }
+
+    check(errors == 0, "Sharded inserts failed");
+    check(shardset_count(set) == total, "Sharded set lost readings");
+    check(used_shards > 1, "Readings were not spread over the shards");
+
+    // A point lookup returns every sensor's reading at that time
+    uint32_t sensor_mask = 0;
+    size_t matches = shardset_range(set, start + 500 * 60, start + 500 * 60,
+                                    mark_sensor, &sensor_mask);
+
+    check(matches == sensors && sensor_mask == (1u << sensors) - 1,
+          "Sharded point lookup missed a sensor");
+
+    // Full and partial ranges come back merged in timestamp order
+    Order_t order = {0, 0, true};
+    size_t visited = shardset_range(set, start, 
+                                    start + SHARD_TEST_READINGS * 60, 
+                                    check_order, &order);
+
+    check(visited == total && order.count == total,
+          "Sharded range missed readings");
+    check(order.sorted, "Sharded range out of timestamp order");
+
+    order = (Order_t){0, 0, true};
+    visited = shardset_range(set, start + 100 * 60, start + 199 * 60, 
+                             check_order, &order);
+
+    check(visited == 100 * sensors, "Sharded partial range count wrong");
+    check(order.sorted, "Sharded partial range out of timestamp order");
+
+    Summary_t summary = shardset_aggregate(set, start + 100 * 60,
+                                           start + 199 * 60);
+
+    check(summary.count == 100 * sensors, "Sharded summary count wrong");
+    check(summary.humid_min == 0 && summary.humid_max == sensors - 1,
+          "Sharded summary min/max wrong");
+
+    delete_shardset(set);
+
+    printf("\nTest of sharded tree set complete!\n");
+}
+
+
+
+/**
+ * test_snapshot() - Tests snapshot files
+ *
+ * Saves trees of several sizes, maps them back and searches the mapping.
+ * Files that are not snapshots, or are cut short, must be refused.
+ */
+static void test_snapshot(void) {
+    printf("\nTest 15: Memory-mapped snapshots\n");
+
+    const char* path = "test_bst_snapshot.bin";
+    time_t start = create_timestamp(1, 1, 2023);
+    int sizes[] = {0, 1, 1000};
+
+    for (int s = 0; s < sizeof(sizes)/sizeof(int); s++) {
+        int count = sizes[s];
+        Tree_t* tree = create_tree();
+
+        for (int i = 0; i < count; i++) {
+            Data_t reading = {start + (time_t)i * 86400, i, i + 1};
+            insert(tree, reading);
+        }
+
+        check(tree_save(tree, path), "Failed to save snapshot");
+        delete_tree(tree);
+
+        Frozen_t* mapped = tree_open_mmap(path);
+        check(mapped != NULL && mapped->count == (size_t)count,
+              "Snapshot lost readings");
+
+        for (int i = 0; mapped != NULL && i < count; i++) {
+            const Data_t* found = frozen_search(mapped, 
+                                                start + (time_t)i * 86400);
+
+            check(found != NULL && found->temp == (uint32_t)i && 
+                  found->humid == (uint32_t)(i + 1),
+                  "Mapped search missed a stored reading");
+        }
+
+        check(mapped == NULL || frozen_search(mapped, start - 1) == NULL,
+              "Mapped search found a reading before the first");
+
+        delete_frozen(mapped);
+    }
+
+    // An offset near 2^64 would wrap the end of the data back into the file
+    SnapshotHeader_t header;
+    FILE* file = fopen(path, "r+b");
+
+    if (file != NULL) {
+        if (fread(&header, sizeof(header), 1, file) == 1) {
+            header.count = 4;
+            header.data_offset = UINT64_MAX - 63;
+            rewind(file);
+            fwrite(&header, sizeof(header), 1, file);
+        }
+        fclose(file);
+    }
+    check(tree_open_mmap(path) == NULL, "Wrapping data offset was accepted");
+
+    // Cuts the last snapshot short, then overwrites its header
+    file = fopen(path, "rb");
+    char buffer[4096];
+    size_t length = (file != NULL) ? fread(buffer, 1, sizeof(buffer), file) : 0;
+
+    if (file != NULL) {
+        fclose(file);
+    }
+
+    file = fopen(path, "wb");
+    if (file != NULL) {
+        fwrite(buffer, 1, length / 2, file);
+        fclose(file);
+    }
+    check(tree_open_mmap(path) == NULL, "Truncated snapshot was opened");
+
+    file = fopen(path, "wb");
+    if (file != NULL) {
+        memset(buffer, 'x', sizeof(buffer));
+        fwrite(buffer, 1, sizeof(buffer), file);
+        fclose(file);
+    }
+    check(tree_open_mmap(path) == NULL, "Non-snapshot file was opened");
+
+    remove(path);
+    check(tree_open_mmap(path) == NULL, "Missing snapshot was opened");
+
+    printf("\nTest of memory-mapped snapshots complete!\n");
+}
+
+
+
+/**
+ * test_wal() - Tests the write-ahead log
+ *
+ * Logs inserts through a tree with a group commit size of 4, replays the
+ * log into a new tree, and checks that a torn record at the end of the log
+ * is dropped and cut off so that later appends replay too. Also checks the
+ * batch_ms flusher, partial commits, and that a snapshot checkpoints the log.
+ */
+static void test_wal(void) {
+    printf("\nTest 16: Write-ahead log\n");
+
+    const char* path = "test_bst_wal.log";
+    const int count = 10;
+    time_t start = create_timestamp(1, 1, 2023);
+
+    remove(path);
+
+    check(wal_open(path, 0, 0) == NULL, "Zero batch size should be refused");
+    check(wal_replay(path) == NULL, "Missing log should not replay");
+
+    Wal_t* wal = wal_open(path, 4, 0);
+    Tree_t* tree = create_tree();
+
+    check(wal != NULL, "Failed to open log");
+    if (wal == NULL) {
+        delete_tree(tree);
+        return;
+    }
+
+    tree_attach_wal(tree, wal);
+
+    // Inserts out of order, replay has to sort them
+    for (int i = 0; i < count; i++) {
+        int day = (i * 7) % count;
+        Data_t reading = {start + (time_t)day * 86400, day, day + 1};
+        insert(tree, reading);
+    }
+
+    check(wal->commits == 2 && wal->pending == 2,
+          "Log should commit once per 4 records");
+    check(wal_close(wal), "Failed to close log");
+    delete_tree(tree);
+
+    Tree_t* replayed = wal_replay(path);
+    check(replayed != NULL && replayed->node_count == count,
+          "Replay lost readings");
+
+    for (int day = 0; replayed != NULL && day < count; day++) {
+        Node_t* node = search_ceil(replayed, start + (time_t)day * 86400);
+
+        check(node != NULL && node->data.temp == (uint32_t)day &&
+              node->data.humid == (uint32_t)(day + 1),
+              "Replayed tree is missing a reading");
+    }
+    delete_tree(replayed);
+
+    // Half a record, as a crash during a commit would leave
+    FILE* file = fopen(path, "ab");
+    if (file != NULL) {
+        fwrite("torn record", 1, WAL_RECORD_SIZE / 2, file);
+        fclose(file);
+    }
+
+    replayed = wal_replay(path);
+    check(replayed != NULL && replayed->node_count == count,
+          "Replay did not stop cleanly at a torn record");
+    delete_tree(replayed);
+
+    wal = wal_open(path, 1, 0);
+    Data_t late = {start + (time_t)count * 86400, count, count + 1};
+    check(wal != NULL && wal_append(wal, &late) && wal_close(wal),
+          "Failed to append after replay");
+
+    replayed = wal_replay(path);
+    check(replayed != NULL && replayed->node_count == count + 1,
+          "Record appended after a torn tail was lost");
+    delete_tree(replayed);
+
+    // A lone reading is committed batch_ms after it arrives, with nothing
+    // after it to trigger the commit
+    wal = wal_open(path, 100, 20);
+    check(wal != NULL && wal_append(wal, &late), "Failed to log lone reading");
+
+    if (wal != NULL) {
+        struct timespec pause = {0, 10000000};
+
+        for (int i = 0; i < 200 && __atomic_load_n(&wal->commits,
+                                                   __ATOMIC_RELAXED) == 0; i++) {
+            nanosleep(&pause, NULL);
+        }
+
+        pthread_mutex_lock(&wal->lock);
+        check(wal->commits == 1 && wal->pending == 0,
+              "Lone reading was not committed on time");
+        pthread_mutex_unlock(&wal->lock);
+        check(wal_close(wal), "Failed to close log");
+    }
+
+    replayed = wal_replay(path);
+    check(replayed != NULL && replayed->node_count == count + 2,
+          "Lone reading is not in the log");
+    delete_tree(replayed);
+
+    // A commit cut short by the file size limit leaves no partial group for
+    // the next commit to write after
+    struct rlimit limit;
+    void (*old_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+
+    wal = wal_open(path, 4, 0);
+    check(wal != NULL && getrlimit(RLIMIT_FSIZE, &limit) == 0,
+          "Failed to set up partial commit");
+
+    if (wal != NULL) {
+        struct rlimit small = limit;
+        Data_t extra[2] = {
+            {start + (time_t)(count + 1) * 86400, count + 1, count + 2},
+            {start + (time_t)(count + 2) * 86400, count + 2, count + 3}
+        };
+
+        // Room for the log so far and one and a quarter records
+        small.rlim_cur = WAL_HEADER_SIZE + (count + 3) * WAL_RECORD_SIZE + 5;
+        wal_append(wal, &extra[0]);
+        wal_append(wal, &extra[1]);
+
+        setrlimit(RLIMIT_FSIZE, &small);
+        check(!wal_commit(wal), "Commit past the file size limit succeeded");
+        setrlimit(RLIMIT_FSIZE, &limit);
+
+        check(wal_commit(wal) && wal_close(wal),
+              "Commit after a partial commit failed");
+    }
+
+    signal(SIGXFSZ, old_handler);
+
+    replayed = wal_replay(path);
+    check(replayed != NULL && replayed->node_count == count + 4,
+          "Partial commit corrupted the log");
+    delete_tree(replayed);
+
+    // A snapshot checkpoints the log, so a trimmed reading stays deleted and
+    // recovery combines the snapshot with what was logged after it
+    const char* snapshot = "test_bst_wal.snap";
+
+    remove(path);
+    remove(snapshot);
+    wal = wal_open(path, 4, 0);
+    tree = create_tree();
+
+    check(wal != NULL && tree != NULL, "Failed to set up checkpoint");
+    if (wal != NULL && tree != NULL) {
+        tree_attach_wal(tree, wal);
+
+        for (int day = 0; day < count; day++) {
+            Data_t reading = {start + (time_t)day * 86400, day, day + 1};
+            insert(tree, reading);
+        }
+
+        delete_before(tree, start + 5 * 86400);
+        check(tree_save(tree, snapshot), "Failed to save and checkpoint");
+
+        replayed = wal_replay(path);
+        check(replayed != NULL && replayed->node_count == 0,
+              "Checkpoint left readings in the log");
+        delete_tree(replayed);
+
+        insert(tree, late);
+        check(wal_close(wal), "Failed to close log");
+
+        replayed = tree_recover(snapshot, path);
+        check(replayed != NULL && replayed->node_count == count - 4,
+              "Recovery lost readings");
+        check(replayed != NULL && search_ceil(replayed, start) != NULL &&
+              search_ceil(replayed, start)->data.temp == 5,
+              "Recovery brought back a deleted reading");
+        delete_tree(replayed);
+    }
+    delete_tree(tree);
+
+    replayed = tree_recover("test_bst_missing.snap", path);
+    check(replayed != NULL && replayed->node_count == 1,
+          "Recovery without a snapshot should replay the log");
+    delete_tree(replayed);
+    remove(snapshot);
+
+    // A log from something else is refused
+    file = fopen(path, "wb");
+    if (file != NULL) {
+        fputs("not a write-ahead log", file);
+        fclose(file);
+    }
+    check(wal_open(path, 4, 0) == NULL, "Non-log file was opened");
+    check(wal_replay(path) == NULL, "Non-log file was replayed");
+
+    remove(path);
+
+    printf("\nTest of write-ahead log complete!\n");
+}
+
+
+
+/**
+ * ingest_bytes() - writes bytes to a scratch file and loads them with
+ *                  ingest_file()
+ *
+ * @param bytes    Bytes to write
+ * @param length   Number of bytes
+ * @param format   INGEST_CSV or INGEST_BINARY
+ * @return         the loaded tree, NULL if the load failed
+ */
+static Tree_t* ingest_bytes(const void* bytes, size_t length, 
+                            IngestFormat_t format) {
+    const char* path = "test_bst_ingest.dat";
+    FILE* file = fopen(path, "wb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fwrite(bytes, 1, length, file);
+    fclose(file);
+
+    Tree_t* tree = ingest_file(path, format);
+
+    remove(path);
+
+    return tree;
+}
+
+
+
+/**
+ * feed_pipe() - Ingest test thread, writes bytes into a pipe and closes it
+ *
+ * @param context   Feeder_t for this thread
+ */
+static void* feed_pipe(void* context) {
+    Feeder_t* feeder = (Feeder_t*)context;
+    const char* bytes = (const char*)feeder->bytes;
+    size_t done = 0;
+
+    while (done < feeder->length) {
+        ssize_t wrote = write(feeder->fd, bytes + done, feeder->length - done);
+
+        if (wrote <= 0) {
+            break;
+        }
+
+        done += (size_t)wrote;
+    }
+
+    close(feeder->fd);
+
+    return NULL;
+}
+
+
+
+/**
+ * test_ingest() - Tests loading logged readings from a file
+ *
+ * Loads CSV with a header, hex values, blank lines and CRLF line ends, both
+ * in and out of order, checks that malformed lines are refused, and round
+ * trips a binary stream that is large enough to span several read() calls,
+ * from a file and from a pipe.
+ */
+static void test_ingest(void) {
+    printf("\nTest 17: Streaming ingest\n");
+
+    const char* csv = "timestamp,temp,humid\n"
+                      "1700000200,0x7AF2E,0xD8E24\r\n"
+                      "\n"
+                      "1700000000, 10, 20\n"
+                      "1700000100,30,40";
+    Tree_t* tree = ingest_bytes(csv, strlen(csv), INGEST_CSV);
+
+    check(tree != NULL && tree->node_count == 3, "CSV load lost readings");
+
+    Node_t* node = (tree != NULL) ? search_ceil(tree, 1700000150) : NULL;
+    check(node != NULL && node->data.timestamp == 1700000200 &&
+          node->data.temp == 0x7AF2E && node->data.humid == 0xD8E24,
+          "CSV hex reading parsed wrong");
+
+    node = (tree != NULL) ? search_ceil(tree, 0) : NULL;
+    check(node != NULL && node->data.temp == 10 && node->data.humid == 20,
+          "CSV decimal reading parsed wrong");
+    delete_tree(tree);
+
+    const char* bad[] = {
+        "1700000000,10\n",                 // Missing a field
+        "1700000000,10,20,30\n",           // Extra field
+        "1700000000,10,x\n",               // Not a number
+        "1700000000,10,4294967296\n",      // Above 32 bits
+        "1,2,3\nheader,after,data\n",      // Text after the first line
+    };
+
+    for (int i = 0; i < sizeof(bad)/sizeof(bad[0]); i++) {
+        check(ingest_bytes(bad[i], strlen(bad[i]), INGEST_CSV) == NULL,
+              "Malformed CSV was loaded");
+    }
+
+    tree = ingest_bytes("", 0, INGEST_CSV);
+    check(tree != NULL && tree->node_count == 0, "Empty CSV should load");
+    delete_tree(tree);
+
+    // Enough records to need several blocks
+    size_t count = 2 * INGEST_BLOCK_SIZE / sizeof(Data_t) + 7;
+    Data_t* readings = (Data_t*)malloc(count * sizeof(Data_t));
+
+    check(readings != NULL, "Failed to allocate readings");
+    if (readings == NULL) {
+        return;
+    }
+
+    time_t start = create_timestamp(1, 1, 2023);
+
+    for (size_t i = 0; i < count; i++) {
+        readings[i] = (Data_t){start + (time_t)i * 60, (uint32_t)i, 
+                               (uint32_t)(i + 1)};
+    }
+
+    tree = ingest_bytes(readings, count * sizeof(Data_t), INGEST_BINARY);
+    check(tree != NULL && tree->node_count == (int)count,
+          "Binary load lost readings");
+
+    node = (tree != NULL) ? search(tree, start + (time_t)(count - 1) * 60) 
+                          : NULL;
+    check(node != NULL && node->data.temp == (uint32_t)(count - 1),
+          "Binary load is missing the last reading");
+    delete_tree(tree);
+
+    // The same records through a pipe, which gives no size up front
+    int fds[2];
+
+    check(pipe(fds) == 0, "Failed to create pipe");
+    if (fds[0] >= 0) {
+        Feeder_t feeder = {fds[1], readings, count * sizeof(Data_t)};
+        pthread_t thread;
+        void (*old_handler)(int) = signal(SIGPIPE, SIG_IGN);
+
+        // Closing the read end first ends the writer if ingest stops early
+        pthread_create(&thread, NULL, feed_pipe, &feeder);
+        tree = ingest_fd(fds[0], INGEST_BINARY);
+        close(fds[0]);
+        pthread_join(thread, NULL);
+        signal(SIGPIPE, old_handler);
+
+        check(tree != NULL && tree->node_count == (int)count,
+              "Binary load from a pipe lost readings");
+        delete_tree(tree);
+    }
+
+    check(ingest_bytes(readings, 3 * sizeof(Data_t) - 1, INGEST_BINARY) == NULL,
+          "Partial binary record was loaded");
+    check(ingest_file("test_bst_missing.dat", INGEST_CSV) == NULL,
+          "Missing file was loaded");
+
+    free(readings);
+
+    printf("\nTest of streaming ingest complete!\n");
+}
+
+
+
+/**
+ * test_export() - Tests the buffered export engine
+ *
+ * Exports a tree with several readings per day, spread over more than one
+ * buffer, to a file and compares it byte for byte with the table built by
+ * strftime() and printf() the way in_order() used to print it.
+ */
+static void test_export(void) {
+    printf("\nTest 18: Buffered export\n");
+
+    const char* path = "test_bst_export.txt";
+    const int count = 5000;
+    time_t start = create_timestamp(3, 1, 2024);
+    Tree_t* tree = create_tree();
+    size_t length = 0;
+    char* expected = (char*)malloc((size_t)count * EXPORT_MAX_LINE);
+
+    check(tree != NULL && expected != NULL, "Failed to allocate test data");
+    if (tree == NULL || expected == NULL) {
+        delete_tree(tree);
+        free(expected);
+        return;
+    }
+
+    // Readings every 5 hours, inserted out of order, cross many midnights
+    for (int i = 0; i < count; i++) {
+        int slot = (i * 7919) % count;
+        Data_t reading = {start + (time_t)slot * 5 * 3600, 
+                          (uint32_t)slot * 0x9E3779B1u, (uint32_t)slot};
+        insert(tree, reading);
+    }
+
+    for (int slot = 0; slot < count; slot++) {
+        time_t timestamp = start + (time_t)slot * 5 * 3600;
+        char date_str[26];
+
+        strftime(date_str, sizeof(date_str), "%d-%b-%Y", 
+                 localtime(&timestamp));
+        length += sprintf(expected + length, "%s     %08X %08X\n", date_str,
+                          (uint32_t)slot * 0x9E3779B1u, (uint32_t)slot);
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    check(fd >= 0 && tree_export(tree, fd), "Export failed");
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    char* actual = (char*)malloc(length + 1);
+    FILE* file = fopen(path, "rb");
+
+    size_t got = (file != NULL && actual != NULL) 
+                 ? fread(actual, 1, length + 1, file) : 0;
+
+    check(got == length && memcmp(actual, expected, length) == 0,
+          "Export differs from the printf() table");
+
+    if (file != NULL) {
+        fclose(file);
+    }
+
+    check(!tree_export(tree, -1), "Export to a bad descriptor succeeded");
+    check(!tree_export(NULL, 1), "Export of a NULL tree succeeded");
+
+    remove(path);
+    free(actual);
+    free(expected);
+    delete_tree(tree);
+
+    printf("\nTest of buffered export complete!\n");
+}
+
+
+
+/**
+ * hash_reading() - Folds each reading visited into a running hash, so two
+ *                  walks can be compared in order without storing them
+ *
+ * @param context   uint64_t hash to update
+ */
+static bool hash_reading(const Data_t* reading, void* context) {
+    uint64_t* hash = (uint64_t*)context;
+
+    *hash = *hash * 1000003u + (uint64_t)reading->timestamp;
+    *hash = *hash * 1000003u + reading->temp;
+    *hash = *hash * 1000003u + reading->humid;
+
+    return true;
+}
+
+
+
+/**
+ * test_archive() - Tests the compressed archive
+ *
+ * Archives a tree of daily readings whose values drift slowly, with a few
+ * jumps and a gap in the cadence, and checks that every reading decodes to
+ * what went in, that range scans match search_range() and that the archive
+ * is at least 5x smaller than the tree nodes. Also round trips readings with
+ * values wider than 20 bits and timestamps that jump by more than 2^32.
+ */
+static void test_archive(void) {
+    printf("\nTest 19: Compressed archive\n");
+
+    const int count = 3000;
+    time_t start = create_timestamp(1, 1, 2023);
+    Data_t* readings = (Data_t*)malloc(count * sizeof(Data_t));
+    Tree_t* tree = create_tree();
+
+    check(readings != NULL && tree != NULL, "Failed to allocate test data");
+    if (readings == NULL || tree == NULL) {
+        free(readings);
+        delete_tree(tree);
+        return;
+    }
+
+    uint32_t temp = 0x7AF2E;
+    uint32_t humid = 0xD8E24;
+    time_t timestamp = start;
+
+    for (int i = 0; i < count; i++) {
+        temp = (i % 500 == 250) ? (uint32_t)(i * 97) & 0xFFFFF 
+                                : temp + (uint32_t)(i % 7) - 3;
+        humid += (uint32_t)(i % 5) - 2;
+        timestamp += (i == 1500) ? 3 * 86400 + 17 : 86400;
+
+        readings[i] = (Data_t){timestamp, temp, humid};
+        insert(tree, readings[i]);
+    }
+
+    Archive_t* archive = archive_tree(tree);
+
+    check(archive != NULL && archive->count == (size_t)count,
+          "Archive lost readings");
+    if (archive == NULL) {
+        free(readings);
+        delete_tree(tree);
+        return;
+    }
+
+    // Decodes every block and compares against the input
+    size_t next = 0;
+    bool same = true;
+
+    for (size_t b = 0; b < archive->block_count; b++) {
+        BlockReader_t reader;
+        Data_t reading;
+
+        block_reader_begin(&reader, &archive->blocks[b]);
+
+        while (block_reader_next(&reader, &reading)) {
+            same = same && next < (size_t)count &&
+                   reading.timestamp == readings[next].timestamp &&
+                   reading.temp == readings[next].temp &&
+                   reading.humid == readings[next].humid;
+            next++;
+        }
+    }
+    check(same && next == (size_t)count, "Archive decoded wrong readings");
+
+    // Range scans cross block boundaries and the cadence gap
+    time_t ranges[][2] = {
+        {start, start + (time_t)count * 86400 * 2},
+        {readings[1000].timestamp, readings[2100].timestamp},
+        {readings[1023].timestamp + 1, readings[1024].timestamp},
+        {readings[1500].timestamp - 86400, readings[1500].timestamp - 1},
+        {start - 86400, start},
+    };
+
+    for (int r = 0; r < sizeof(ranges)/sizeof(ranges[0]); r++) {
+        uint64_t tree_hash = 0;
+        uint64_t archive_hash = 0;
+        size_t tree_count = search_range(tree, ranges[r][0], ranges[r][1],
+                                         hash_reading, &tree_hash);
+        size_t archive_count = archive_search_range(archive, ranges[r][0],
+                                                    ranges[r][1],
+                                                    hash_reading,
+                                                    &archive_hash);
+
+        check(tree_count == archive_count && tree_hash == archive_hash,
+              "Archive range scan differs from search_range()");
+    }
+
+    printf("Archive holds %d readings in %zu bytes, the tree nodes take %zu\n",
+           count, archive_bytes(archive), count * sizeof(Node_t));
+    check(archive_bytes(archive) * 5 < count * sizeof(Node_t),
+          "Archive is not 5x smaller than the tree");
+
+    delete_archive(archive);
+    delete_tree(tree);
+
+    // Wide values and huge gaps take the raw and 64-bit codes
+    Data_t wide[] = {
+        {-5, 0xFFFFFFFFu, 0},
+        {0, 0x100000, 0xFFFFF},
+        {(time_t)1 << 40, 0, 0x80000000u},
+        {((time_t)1 << 40) + 1, 1, 0x80000001u},
+    };
+    int wide_count = sizeof(wide)/sizeof(wide[0]);
+
+    archive = archive_readings(wide, wide_count);
+    check(archive != NULL && archive->blocks[0].value_bits == 32,
+          "Wide values should use 32-bit blocks");
+
+    if (archive != NULL) {
+        BlockReader_t reader;
+        Data_t reading;
+        int i = 0;
+
+        block_reader_begin(&reader, &archive->blocks[0]);
+
+        while (block_reader_next(&reader, &reading)) {
+            check(i < wide_count && reading.timestamp == wide[i].timestamp &&
+                  reading.temp == wide[i].temp && 
+                  reading.humid == wide[i].humid,
+                  "Wide reading decoded wrong");
+            i++;
+        }
+        check(i == wide_count, "Wide block lost readings");
+    }
+    delete_archive(archive);
+
+    Data_t unsorted[] = {{10, 0, 0}, {5, 0, 0}};
+    check(archive_readings(unsorted, 2) == NULL, 
+          "Unsorted readings were archived");
+
+    archive = archive_readings(NULL, 0);
+    check(archive != NULL && archive->block_count == 0 &&
+          archive_search_range(archive, 0, 100, hash_reading, NULL) == 0,
+          "Empty archive should scan nothing");
+    delete_archive(archive);
+
+    free(readings);
+
+    printf("\nTest of compressed archive complete!\n");
+}
+
+
+
+/**
+ * compact_height() - Checks a compact subtree's AVL balance and ordering
+ *
+ * @return   height of the subtree, or -1 if any node breaks the rules
+ */
+static int compact_height(const CompactTree_t* tree, uint32_t index) {
+    if (index == 0) {
+        return 0;
+    }
+
+    const CompactNode_t* node = &tree->nodes[index];
+    int left = compact_height(tree, node->child[0]);
+    int right = compact_height(tree, node->child[1]);
+
+    if (left < 0 || right < 0 || left - right > 1 || right - left > 1 ||
+        (node->child[0] != 0 && 
+         tree->nodes[node->child[0]].offset > node->offset) ||
+        (node->child[1] != 0 && 
+         tree->nodes[node->child[1]].offset < node->offset)) {
+        return -1;
+    }
+
+    int height = 1 + (left > right ? left : right);
+
+    return (height == node->height) ? height : -1;
+}
+
+
+
+/**
+ * test_compact() - Tests the compact-node tree
+ *
+ * Inserts readings in a scrambled order, checks the tree stays balanced and
+ * finds every reading with its values intact, checks that readings which do
+ * not fit the compact format are refused, and that copies built from a
+ * sorted array and from a Tree_t find the same readings.
+ */
+static void test_compact(void) {
+    printf("\nTest 20: Compact-node tree\n");
+
+    const int count = 5000;
+    time_t start = create_timestamp(1, 1, 2023);
+    CompactTree_t* compact = create_compact_tree();
+    Tree_t* tree = create_tree();
+
+    check(sizeof(CompactNode_t) <= 20, "Compact node is larger than 20 bytes");
+    check(compact != NULL && tree != NULL, "Failed to create trees");
+    if (compact == NULL || tree == NULL) {
+        delete_compact_tree(compact);
+        delete_tree(tree);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int day = (i * 2633) % count;
+        Data_t reading = {start + (time_t)day * 86400, 
+                          (uint32_t)(day * 193) & 0xFFFFF, 
+                          0xFFFFF - (uint32_t)day};
+
+        check(compact_insert(compact, reading), "Compact insert failed");
+        insert(tree, reading);
+    }
+
+    int height = compact_height(compact, compact->root);
+
+    check(compact->count == (uint32_t)count, "Compact tree lost readings");
+    check(height > 0 && height <= 18, "Compact tree is not AVL balanced");
+
+    bool found_all = true;
+
+    for (int day = 0; day < count; day++) {
+        Data_t reading;
+
+        found_all = found_all &&
+                    compact_search(compact, start + (time_t)day * 86400,
+                                   &reading) &&
+                    reading.timestamp == start + (time_t)day * 86400 &&
+                    reading.temp == ((uint32_t)(day * 193) & 0xFFFFF) &&
+                    reading.humid == 0xFFFFF - (uint32_t)day;
+    }
+    check(found_all, "Compact search missed a reading");
+    check(!compact_search(compact, start + 1, NULL), 
+          "Compact search found a missing timestamp");
+    check(!compact_search(compact, start - ((time_t)1 << 40), NULL),
+          "Compact search found a timestamp outside the window");
+
+    // Values wider than 20 bits and timestamps outside the window
+    Data_t wide = {start - 86400, 0x100000, 0};
+    Data_t early = {start - ((time_t)1 << 33), 0, 0};
+
+    check(!compact_insert(compact, wide), "Wide value was inserted");
+    check(!compact_insert(compact, early), "Out of window time was inserted");
+
+    // Copies built in one pass from the tree
+    CompactTree_t* copy = compact_tree(tree);
+    check(copy != NULL && copy->count == (uint32_t)count &&
+          compact_height(copy, copy->root) > 0,
+          "Compact copy of the tree is wrong");
+
+    for (int day = 0; copy != NULL && day < count; day += 97) {
+        Data_t a, b;
+
+        check(compact_search(copy, start + (time_t)day * 86400, &a) &&
+              compact_search(compact, start + (time_t)day * 86400, &b) &&
+              a.temp == b.temp && a.humid == b.humid,
+              "Compact copy differs from the inserted tree");
+    }
+
+    printf("Compact tree holds %d readings in %zu bytes, the tree nodes "
+           "take %zu\n", count, compact_bytes(copy), 
+           count * sizeof(Node_t));
+
+    Data_t unsorted[] = {{10, 0, 0}, {5, 0, 0}};
+    check(build_compact_from_sorted(unsorted, 2) == NULL,
+          "Unsorted readings were built into a compact tree");
+
+    delete_compact_tree(copy);
+    delete_compact_tree(compact);
+    delete_tree(tree);
+
+    printf("\nTest of compact-node tree complete!\n");
+}
+
+
+
+/**
+ * drive_board() - Board test thread, sets its own board's sensor and reads
+ *                 it back over and over
+ *
+ * @param context   Board_t for this thread
+ */
+static void* drive_board(void* context) {
+    Board_t* board = (Board_t*)context;
+    int rtn_code;
+
+    iom361_write(board->board, RSVD1_REG, board->id, &rtn_code);
+
+    for (int i = 0; i < BOARD_TEST_ROUNDS; i++) {
+        // Expected registers are worked out as _iom361_set_sensor1() does
+        float temp = (float)((board->id * 10 + i) % 100);
+        float humid = (float)((board->id * 7 + i) % 100);
+
+        _iom361_set_sensor1(board->board, temp, humid);
+
+        uint32_t temp_reg = iom361_read(board->board, TEMP_REG, &rtn_code);
+        uint32_t humid_reg = iom361_read(board->board, HUMID_REG, &rtn_code);
+
+        if (temp_reg != (uint32_t)(float)(5242.88f * (temp + 50.0)) ||
+            humid_reg != (uint32_t)(10485.76f * humid) ||
+            iom361_read(board->board, RSVD1_REG, &rtn_code) != board->id) {
+            board->errors++;
+        }
+    }
+
+    return NULL;
+}
+
+
+
+/**
+ * test_boards() - Tests the handle-based iom361 API
+ *
+ * Runs one board per thread and checks that no board sees another's values,
+ * that the default board behind the original API is untouched, that burst
+ * reads match single register reads, and that bad handles and offsets are
+ * reported.
+ *
+ * @param io_base   Base address returned by iom361_initialize()
+ */
+static void test_boards(uint32_t* io_base) {
+    printf("\nTest 21: Emulated boards\n");
+
+    int rtn_code;
+    Board_t boards[BOARD_TEST_THREADS];
+    pthread_t threads[BOARD_TEST_THREADS];
+
+    _iom361_setSensor1(23.5, 75.0);
+    uint32_t default_temp = iom361_readReg(io_base, TEMP_REG, &rtn_code);
+
+    for (int t = 0; t < BOARD_TEST_THREADS; t++) {
+        boards[t].board = iom361_create(16, 16, &rtn_code);
+        boards[t].id = 0xB0A4D000u + (uint32_t)t;
+        boards[t].errors = 0;
+        check(boards[t].board != NULL && rtn_code == 0, 
+              "Failed to create a board");
+    }
+
+    for (int t = 0; t < BOARD_TEST_THREADS; t++) {
+        if (boards[t].board != NULL) {
+            pthread_create(&threads[t], NULL, drive_board, &boards[t]);
+        }
+    }
+
+    for (int t = 0; t < BOARD_TEST_THREADS; t++) {
+        if (boards[t].board != NULL) {
+            pthread_join(threads[t], NULL);
+            check(boards[t].errors == 0, "A board read another board's values");
+        }
+        iom361_destroy(boards[t].board);
+    }
+
+    check(iom361_readReg(io_base, TEMP_REG, &rtn_code) == default_temp &&
+          rtn_code == 0,
+          "Default board changed while other boards were driven");
+    check(iom361_readReg(io_base, RSVD1_REG, &rtn_code) == 0x11111111,
+          "Default board's reserved register was overwritten");
+
+    iom361_read(NULL, TEMP_REG, &rtn_code);
+    check(rtn_code == 1, "Read from NULL board not reported");
+
+    iom361_t* board = iom361_create(8, 8, &rtn_code);
+    iom361_read(board, NUM_IO_REGS * sizeof(uint32_t), &rtn_code);
+    check(rtn_code == 2, "Out of range read not reported");
+    iom361_write(board, RSVD2_REG + 1, 0, &rtn_code);
+    check(rtn_code == 3, "Unaligned write not reported");
+
+    // Burst reads match register by register reads
+    ioreg_t regs;
+    uint32_t sensor[2];
+
+    _iom361_set_sensor1(board, 30.0f, 55.0f);
+    check(iom361_read_regs(board, 0, &regs, NUM_IO_REGS, &rtn_code) ==
+          NUM_IO_REGS && rtn_code == 0 &&
+          regs.temperature == iom361_read(board, TEMP_REG, NULL) &&
+          regs.humidity == iom361_read(board, HUMID_REG, NULL) &&
+          regs.reserved_3 == 0x33333333,
+          "Burst read of the register file is wrong");
+    check(iom361_readRegs(io_base, TEMP_REG, sensor, 2, &rtn_code) == 2 &&
+          rtn_code == 0 && sensor[0] == default_temp &&
+          sensor[1] == iom361_readReg(io_base, HUMID_REG, NULL),
+          "Burst read of the sensor registers is wrong");
+
+    check(iom361_read_regs(board, RSVD3_REG, sensor, 2, &rtn_code) == 0 &&
+          rtn_code == 2, "Burst read past the last register not reported");
+    check(iom361_read_regs(board, TEMP_REG + 2, sensor, 1, &rtn_code) == 0 &&
+          rtn_code == 3, "Unaligned burst read not reported");
+    check(iom361_readRegs(sensor, 0, &regs, 1, &rtn_code) == 0 &&
+          rtn_code == 1, "Burst read from a bad base not reported");
+    iom361_destroy(board);
+
+    printf("\nTest of emulated boards complete!\n");
+}
+
+
+
+/**
+ * update_sensor() - Paired read test thread, sets the sensor to matching
+ *                   temperature and humidity pairs until the reader is done
+ *
+ * @param context   Updater_t for this thread
+ */
+static void* update_sensor(void* context) {
+    Updater_t* updater = (Updater_t*)context;
+
+    while (!__atomic_load_n(updater->done, __ATOMIC_ACQUIRE)) {
+        // Both registers move together, so a torn pair has different steps
+        float step = (float)(updater->updates % 64);
+
+        _iom361_set_sensor1(updater->board, step, step);
+        updater->updates++;
+    }
+
+    return NULL;
+}
+
+
+
+/**
+ * test_sensor_pairs() - Tests iom361_read_sensor1() against a sensor being
+ *                       updated by another thread
+ *
+ * Every update writes the temperature and humidity for the same step, so a
+ * pair from two different updates shows up as a temperature and humidity
+ * that belong to different steps.
+ */
+static void test_sensor_pairs(void) {
+    printf("\nTest 22: Paired sensor reads\n");
+
+    int rtn_code;
+    iom361_t* board = iom361_create(16, 16, &rtn_code);
+
+    check(board != NULL, "Failed to create a board");
+    if (board == NULL) {
+        return;
+    }
+
+    // Register values for every step, worked out as _iom361_set_sensor1()
+    // does
+    uint32_t temps[64];
+    uint32_t humids[64];
+
+    for (int step = 0; step < 64; step++) {
+        temps[step] = (uint32_t)(float)(5242.88f * ((float)step + 50.0));
+        humids[step] = (uint32_t)(10485.76f * (float)step);
+    }
+
+    _iom361_set_sensor1(board, 0.0f, 0.0f);
+
+    bool done = false;
+    Updater_t updater = {board, &done, 0};
+    pthread_t thread;
+    int torn = 0;
+
+    pthread_create(&thread, NULL, update_sensor, &updater);
+
+    for (int i = 0; i < PAIR_TEST_READS; i++) {
+        uint32_t temp, humid;
+        int step = 0;
+
+        check(iom361_read_sensor1(board, &temp, &humid) == 0,
+              "Paired read failed");
+
+        while (step < 64 && temps[step] != temp) {
+            step++;
+        }
+
+        torn += (step == 64 || humids[step] != humid);
+    }
+
+    __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+
+    printf("%d paired reads during %d sensor updates\n", PAIR_TEST_READS,
+           updater.updates);
+    check(torn == 0, "Paired read returned a torn temperature/humidity pair");
+    check(iom361_read_sensor1(NULL, NULL, NULL) != 0,
+          "Paired read from a NULL board succeeded");
+
+    iom361_destroy(board);
+
+    printf("\nTest of paired sensor reads complete!\n");
+}
+
+
+
+/**
+ * draw_floats() - PRNG test thread, draws from float_rand_in_range() over
+ *                 ranges of every sign and order
+ *
+ * @param context   Drawer_t for this thread
+ */
+static void* draw_floats(void* context) {
+    static const double ranges[][2] = {
+        {50.0, 85.0}, {85.0, 50.0}, {-10.0, -2.0}, {-5.0, 5.0}, {7.0, 7.0}
+    };
+    Drawer_t* drawer = (Drawer_t*)context;
+
+    drawer->first = float_rand_in_range(0.0, 1.0);
+
+    for (int r = 0; r < 5; r++) {
+        double low = ranges[r][0] < ranges[r][1] ? ranges[r][0] : ranges[r][1];
+        double high = ranges[r][0] < ranges[r][1] ? ranges[r][1] : ranges[r][0];
+
+        for (int i = 0; i < RNDM_TEST_DRAWS; i++) {
+            double value = float_rand_in_range(ranges[r][0], ranges[r][1]);
+
+            drawer->errors += (value < low || value > high);
+        }
+    }
+
+    return NULL;
+}
+
+
+
+/**
+ * test_rndm() - Tests the xoshiro256** engine and float_rndm on top of it
+ */
+static void test_rndm(void) {
+    printf("\nTest 23: Random number generator\n");
+
+    // Same seed, same sequence.  Neighbouring seeds share nothing
+    Rndm_t a, b, c;
+    bool same = true;
+    int matches = 0;
+
+    rndm_seed(&a, 42);
+    rndm_seed(&b, 42);
+    rndm_seed(&c, 43);
+
+    for (int i = 0; i < 1000; i++) {
+        uint64_t value = rndm_next(&a);
+
+        same = same && (value == rndm_next(&b));
+        matches += (value == rndm_next(&c));
+    }
+
+    check(same, "Same seed gave different sequences");
+    check(matches == 0, "Neighbouring seeds gave the same values");
+
+    // Unit values stay in [0, 1] and average to a half, in both halves of
+    // every bit
+    double sum = 0.0;
+    int out_of_range = 0;
+    int low_bit = 0;
+
+    rndm_seed(&a, 7);
+    for (int i = 0; i < 1000000; i++) {
+        double value = rndm_unit(&a);
+
+        sum += value;
+        out_of_range += (value < 0.0 || value > 1.0);
+        low_bit += (int)(rndm_next(&a) & 1);
+    }
+
+    check(out_of_range == 0, "Unit value outside [0, 1]");
+    check(sum / 1000000.0 > 0.499 && sum / 1000000.0 < 0.501,
+          "Unit values do not average to 0.5");
+    check(low_bit > 499000 && low_bit < 501000, "Lowest bit is biased");
+
+    // float_rand_seed() makes the wrapper repeat the engine's sequence
+    float_rand_seed(1234);
+    rndm_seed(&a, 1234);
+    same = true;
+
+    for (int i = 0; i < 1000; i++) {
+        same = same && (float_rand_in_range(-40.0, 85.0) ==
+                        rndm_in_range(&a, -40.0, 85.0));
+    }
+
+    check(same, "float_rand_in_range() does not follow its seed");
+    check(positive_float_rand_in_range(3.0, 3.0) == 3.0,
+          "Empty range did not return its end");
+
+    // Threads draw their own sequences without stepping on each other, or
+    // on the thread that seeded them
+    pthread_t threads[RNDM_TEST_THREADS];
+    Drawer_t drawers[RNDM_TEST_THREADS];
+    double seeded_first;
+
+    float_rand_seed(1234);
+    rndm_seed(&a, 1234);
+    seeded_first = rndm_in_range(&a, 0.0, 1.0);
+
+    for (int i = 0; i < RNDM_TEST_THREADS; i++) {
+        drawers[i].first = -1.0;
+        drawers[i].errors = 0;
+        pthread_create(&threads[i], NULL, draw_floats, &drawers[i]);
+    }
+
+    for (int i = 0; i < RNDM_TEST_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        check(drawers[i].errors == 0, "Thread drew a value outside its range");
+        check(drawers[i].first != seeded_first,
+              "Thread drew the seeding thread's sequence");
+
+        for (int j = 0; j < i; j++) {
+            check(drawers[i].first != drawers[j].first,
+                  "Two threads drew the same sequence");
+        }
+    }
+
+    printf("%d threads drew %d values each\n", RNDM_TEST_THREADS,
+           5 * RNDM_TEST_DRAWS + 1);
+
+    printf("\nTest of random number generator complete!\n");
+}
+
+
+
+/**
+ * test_batch() - Tests iom361_generate_batch() against the registers
+ *                _iom361_set_sensor1() sets
+ */
+static void test_batch(void) {
+    printf("\nTest 24: Sensor register batches\n");
+
+    int rtn_code;
+    iom361_t* board = iom361_create(16, 16, &rtn_code);
+    uint32_t* temps = malloc(BATCH_TEST_READINGS * sizeof(uint32_t));
+    uint32_t* humids = malloc(BATCH_TEST_READINGS * sizeof(uint32_t));
+    uint32_t* again = malloc(BATCH_TEST_READINGS * sizeof(uint32_t));
+
+    check(board != NULL && temps != NULL && humids != NULL && again != NULL,
+          "Failed to set up batch test");
+    if (board == NULL || temps == NULL || humids == NULL || again == NULL) {
+        iom361_destroy(board);
+        free(temps);
+        free(humids);
+        free(again);
+        return;
+    }
+
+    check(iom361_generate_batch(0.0f, 1.0f, 0.0f, 1.0f, NULL, humids, 4) != 0,
+          "Batch into a NULL array succeeded");
+    check(iom361_generate_batch(0.0f, 1.0f, 0.0f, 1.0f, NULL, NULL, 0) == 0,
+          "Empty batch failed");
+
+    // A range of one value encodes exactly as the sensor register does, in
+    // whole groups of readings and the partial group after them
+    int mismatches = 0;
+
+    for (int k = 0; k < 50; k++) {
+        float temp = -40.0f + 2.53f * (float)k;
+        float humid = 2.01f * (float)k;
+        uint32_t temp_reg, humid_reg;
+
+        _iom361_set_sensor1(board, temp, humid);
+        iom361_read_sensor1(board, &temp_reg, &humid_reg);
+        iom361_generate_batch(temp, temp, humid, humid, temps, humids, 7);
+
+        for (int i = 0; i < 7; i++) {
+            mismatches += (temps[i] != temp_reg || humids[i] != humid_reg);
+        }
+    }
+
+    check(mismatches == 0, "Batch value differs from the sensor register");
+
+    // Random ranges stay inside the registers for their ends
+    uint32_t temp_low, temp_high, humid_low, humid_high;
+
+    _iom361_set_sensor1(board, -40.0f, 0.0f);
+    iom361_read_sensor1(board, &temp_low, &humid_low);
+    _iom361_set_sensor1(board, 85.0f, 100.0f);
+    iom361_read_sensor1(board, &temp_high, &humid_high);
+
+    float_rand_seed(2024);
+    check(iom361_generate_batch(-40.0f, 85.0f, 0.0f, 100.0f, temps, humids,
+                                BATCH_TEST_READINGS) == 0,
+          "Batch failed");
+
+    int out_of_range = 0;
+    double temp_sum = 0.0;
+
+    for (int i = 0; i < BATCH_TEST_READINGS; i++) {
+        out_of_range += (temps[i] < temp_low || temps[i] > temp_high ||
+                         humids[i] < humid_low || humids[i] > humid_high);
+        temp_sum += temps[i];
+    }
+
+    double middle = (temp_low + (double)temp_high) / 2.0;
+
+    check(out_of_range == 0, "Batch value outside its range");
+    check(temp_sum / BATCH_TEST_READINGS > middle * 0.99 &&
+          temp_sum / BATCH_TEST_READINGS < middle * 1.01,
+          "Batch temperatures are not centered in their range");
+
+    // The same seed gives the same batch
+    float_rand_seed(2024);
+    iom361_generate_batch(-40.0f, 85.0f, 0.0f, 100.0f, again, humids,
+                          BATCH_TEST_READINGS);
+    check(memcmp(temps, again, BATCH_TEST_READINGS * sizeof(uint32_t)) == 0,
+          "Same seed gave a different batch");
+
+    printf("Generated %d readings per batch\n", BATCH_TEST_READINGS);
+
+    iom361_destroy(board);
+    free(temps);
+    free(humids);
+    free(again);
+
+    printf("\nTest of sensor register batches complete!\n");
+}
+
+
+
 /**
  * build_test_tree() - Builds test tree with March 2024 data
  *